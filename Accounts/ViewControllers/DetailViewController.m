@@ -581,6 +581,9 @@ BOOL allowMultipleWindows = NO;
     // pop it off the stack
     [self.flyingWindows removeObjectAtIndex:index];
     
+    // and stop anything it was waiting on
+    [SFVAsync cancelRequestsForOwner:fwc];
+    
     // And animate out
     [UIView animateWithDuration:0.25f
                      animations:^(void) {
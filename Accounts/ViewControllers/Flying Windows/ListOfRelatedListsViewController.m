@@ -34,6 +34,7 @@
 #import "SFVAsync.h"
 #import "SFVAppCache.h"
 #import "SFRestAPI+Blocks.h"
+#import "UITableView+CoalescedReload.h"
 
 @implementation ListOfRelatedListsViewController
 
@@ -265,8 +266,8 @@ int totalRelationshipQueriesExecuted;
                                             return;
                                         
                                         if( !wasLoadedFromCache )
-                                            [tv reloadRowsAtIndexPaths:[NSArray arrayWithObject:indexPath]
-                                                      withRowAnimation:UITableViewRowAnimationFade];
+                                            [tv setNeedsReloadRowAtIndexPath:indexPath
+                                                            withRowAnimation:UITableViewRowAnimationFade];
                                     }];
 }
 
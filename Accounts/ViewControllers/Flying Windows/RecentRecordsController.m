@@ -258,10 +258,13 @@ static NSString *kLastSelectedIndexKey = @"LastSelectedRecentOrdering";
     // Group our recent records by object
     recentObjects = [[NSMutableDictionary alloc] init];
     
-    for( NSString *recordId in records ) {
-        NSString *obName = [[SFVAppCache sharedSFVAppCache] sObjectFromRecordId:recordId];
+    NSArray *recordTypes = [[SFVAppCache sharedSFVAppCache] sObjectsFromRecordIds:records];
+    
+    for( int i = 0; i < [records count]; i++ ) {
+        NSString *recordId = [records objectAtIndex:i];
+        NSString *obName = [recordTypes objectAtIndex:i];
         
-        if( !obName )
+        if( obName == (id)[NSNull null] )
             continue;
         
         if( [recentObjects objectForKey:obName] )
@@ -314,6 +317,7 @@ static NSString *kLastSelectedIndexKey = @"LastSelectedRecentOrdering";
     [SFVAsync performRetrieveWithFields:[[SFVAppCache sharedSFVAppCache] shortFieldListForObject:sObject]
                                  sObject:sObject
                                      ids:[recentObjects objectForKey:sObject]
+                                   owner:self
                                failBlock:^(NSException *e) {
                                    [self objectQueryCompletedWithRecords:sObject records:nil];
                                }
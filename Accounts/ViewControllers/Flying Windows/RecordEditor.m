@@ -36,6 +36,7 @@
 #import "PRPAlertView.h"
 #import "RootViewController.h"
 #import "DateTimePicker.h"
+#import "SFVRecordStore.h"
 
 // TODO when selecting a dependent picklist, and the controlling field is empty, scroll to controlling field?
 
@@ -890,9 +891,11 @@
         
         [self.rootViewController refreshAllSubNavs];
         
-        if( [record objectForKey:@"Id"] )
+        if( [record objectForKey:@"Id"] ) {
+            // our stored copy is out of date now
+            [[SFVRecordStore sharedSFVRecordStore] removeRecordWithId:[record objectForKey:@"Id"]];
             [self.detailViewController clearFlyingWindowsForRecordId:[record objectForKey:@"Id"]];
-        else {
+        } else {
             [record setObject:[dict objectForKey:@"id"]
                        forKey:@"Id"];
             
@@ -939,6 +942,7 @@
                                                                        
                                                                        // remove recent record
                                                                        [[SFVUtil sharedSFVUtil] removeRecentRecordWithId:[record objectForKey:@"Id"]];
+                                                                       [[SFVRecordStore sharedSFVRecordStore] removeRecordWithId:[record objectForKey:@"Id"]];
                                                                        
                                                                        // Refresh all subnavs in the stack
                                                                        [self.rootViewController refreshAllSubNavs];
@@ -1729,9 +1733,8 @@
                                                                              onObject:[record objectForKey:kObjectTypeKey]
                                                                        stringProperty:FieldLabel]];
         
-        if( [[[SFVAppCache sharedSFVAppCache] field:fieldName
-                                           onObject:[record objectForKey:kObjectTypeKey]
-                                     stringProperty:FieldType] isEqualToString:@"date"]
+        if( [[SFVAppCache sharedSFVAppCache] dataTypeForField:fieldName
+                                                     onObject:[record objectForKey:kObjectTypeKey]] == FieldDataTypeDate
            || ( [[record objectForKey:kObjectTypeKey] isEqualToString:@"Event"]
                && [[record objectForKey:@"IsAllDayEvent"] boolValue]
                && [[NSArray arrayWithObjects:@"StartDateTime", @"EndDateTime", nil] containsObject:fieldName] ) )
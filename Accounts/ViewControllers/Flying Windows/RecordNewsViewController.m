@@ -35,6 +35,7 @@
 #import "DSActivityView.h"
 #import "ListOfRelatedListsViewController.h"
 #import "SFVAppCache.h"
+#import "UITableView+CoalescedReload.h"
 
 @implementation RecordNewsViewController
 
@@ -341,8 +342,8 @@
                                             return;
                                         
                                         if( !wasLoadedFromCache )
-                                            [tableView reloadRowsAtIndexPaths:[NSArray arrayWithObject:indexPath]
-                                                             withRowAnimation:UITableViewRowAnimationFade];
+                                            [tableView setNeedsReloadRowAtIndexPath:indexPath
+                                                                   withRowAnimation:UITableViewRowAnimationFade];
                                     }];
 }
 
@@ -42,6 +42,9 @@
 
 @interface RecordOverviewController : FlyingWindowController <MKMapViewDelegate, AQGridViewDelegate, AQGridViewDataSource, FollowButtonDelegate> {
     BOOL isLoading;
+    
+    // Showing our stored copy of the record while a fresh one loads
+    BOOL displayingStoredRecord;
 }
 
 enum {
@@ -74,6 +77,12 @@ enum {
 - (void) wipeRecordForLoad;
 - (void) loadRecord;
 - (void) describeComplete;
+- (void) buildRecordLayoutView;
+- (void) displayRecord;
+- (void) applyRecordChanges:(NSDictionary *)changes;
+- (BOOL) displayStoredRecord;
+- (void) tagRecordViewed;
+- (void) markLeadReadIfNeeded;
 
 // Map view
 - (void) configureMap;
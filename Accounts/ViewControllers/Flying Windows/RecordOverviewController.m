@@ -46,6 +46,7 @@
 #import "SFVAsync.h"
 #import "SFVAppCache.h"
 #import "SFRestAPI+SFVAdditions.h"
+#import "SFVRecordStore.h"
 
 static float cornerRadius = 4.0f;
 
@@ -328,7 +329,10 @@ int describesCompleted;
                            rightItem:nil
                             animated:NO];
     
-    [DSBezelActivityView newActivityViewForView:self.view];
+    displayingStoredRecord = NO;
+    
+    if( ![self displayStoredRecord] )
+        [DSBezelActivityView newActivityViewForView:self.view];
     
     // Describe every related object
     NSArray *relatedObjects = [[SFVAppCache sharedSFVAppCache] relatedObjectsOnObject:sObjectType];
@@ -420,18 +424,181 @@ int describesCompleted;
     [self.detailViewController addFlyingWindow:FlyingWindowListofRelatedLists withArg:self.account];
 }
 
-- (void) loadRecord {    
+// Replaces the layout view with one for self.account
+- (void) buildRecordLayoutView {
     int fieldLayoutTag = 11;
+    
+    if( self.recordLayoutView ) {
+        [self.recordLayoutView removeFromSuperview];
+        self.recordLayoutView = nil;
+    }
+    
+    self.recordLayoutView = [[SFVUtil sharedSFVUtil] layoutViewForsObject:self.account 
+                                                               withTarget:self.detailViewController 
+                                                             singleColumn:YES];
+    self.recordLayoutView.tag = fieldLayoutTag;
+    
+    [self.scrollView addSubview:self.recordLayoutView];
+}
+
+// Builds the layout, header, comm buttons and map for self.account
+- (void) displayRecord {
+    [self buildRecordLayoutView];
+    scrollView.hidden = NO;
+    
+    UIBarButtonItem *rightItem = nil;
+    
+    // no follow buttons for converted leads
+    if( [[SFVAppCache sharedSFVAppCache] doesGlobalObject:sObjectType 
+                                             haveProperty:GlobalObjectIsFeedEnabled]
+        && ![[self.account objectForKey:@"IsConverted"] boolValue] ) {                
+        self.followButton = [FollowButton followButtonWithParentId:[self.account objectForKey:@"Id"]];
+        self.followButton.delegate = self;
+        [self.followButton performSelector:@selector(loadFollowState) withObject:nil afterDelay:0.5];
+        
+        rightItem = [FollowButton loadingBarButtonItem];
+    } else
+        self.followButton = nil;
+    
+    [self pushNavigationBarWithTitle:[[SFVAppCache sharedSFVAppCache] nameForSObject:self.account]
+                            leftItem:nil
+                           rightItem:rightItem];
+    
+    self.gridView.hidden = NO;
+    
+    [self.scrollView setContentOffset:CGPointZero animated:NO];
+    
+    [self setupCommButtons];
+    
+    [self layoutView];
+    
+    [self.rootViewController subNavSelectAccountWithId:[self.account objectForKey:@"Id"]];
+    [self configureMap];
+    
+    [DSBezelActivityView removeViewAnimated:YES];
+}
+
+// Applies the fields that changed when a stored copy was checked against the server. Only the
+// views those fields show up in are rebuilt. The nav item, follow button and map stay put.
+- (void) applyRecordChanges:(NSDictionary *)changes {
+    NSString *oldLayoutId = [[[SFVUtil sharedSFVUtil] layoutForRecord:self.account] Id];
+    NSString *oldTitle = [[SFVAppCache sharedSFVAppCache] nameForSObject:self.account];
+    
+    NSMutableDictionary *updated = [NSMutableDictionary dictionaryWithDictionary:self.account];
+    
+    for( NSString *field in changes ) {
+        id value = [changes objectForKey:field];
+        
+        if( value == [NSNull null] )
+            [updated removeObjectForKey:field];
+        else
+            [updated setObject:value forKey:field];
+    }
+    
+    self.account = updated;
+    
+    NSString *layoutId = [[[SFVUtil sharedSFVUtil] layoutForRecord:self.account] Id];
+    NSString *title = [[SFVAppCache sharedSFVAppCache] nameForSObject:self.account];
+    
+    if( ![title isEqualToString:oldTitle] && [self.navBar.topItem.titleView isKindOfClass:[UILabel class]] ) {
+        UILabel *titleLabel = (UILabel *)self.navBar.topItem.titleView;
         
+        titleLabel.text = title;
+        [titleLabel sizeToFit];
+    }
+    
+    NSSet *layoutFields = [NSSet setWithArray:[[SFVUtil sharedSFVUtil] fieldListForLayoutId:layoutId]];
+    
+    if( [layoutId isEqualToString:oldLayoutId] && ![layoutFields intersectsSet:[NSSet setWithArray:[changes allKeys]]] )
+        return;
+    
+    // The header and comm buttons are drawn from the same layout's fields
+    [self buildRecordLayoutView];
+    [self setupCommButtons];
+    [self layoutView];
+}
+
+// Counts this record as viewed, once for each time it's opened
+- (void) tagRecordViewed {
+    [[SFAnalytics sharedInstance] tagEventOfType:SFVUserViewedRecord
+                                      attributes:[NSDictionary dictionaryWithObjectsAndKeys:
+                                                  self.sObjectType, @"Object",
+                                                  [SFAnalytics bucketStringForNumber:[NSNumber numberWithInt:[self.account count]] bucketSize:kBucketDefaultSize], @"Field Count",
+                                                  nil]];
+}
+
+// If we own this lead, and it's unread, mark it read
+- (void) markLeadReadIfNeeded {
+    if( ![[self.account objectForKey:kObjectTypeKey] isEqualToString:@"Lead"] 
+        || [[self.account objectForKey:@"IsConverted"] boolValue]
+        || ![[self.account objectForKey:@"OwnerId"] isEqualToString:[[SFVUtil sharedSFVUtil] currentUserId]]
+        || ![[self.account objectForKey:@"IsUnreadByOwner"] boolValue] )
+        return;
+    
+    NSString *recordId = [self.account objectForKey:@"Id"];
+    NSDictionary *readFields = [NSDictionary dictionaryWithObject:[NSNumber numberWithBool:NO]
+                                                           forKey:@"IsUnreadByOwner"];
+    
+    [[SFRestAPI sharedInstance] performUpdateWithObjectType:@"Lead"
+                                                   objectId:recordId
+                                                     fields:readFields
+                                                  failBlock:nil
+                                              completeBlock:nil];
+    
+    [[SFVRecordStore sharedSFVRecordStore] updateRecordWithId:recordId fields:readFields];
+    
+    NSMutableDictionary *updated = [NSMutableDictionary dictionaryWithDictionary:self.account];
+    [updated addEntriesFromDictionary:readFields];
+    self.account = updated;
+}
+
+// Shows our stored copy of this record right away, if we have a recent enough one with every
+// field its layout needs. loadRecord then checks it against the server.
+- (BOOL) displayStoredRecord {
+    NSString *recordId = [self.account objectForKey:@"Id"];
+    SFVRecordStore *store = [SFVRecordStore sharedSFVRecordStore];
+    NSDictionary *stored = [store recordWithId:recordId fieldList:nil];
+    
+    if( !stored )
+        return NO;
+    
+    // Stored records know their record type, so they pick the right layout
+    NSString *layoutId = [[[SFVUtil sharedSFVUtil] layoutForRecord:stored] Id];
+    
+    if( !layoutId || ![store recordWithId:recordId fieldList:[[SFVUtil sharedSFVUtil] fieldListForLayoutId:layoutId]] )
+        return NO;
+    
+    self.account = stored;
+    displayingStoredRecord = YES;
+    
+    [self displayRecord];
+    [self tagRecordViewed];
+    [self markLeadReadIfNeeded];
+    
+    [self performSelector:@selector(addRelatedLists) withObject:nil afterDelay:0.25f];
+    [self.detailViewController performSelector:@selector(setPopoverButton:) withObject:nil afterDelay:0.2f];
+    
+    return YES;
+}
+
+- (void) loadRecord {
     // Only query the fields that will be displayed in the page layout for this account, given its record type and page layout.
     NSString *layoutId = [[[SFVUtil sharedSFVUtil] layoutForRecord:self.account] Id];
+    NSArray *fieldList = [[SFVUtil sharedSFVUtil] fieldListForLayoutId:layoutId];
+    NSString *recordId = [self.account objectForKey:@"Id"];
     
     // Let's be optimistic and add it to history before the load succeeded
-    [[SFVUtil sharedSFVUtil] addRecentRecord:[self.account objectForKey:@"Id"]];
+    [[SFVUtil sharedSFVUtil] addRecentRecord:recordId];
+    
+    // What's on screen was fetched moments ago, no need to ask again
+    if( displayingStoredRecord && [[SFVRecordStore sharedSFVRecordStore] isRecordFresh:recordId] ) {
+        isLoading = NO;
+        return;
+    }
     
     [[SFRestAPI sharedInstance] performRetrieveWithObjectType:sObjectType
-                                                     objectId:[self.account objectForKey:@"Id"]
-                                                    fieldList:[[SFVUtil sharedSFVUtil] fieldListForLayoutId:layoutId]
+                                                     objectId:recordId
+                                                    fieldList:fieldList
                                                     failBlock:^(NSError *e) {                                                        
                                                         [DSBezelActivityView removeViewAnimated:NO];
                                                         isLoading = NO;
@@ -445,6 +612,12 @@ int describesCompleted;
                                                                                                                      [[e userInfo] objectForKey:@"message"], @"Message",
                                                                                                                      nil]];
                                                         
+                                                        // Keep showing the stored copy
+                                                        if( displayingStoredRecord ) {
+                                                            NSLog(@"Failed to refresh stored record %@: %@", recordId, [[e userInfo] objectForKey:@"message"]);
+                                                            return;
+                                                        }
+                                                        
                                                         [PRPAlertView showWithTitle:NSLocalizedString(@"Alert", @"Alert")
                                                                             message:[[e userInfo] objectForKey:@"message"]
                                                                         cancelTitle:NSLocalizedString(@"Cancel", @"Cancel")
@@ -471,6 +644,10 @@ int describesCompleted;
                                                                                                                      self.sObjectType, @"Object",
                                                                                                                      nil]];
                                                         
+                                                        [[SFVRecordStore sharedSFVRecordStore] removeRecordWithId:recordId];
+                                                        displayingStoredRecord = NO;
+                                                        [self wipeRecordForLoad];
+                                                        
                                                         [PRPAlertView showWithTitle:NSLocalizedString(@"Alert", @"Alert")
                                                                             message:NSLocalizedString(@"Failed to load this Record.", @"Account load failed")
                                                                         cancelTitle:NSLocalizedString(@"Cancel", @"Cancel")
@@ -488,69 +665,34 @@ int describesCompleted;
                                                         return;
                                                     }
                                                     
-                                                    [[SFAnalytics sharedInstance] tagEventOfType:SFVUserViewedRecord
-                                                                                      attributes:[NSDictionary dictionaryWithObjectsAndKeys:
-                                                                                                                 self.sObjectType, @"Object",
-                                                                                                                 [SFAnalytics bucketStringForNumber:[NSNumber numberWithInt:[results count]] bucketSize:kBucketDefaultSize], @"Field Count",
-                                                                                                                 nil]];
-                                                    
                                                     NSMutableDictionary *d = [NSMutableDictionary dictionaryWithDictionary:results];
                                                     [d setObject:[results valueForKeyPath:@"attributes.type"]
                                                           forKey:kObjectTypeKey];
                                                     
-                                                    self.account = d;
-                                                    self.recordLayoutView = [[SFVUtil sharedSFVUtil] layoutViewForsObject:self.account 
-                                                                                                               withTarget:self.detailViewController 
-                                                                                                             singleColumn:YES];
-                                                    self.recordLayoutView.tag = fieldLayoutTag;
-                                                    scrollView.hidden = NO;
+                                                    NSDictionary *changes = [[SFVRecordStore sharedSFVRecordStore] storeRecord:d fieldList:fieldList];
                                                     
-                                                    UIBarButtonItem *rightItem = nil;
-                                                    
-                                                    // no follow buttons for converted leads
-                                                    if( [[SFVAppCache sharedSFVAppCache] doesGlobalObject:sObjectType 
-                                                                                             haveProperty:GlobalObjectIsFeedEnabled]
-                                                        && ![[self.account objectForKey:@"IsConverted"] boolValue] ) {                
-                                                        self.followButton = [FollowButton followButtonWithParentId:[self.account objectForKey:@"Id"]];
-                                                        self.followButton.delegate = self;
-                                                        [self.followButton performSelector:@selector(loadFollowState) withObject:nil afterDelay:0.5];
+                                                    if( displayingStoredRecord ) {
+                                                        displayingStoredRecord = NO;
+                                                        
+                                                        if( [changes count] == 0 )
+                                                            return;
                                                         
-                                                        rightItem = [FollowButton loadingBarButtonItem];
+                                                        // Apply just what changed to what's on screen. The view was
+                                                        // counted when the stored copy went up, but the lead may have
+                                                        // become unread again since.
+                                                        [self applyRecordChanges:changes];
+                                                        [self markLeadReadIfNeeded];
+                                                        return;
                                                     }
                                                     
-                                                    [self pushNavigationBarWithTitle:[[SFVAppCache sharedSFVAppCache] nameForSObject:self.account]
-                                                                            leftItem:nil
-                                                                           rightItem:rightItem];
-                                                    
-                                                    self.gridView.hidden = NO;
-                                                    
-                                                    [self.scrollView addSubview:self.recordLayoutView];
-                                                    [self.scrollView setContentOffset:CGPointZero animated:NO];
-                                                    
-                                                    [self setupCommButtons];
-                                                    
-                                                    [self layoutView];
-                                                    
-                                                    [self.rootViewController subNavSelectAccountWithId:[self.account objectForKey:@"Id"]];
-                                                    [self configureMap];
+                                                    self.account = d;
                                                     
-                                                    [DSBezelActivityView removeViewAnimated:YES];
+                                                    [self displayRecord];
+                                                    [self tagRecordViewed];
+                                                    [self markLeadReadIfNeeded];
                                                     
                                                     [self performSelector:@selector(addRelatedLists) withObject:nil afterDelay:0.25f];
                                                     [self.detailViewController performSelector:@selector(setPopoverButton:) withObject:nil afterDelay:0.2f];
-                                                    
-                                                    // If we own this lead, and it was unread, mark it read
-                                                    if( [[self.account objectForKey:kObjectTypeKey] isEqualToString:@"Lead"] 
-                                                        && ![[self.account objectForKey:@"IsConverted"] boolValue]
-                                                        && [[self.account objectForKey:@"OwnerId"] isEqualToString:[[SFVUtil sharedSFVUtil] currentUserId]]
-                                                        && [[self.account objectForKey:@"IsUnreadByOwner"] boolValue] ) {
-                                                        [[SFRestAPI sharedInstance] performUpdateWithObjectType:@"Lead"
-                                                                                                       objectId:[self.account objectForKey:@"Id"]
-                                                                                                         fields:[NSDictionary dictionaryWithObject:[NSNumber numberWithBool:NO]
-                                                                                                                                            forKey:@"IsUnreadByOwner"]
-                                                                                                      failBlock:nil
-                                                                                                  completeBlock:nil];
-                                                    }
                                                 }];
 }
 
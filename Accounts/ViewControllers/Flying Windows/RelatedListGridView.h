@@ -41,6 +41,12 @@ enum sObjectNames {
 @property (nonatomic, retain) ZKRelatedList *relatedList;
 @property (nonatomic, retain) AQGridView *gridView;
 @property (nonatomic, retain) NSMutableArray *records;
+
+// SFVFormattedRows parallel to records, one value per column followed by CreatedDate and LastModifiedDate
+@property (nonatomic, retain) NSMutableArray *rows;
+
+// Bumped on every load so formatting still in flight for an older one is dropped
+@property (nonatomic) NSUInteger loadGeneration;
 @property (nonatomic, retain) UILabel *noResultsLabel;
 @property (nonatomic, retain) NSString *sortColumn;
 @property (nonatomic) BOOL sortAscending;
@@ -34,6 +34,7 @@
 #import "SFVAppCache.h"
 #import "SFRestAPI+SFVAdditions.h"
 #import "CreateRecordButton.h"
+#import "SFVRowFormatter.h"
 
 @interface RelatedListGridView (Private)
 - (NSUInteger) numberOfColumns;
@@ -48,11 +49,13 @@
 + (NSDictionary *) relatedRecordOnRecord:(NSDictionary *)record field:(NSString *)field;
 
 - (NSString *) fieldForColumn:(ZKRelatedListColumn *)column;
+- (NSString *) displayFieldForColumn:(ZKRelatedListColumn *)column;
+- (NSArray *) displayFields;
 @end
 
 @implementation RelatedListGridView
 
-@synthesize relatedList, gridView, records, noResultsLabel, sortColumn, sortAscending;
+@synthesize relatedList, gridView, records, rows, loadGeneration, noResultsLabel, sortColumn, sortAscending;
 
 static float cellHeight = 65.0f;
 BOOL canViewRecordDetail = NO;
@@ -62,6 +65,7 @@ BOOL canSortGridColumns = NO;
     if(( self = [super initWithFrame:frame] )) {                
         self.relatedList = list;        
         self.records = [NSMutableArray array];
+        self.rows = [NSMutableArray array];
         
         canViewRecordDetail = [[SFVAppCache sharedSFVAppCache] doesGlobalObject:[self sObjectNameForRelatedList:sObjectForDescribe]
                                                                    haveProperty:GlobalObjectIsLayoutable];
@@ -101,6 +105,7 @@ BOOL canSortGridColumns = NO;
     gridView.dataSource = nil;
     
     [records release];
+    [rows release];
     [relatedList release];
     [gridView release];
     [noResultsLabel release];
@@ -157,7 +162,7 @@ BOOL canSortGridColumns = NO;
 }
 
 // Given an array of dictionary results, process all the text values and formatting for every field
-// so we don't have to do this at cell construction time
+// so we don't have to do this at cell construction time. The formatting happens off the main thread.
 - (void) processRecords:(NSArray *)arr {
     [[SFAnalytics sharedInstance] tagEventOfType:SFVUserViewedRelatedList
                                       attributes:[NSDictionary dictionaryWithObjectsAndKeys:
@@ -166,35 +171,26 @@ BOOL canSortGridColumns = NO;
                                                                           bucketSize:kBucketDefaultSize], @"Record Count",
                                                   nil]];    
     
-    NSMutableArray *newRecords = [NSMutableArray arrayWithCapacity:[arr count]];
-    
-    for( NSDictionary *record in arr ) {
-        NSMutableDictionary *dict = [NSMutableDictionary dictionaryWithDictionary:record];
-        
-        for( ZKRelatedListColumn *col in [self.relatedList columns] ) {
-            NSString *fieldKeyPath = [self fieldForColumn:col];
-            
-            if( [fieldKeyPath rangeOfString:@"."].location != NSNotFound ) {
-                NSArray *bits = [fieldKeyPath componentsSeparatedByString:@"."];
-                
-                if( ![SFVUtil isEmpty:[dict objectForKey:[bits objectAtIndex:0]]] )
-                    [[dict objectForKey:[bits objectAtIndex:0]] setObject:[[SFVUtil sharedSFVUtil] textValueForField:fieldKeyPath
-                                                                                                      withDictionary:record]
-                                                                   forKey:[bits objectAtIndex:1]];
-            } else
-                [dict setObject:[[SFVUtil sharedSFVUtil] textValueForField:fieldKeyPath
-                                                            withDictionary:record]
-                         forKey:fieldKeyPath];
-            
-        }
-        
-        [newRecords addObject:dict];
-    }
-    
-    [DSBezelActivityView removeViewAnimated:YES];
-    [self.records addObjectsFromArray:newRecords];
-    [self.gridView reloadData];
-    self.gridView.hidden = NO;
+    NSUInteger generation = self.loadGeneration;
+    SFVRowFormatter *formatter = [[SFVRowFormatter alloc] initWithFields:[self displayFields] dateField:nil];
+    
+    [formatter formatRecords:arr
+               completeBlock:^(NSArray *newRows) {
+                   if( ![self isViewLoaded] || generation != self.loadGeneration )
+                       return;
+                   
+                   [DSBezelActivityView removeViewAnimated:YES];
+                   
+                   for( SFVFormattedRow *row in newRows ) {
+                       [self.rows addObject:row];
+                       [self.records addObject:[row record]];
+                   }
+                   
+                   [self.gridView reloadData];
+                   self.gridView.hidden = NO;
+               }];
+    
+    [formatter release];
 }
 
 - (void) loadRecords {  
@@ -210,6 +206,8 @@ BOOL canSortGridColumns = NO;
                                               limit:[self limitAmountForRelatedList]];    
         
     [self.records removeAllObjects];
+    [self.rows removeAllObjects];
+    self.loadGeneration++;
     
     self.gridView.hidden = YES;
     self.noResultsLabel.hidden = YES;
@@ -450,34 +448,18 @@ BOOL canSortGridColumns = NO;
         [cell.gridLabel setFont:[UIFont boldSystemFontOfSize:15]];
         cell.backgroundColor = [UIColor colorWithPatternImage:[UIImage imageNamed:@"gridGradient.png"]];
     } else {
-        NSDictionary *record = [self.records objectAtIndex:( recordRow - 1 )];
+        NSArray *values = [[self.rows objectAtIndex:( recordRow - 1 )] values];
         NSString *field = [self fieldForColumn:col];
         
-        if( [field rangeOfString:@"."].location != NSNotFound ) {
-            // Use the relationship name for the bit before the field
-            NSArray *bits = [field componentsSeparatedByString:@"."];
-            NSString *relationshipName = [[SFVAppCache sharedSFVAppCache] field:[bits objectAtIndex:0]
-                                                                       onObject:[self sObjectNameForRelatedList:sObjectNormal]
-                                                                 stringProperty:FieldRelationshipName];
-            
-            if( [SFVUtil isEmpty:relationshipName] )
-                relationshipName = [bits objectAtIndex:0];
-            
-            NSString *relationshipPath = [NSString stringWithFormat:@"%@.%@", 
-                                          relationshipName, 
-                                          [bits objectAtIndex:1]];
-            
-            cell.gridLabel.text = [[SFVUtil sharedSFVUtil] textValueForField:relationshipPath withDictionary:record];
-        } else if( ![SFVUtil isEmpty:[record objectForKey:field]] )
-            cell.gridLabel.text = [record objectForKey:field];
+        cell.gridLabel.text = [values objectAtIndex:recordCol];
                 
         if( [field isEqualToString:@"CreatedBy.Name"] )
             cell.gridLabel.text = [cell.gridLabel.text stringByAppendingFormat:@"\n%@",
-                                     [[SFVUtil sharedSFVUtil] textValueForField:@"CreatedDate" withDictionary:record]];
+                                     [values objectAtIndex:colCount]];
         
         if( [field isEqualToString:@"LastModifiedBy.Name"] )
             cell.gridLabel.text = [cell.gridLabel.text stringByAppendingFormat:@"\n%@",
-                                     [[SFVUtil sharedSFVUtil] textValueForField:@"LastModifiedDate" withDictionary:record]];
+                                     [values objectAtIndex:( colCount + 1 )]];
                         
         if( canViewRecordDetail && recordCol == 0 ) {
             cell.gridLabel.textColor = AppLinkColor;
@@ -622,9 +604,8 @@ BOOL canSortGridColumns = NO;
             continue;
         }
         
-        if( [[[SFVAppCache sharedSFVAppCache] field:colName
-                                          onObject:[self sObjectNameForRelatedList:sObjectNormal]
-                                    stringProperty:FieldType] isEqualToString:@"currency"]
+        if( [[SFVAppCache sharedSFVAppCache] dataTypeForField:colName
+                                                    onObject:[self sObjectNameForRelatedList:sObjectNormal]] == FieldDataTypeCurrency
             && [[SFVAppCache sharedSFVAppCache] isMultiCurrencyEnabled] ) {
             [fields addObject:@"CurrencyIsoCode"];
         }
@@ -779,4 +760,39 @@ BOOL canSortGridColumns = NO;
     return [col name];
 }
 
+// The path textValueForField: formats for this column
+- (NSString *) displayFieldForColumn:(ZKRelatedListColumn *)col {
+    NSString *field = [self fieldForColumn:col];
+    
+    if( [field rangeOfString:@"."].location == NSNotFound )
+        return field;
+    
+    // Use the relationship name for the bit before the field
+    NSArray *bits = [field componentsSeparatedByString:@"."];
+    NSString *relationshipName = [[SFVAppCache sharedSFVAppCache] field:[bits objectAtIndex:0]
+                                                               onObject:[self sObjectNameForRelatedList:sObjectNormal]
+                                                         stringProperty:FieldRelationshipName];
+    
+    if( [SFVUtil isEmpty:relationshipName] )
+        relationshipName = [bits objectAtIndex:0];
+    
+    return [NSString stringWithFormat:@"%@.%@", 
+            relationshipName, 
+            [bits objectAtIndex:1]];
+}
+
+// One per column, in column order, then the dates shown under CreatedBy and LastModifiedBy
+- (NSArray *) displayFields {
+    NSUInteger colCount = [self numberOfColumns];
+    NSMutableArray *fields = [NSMutableArray arrayWithCapacity:colCount + 2];
+    
+    for( NSUInteger i = 0; i < colCount; i++ )
+        [fields addObject:[self displayFieldForColumn:[self columnAtIndex:i]]];
+    
+    [fields addObject:@"CreatedDate"];
+    [fields addObject:@"LastModifiedDate"];
+    
+    return fields;
+}
+
 @end
@@ -34,6 +34,7 @@
 #import "SFVUtil.h"
 #import "SFVAppCache.h"
 #import "SFRestAPI+SFVAdditions.h"
+#import "UITableView+CoalescedReload.h"
 
 @implementation ObjectLookupController
 
@@ -159,6 +160,7 @@ static NSString *kSOQLSearchScope = @"SOQLOnly";
 - (void)viewWillDisappear:(BOOL)animated {
     [super viewWillDisappear:animated];
     self.delegate = nil;
+    [SFVAsync cancelRequestsForOwner:self];
 }
 
 - (void)dealloc {
@@ -242,12 +244,9 @@ static NSString *kSOQLSearchScope = @"SOQLOnly";
                                         if( ![self isViewLoaded] )
                                             return;
                                         
-                                        if( [tableView numberOfSections] < indexPath.section || [tableView numberOfRowsInSection:indexPath.section] < indexPath.row )
-                                            return;
-                                        
                                         if( !wasLoadedFromCache )
-                                            [resultTable reloadRowsAtIndexPaths:[NSArray arrayWithObject:indexPath]
-                                                               withRowAnimation:UITableViewRowAnimationFade];
+                                            [resultTable setNeedsReloadRowAtIndexPath:indexPath
+                                                                     withRowAnimation:UITableViewRowAnimationFade];
                                     }];
 }
 
@@ -516,6 +515,7 @@ static NSString *kSOQLSearchScope = @"SOQLOnly";
                                                         [SFVAsync performRetrieveWithFields:[[SFVAppCache sharedSFVAppCache] shortFieldListForObject:type]
                                                                                     sObject:type
                                                                                         ids:records
+                                                                                      owner:self
                                                                                   failBlock:^(NSException *e) {
                                                                                       [self receivedObjectResponse:nil];
                                                                                   }
@@ -609,9 +609,14 @@ static NSString *kSOQLSearchScope = @"SOQLOnly";
         } else {
             NSMutableDictionary *tmpRecords = [NSMutableDictionary dictionary];
             NSArray *records = [SFVAsync ZKSObjectArrayToDictionaryArray:results];
+            NSArray *recordTypes = [[SFVAppCache sharedSFVAppCache] sObjectsFromRecordIds:[records valueForKey:@"Id"]];
             
-            for( NSDictionary *ob in records ) {
-                NSString *type = [[SFVAppCache sharedSFVAppCache] sObjectFromRecordId:[ob objectForKey:@"Id"]];
+            for( int i = 0; i < [records count]; i++ ) {
+                NSDictionary *ob = [records objectAtIndex:i];
+                NSString *type = [recordTypes objectAtIndex:i];
+                
+                if( type == (id)[NSNull null] )
+                    continue;
                 
                 if( ![tmpRecords objectForKey:type] )
                     [tmpRecords setObject:[NSMutableArray arrayWithObject:ob] forKey:type];
@@ -57,6 +57,9 @@
 @interface RootViewController : UINavigationController <MGSplitViewControllerDelegate, IASKSettingsDelegate, 
                 UIPopoverControllerDelegate, UINavigationControllerDelegate, EULADelegate, FirstRunDelegate> {
     int totalLoginMetadataOperations, completedLoginMetadataOperations;
+    
+    // YES if the metadata caches were filled from the metadata store for the current user
+    BOOL loadedStoredMetadata;
 }
 
 @property (nonatomic, retain) ZKSforceClient *client;
@@ -106,6 +109,9 @@
 - (NSString *) loginAction;
 - (void) appDidLogin;
 - (void) appDidCompleteLoginMetadataOperation;
+- (void) appDidFinishLoginMetadata;
+- (void) loadStoredMetadata;
+- (void) refreshStoredMetadata;
 - (IBAction) showSettings:(id)sender;
 - (void) doLogout;
 - (OAuthViewController *) loginController;
@@ -47,6 +47,8 @@
 #import "SFVAsync.h"
 #import "SFOAuthCoordinator.h"
 #import "SFRestAPI+SFVAdditions.h"
+#import "SFVMetadataStore.h"
+#import "SFVImageCache.h"
 
 @implementation RootViewController
 
@@ -166,6 +168,12 @@ static int const kExtraLoginOperations = 2;
 }
 
 - (void) popAllSubNavControllers {
+    NSArray *stack = [super viewControllers];
+    
+    // Anything still loading for the controllers we're about to throw away is no longer needed
+    for( int i = 1; i < [stack count]; i++ )
+        [SFVAsync cancelRequestsForOwner:[stack objectAtIndex:i]];
+    
     [self popToRootViewControllerAnimated:NO];
 }
 
@@ -217,6 +225,8 @@ static int const kExtraLoginOperations = 2;
     
     SubNavViewController *viewController = (SubNavViewController *)[super popViewControllerAnimated:NO];
     
+    [SFVAsync cancelRequestsForOwner:viewController];
+    
     if( [viewController respondsToSelector:@selector(animationTransitionForPop)] )
         [UIView setAnimationTransition:[viewController animationTransitionForPop]
                                forView:self.view 
@@ -368,7 +378,11 @@ static int const kExtraLoginOperations = 2;
     
     // log in
     if( ![self isLoggedIn] ) {           
-        if( [[self class] hasStoredOAuthRefreshToken] ) {               
+        if( [[self class] hasStoredOAuthRefreshToken] ) {
+            // get last session's metadata into memory while we log in again
+            if( [[SFVMetadataStore sharedSFVMetadataStore] useLastStore] )
+                [self loadStoredMetadata];
+            
             [self showLoadingModal];
             
             // Logout fallback
@@ -575,6 +589,20 @@ static int const kExtraLoginOperations = 2;
     [[SFRestAPI sharedInstance] setApiVersion:@"v25.0"];
     // END - REST setup
     
+    // Stored metadata is per org, user and API version. If what we loaded at launch
+    // belongs to someone else, drop it.
+    if( [[SFVMetadataStore sharedSFVMetadataStore] useStoreForOrgId:[userinfo organizationId]
+                                                             userId:[userinfo userId]
+                                                         apiVersion:[[SFRestAPI sharedInstance] apiVersion]] 
+        && loadedStoredMetadata ) {
+        [[SFVAppCache sharedSFVAppCache] emptyCaches];
+        [[SFVUtil sharedSFVUtil] emptyCaches:YES];
+        loadedStoredMetadata = NO;
+    }
+    
+    if( !loadedStoredMetadata )
+        [self loadStoredMetadata];
+    
     // Metadata
     completedLoginMetadataOperations = 0;
     totalLoginMetadataOperations = 0;
@@ -587,6 +615,9 @@ static int const kExtraLoginOperations = 2;
                                                                             buttonTitle:@"OK"];
                                                         }
                                                      completeBlock:^(NSDictionary *results) {
+                                                         if( loadedStoredMetadata )
+                                                             [self refreshStoredMetadata];
+                                                         
                                                          // describe every feed-enabled object for great SOSL justice
                                                          if( [[SFVAppCache sharedSFVAppCache] isChatterEnabled] )                                                             
                                                              for( NSString *object in [[SFVAppCache sharedSFVAppCache] allFeedEnabledSObjects] ) {
@@ -618,6 +649,32 @@ static int const kExtraLoginOperations = 2;
     
     // Logout fallback
     [self performLogoutWithDelay:45];
+    
+    // We can draw from stored metadata right away. The requests above refresh it in the background.
+    if( loadedStoredMetadata )
+        [self appDidFinishLoginMetadata];
+}
+
+// Whatever was loaded from the metadata store is shown as is until it's replaced here, so
+// schema, picklist and layout changes show up without logging out
+- (void) refreshStoredMetadata {
+    for( NSString *sObject in [[[[SFVAppCache sharedSFVAppCache] describeSnapshot] objectDescribes] allKeys] )
+        [[SFRestAPI sharedInstance] SFVperformDescribeWithObjectType:sObject
+                                                             refresh:YES
+                                                           failBlock:^(NSError *e) {
+                                                               NSLog(@"Failed to refresh the describe for %@: %@", sObject, e);
+                                                           }
+                                                       completeBlock:nil];
+    
+    for( NSString *sObject in [[SFVUtil sharedSFVUtil] sObjectsWithLayouts] )
+        [[SFVUtil sharedSFVUtil] describeLayoutForsObject:sObject refresh:YES completeBlock:nil];
+}
+
+- (void) loadStoredMetadata {
+    loadedStoredMetadata = [[SFVAppCache sharedSFVAppCache] loadCachesFromMetadataStore];
+    
+    if( loadedStoredMetadata )
+        [[SFVUtil sharedSFVUtil] loadLayoutsFromMetadataStore];
 }
 
 // Delay completing the login until crucial metadata operations, namely describing Account
@@ -632,6 +689,14 @@ static int const kExtraLoginOperations = 2;
     if( completedLoginMetadataOperations < totalLoginMetadataOperations + kExtraLoginOperations )
         return;
     
+    // we already finished logging in using stored metadata, this was just the refresh
+    if( loadedStoredMetadata )
+        return;
+    
+    [self appDidFinishLoginMetadata];
+}
+
+- (void) appDidFinishLoginMetadata {
     [self cancelPerformLogoutWithDelay];
     
     if( self.splitViewController.modalViewController 
@@ -654,6 +719,7 @@ static int const kExtraLoginOperations = 2;
     
     completedLoginMetadataOperations = 0;
     totalLoginMetadataOperations = 0;
+    loadedStoredMetadata = NO;
     
     [self cancelPerformLogoutWithDelay];
     [self hideLoginAnimated:NO];
@@ -674,6 +740,8 @@ static int const kExtraLoginOperations = 2;
     // wipe our caches for geolocations and photos
     [[SFVUtil sharedSFVUtil] emptyCaches:YES];
     [[SFVAppCache sharedSFVAppCache] emptyCaches];
+    [[SFVMetadataStore sharedSFVMetadataStore] removeAllStores];
+    [[SFVImageCache sharedSFVImageCache] removeAllDiskImages];
     
     [self popAllSubNavControllers];
     
@@ -32,6 +32,8 @@
 @class DetailViewController;
 @class RootViewController;
 @class ObjectGridCell;
+@class SFVSectionedList;
+@class SFVRecordWindow;
 
 #define GlobalObjectOrderingKey     @"globalObjectOrderingKey"
 #define FavoriteObjectsKey          @"favoriteObjectsKey"
@@ -57,7 +59,31 @@
     UIView *tableHeader;
     UIBarButtonItem *refreshButton;
     UISegmentedControl *orderingControl;
-    NSString *queryLocator;
+    ZKQueryCursor *recordCursor;
+    
+    // Records by first letter of their name, when ordering by name. Its sections are myRecords.
+    SFVSectionedList *recordList;
+    
+    // Sorted keys of myRecords and searchResults, dropped whenever either changes
+    NSArray *sortedRecordKeys, *sortedSearchKeys;
+    
+    // Summaries of every record in myRecords, which hold those summaries rather than the records,
+    // and the full records for the rows shown most recently
+    SFVRecordWindow *recordWindow;
+    
+    // Bumped whenever the list is cleared or refreshed, so pages still being formatted for it are dropped
+    NSUInteger formatGeneration;
+    
+    // Formatted pages that arrived while the user was scrolling, merged in once the table is idle
+    NSMutableArray *stagedRows;
+    
+    // For working out how fast the table is scrolling, in points per second
+    CGFloat lastScrollOffset, scrollVelocity;
+    NSTimeInterval lastScrollTime;
+    
+    // Pages we may still fetch ahead of the user, refilled over time
+    CGFloat prefetchBudget;
+    NSTimeInterval prefetchBudgetTime;
     UIActionSheet *sheet;
 }
 
@@ -136,6 +162,20 @@ typedef enum SubNavOrderingType {
 
 - (void) insertFollowedRecord:(NSDictionary *)record;
 - (void) removeFollowedRecordWithId:(NSString *)recordId;
+- (SFVSectionedList *) sectionedRecordList;
+- (NSArray *) sortedRecordKeys;
+- (NSArray *) sortedSearchKeys;
+- (void) sectionKeysDidChange;
+- (NSString *) orderingDateField;
+- (NSDictionary *) recordsGroupedByDateFromRows:(NSArray *)rows;
+- (NSArray *) addRecordRows:(NSArray *)rows;
+- (NSArray *) listRowFields;
+- (void) updateRecordWindowViewport;
+- (void) refreshFormattedRows:(NSArray *)rows;
+- (void) prefetchForScrollView:(UIScrollView *)scrollView;
+- (BOOL) spendPrefetchBudget;
+- (void) stageRows:(NSArray *)rows;
+- (void) mergeStagedRows;
 
 - (void) selectAccountWithId:(NSString *)accountId;
 - (void) updateTitleBar;
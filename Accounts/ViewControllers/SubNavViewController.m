@@ -43,6 +43,10 @@
 #import "SFVAsync.h"
 #import "SFRestAPI+SFVAdditions.h"
 #import "CreateRecordButton.h"
+#import "UITableView+CoalescedReload.h"
+#import "SFVSectionedList.h"
+#import "SFVRowFormatter.h"
+#import "SFVRecordWindow.h"
 
 // TODO this file is a monster. Subclass the beast within
 
@@ -69,6 +73,25 @@ static int const helperTag              = 11;
 // Maximum number of accounts to load via queryMore chains
 static int const maxAccounts            = 100000;
 
+// How many pages of remote records to fetch ahead of the user's scrolling, and the
+// most records to hold in that buffer
+static NSUInteger const kRecordCursorLookAhead          = 2;
+static NSUInteger const kRecordCursorMaxBufferedRecords = 2000;
+
+// How many full records to keep for the rows around the viewport. Every other row in the
+// list is only a summary until it's scrolled back to.
+static NSUInteger const kRecordWindowCapacity           = 1000;
+
+// Start on the next page once the end of the list is this many screens away, plus however far
+// the current scrolling speed will carry it in kPrefetchLeadTime seconds
+static CGFloat const kPrefetchScreens                   = 2.0f;
+static NSTimeInterval const kPrefetchLeadTime           = 1.0;
+
+// At most kPrefetchBudgetPages pages fetched ahead of the user, earning one back every
+// kPrefetchBudgetRefill seconds. Reaching the very end of the list always fetches.
+static CGFloat const kPrefetchBudgetPages               = 3.0f;
+static NSTimeInterval const kPrefetchBudgetRefill       = 2.0;
+
 // Size of footer view
 static CGFloat const kFooterHeight      = 52.0f;
 static int const kMaxTitleLength        = 14;
@@ -94,6 +117,7 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
         searching = NO;
         isSearchPending = NO;
         queryingMore = NO;
+        prefetchBudget = kPrefetchBudgetPages;
         subNavOrderingType = OrderingName;
         isGridviewDraggable = ( tableType == SubNavFavoriteObjects );
         _emptyCellIndex = NSNotFound;
@@ -470,7 +494,14 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
 }
 
 - (void) clearRecords {
-    [self.myRecords removeAllObjects];    
+    SFRelease(recordList);
+    [recordWindow removeAllRows];
+    formatGeneration++;
+    queryingMore = NO;
+    [stagedRows removeAllObjects];
+    [NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(mergeStagedRows) object:nil];
+    [self.myRecords removeAllObjects];
+    [self sectionKeysDidChange];
     storedSize = 0;
     
     rowCountLabel.text = @"";
@@ -485,6 +516,11 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
     [searchBar release];
     [searchResults release];
     [myRecords release];
+    SFRelease(recordList);
+    SFRelease(sortedRecordKeys);
+    SFRelease(sortedSearchKeys);
+    SFRelease(recordWindow);
+    SFRelease(stagedRows);
     [rowCountLabel release];
     [pullRefreshTableViewController release];
     [bottomBar release];
@@ -492,7 +528,8 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
     SFRelease(orderingControl);
     SFRelease(refreshButton);
     SFRelease(gridView);
-    SFRelease(queryLocator);
+    [recordCursor cancel];
+    SFRelease(recordCursor);
     SFRelease(loadingView);
     SFRelease(sheet);
     
@@ -596,8 +633,8 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
     
     [self setLoadingViewVisible:NO];
     
-    if (queryLocator)
-        SFRelease(queryLocator);
+    [recordCursor cancel];
+    SFRelease(recordCursor);
     
     [self clearRecords];
     
@@ -664,6 +701,8 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
             for( NSString *object in sortedObjects )
                 [self.myRecords setObject:[[SFVAppCache sharedSFVAppCache] labelForSObject:object usePlural:YES] forKey:object];
             
+            [self sectionKeysDidChange];
+            
             // Write to saved records
             [[NSUserDefaults standardUserDefaults] setObject:sortedObjects forKey:GlobalObjectOrderingKey];
             [[NSUserDefaults standardUserDefaults] synchronize];
@@ -728,6 +767,7 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
                     [SFVAsync performRetrieveWithFields:[[SFVAppCache sharedSFVAppCache] shortFieldListForObject:sObjectType] 
                                                  sObject:sObjectType
                                                      ids:records
+                                                   owner:self
                                                failBlock:^(NSException *e) {
                                                    if( ![self isViewLoaded] ) 
                                                        return;
@@ -749,6 +789,7 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
                                            }];
                 } else 
                     [SFVAsync performSOQLQuery:[self queryForRecords]
+                                         owner:self
                                     failBlock:^(NSException *e) {
                                         if( ![self isViewLoaded] ) 
                                             return;
@@ -764,10 +805,18 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
                                         return;
                                     
                                     if( qr && [qr records] && [[qr records] count] > 0 ) {
-                                        [self refreshResult:[qr records]];
+                                        // Start fetching the next page now, while the user looks at this one
+                                        if( ![qr done] ) {
+                                            [recordCursor cancel];
+                                            [recordCursor release];
+                                            recordCursor = [[ZKQueryCursor alloc] initWithClient:[[SFVUtil sharedSFVUtil] client]
+                                                                                     queryResult:qr
+                                                                               cancellationToken:[SFVAsync cancellationTokenForOwner:self]];
+                                            recordCursor.lookAhead = kRecordCursorLookAhead;
+                                            recordCursor.maxBufferedRecords = kRecordCursorMaxBufferedRecords;
+                                        }
                                         
-                                        if( [qr queryLocator] )
-                                            queryLocator = [[qr queryLocator] copy];
+                                        [self refreshResult:[qr records]];
                                     } else
                                         [self refreshResult:nil];
                                 }];
@@ -892,6 +941,8 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
                 for( NSString *fav in favs )
                     [self.myRecords setObject:[[SFVAppCache sharedSFVAppCache] labelForSObject:fav usePlural:YES] forKey:fav];
                 
+                [self sectionKeysDidChange];
+                
                 rowCountLabel.text = [NSString stringWithFormat:@"%i %@",
                                       [self.myRecords count],
                                       ( [self.myRecords count] != 1 ? 
@@ -922,35 +973,22 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
     // Clear out existing accounts on this list
     //[self.myRecords removeAllObjects];
     
-    results = [SFVAsync ZKSObjectArrayToDictionaryArray:results];
+    formatGeneration++;
     
-    if( results && [results count] > 0 ) {           
-        switch( orderingControl.selectedSegmentIndex ) {
-            case OrderingName:
-                self.myRecords = [NSMutableDictionary dictionaryWithDictionary:[SFVUtil dictionaryFromAccountArray:results]];
-                break;
-            default:
-                if( orderingControl.selectedSegmentIndex == 1 && [[orderingControl titleForSegmentAtIndex:1] isEqualToString:NSLocalizedString(@"Created", @"Created")] )
-                    self.myRecords = [NSMutableDictionary dictionaryWithDictionary:[SFVUtil dictionaryFromRecordsGroupedByDate:results dateField:@"CreatedDate"]];
-                else
-                    self.myRecords = [NSMutableDictionary dictionaryWithDictionary:[SFVUtil dictionaryFromRecordsGroupedByDate:results dateField:@"LastModifiedDate"]];
-                break;
-        }
-        
-        storedSize = [results count];
-        orderingControl.enabled = YES;
-        orderingControl.alpha = 1.0f;
-        
-        rowCountLabel.text = [NSString stringWithFormat:@"%i%@ %@",
-                              storedSize,
-                              ( queryLocator ? @"+" : @"" ),
-                              ( storedSize != 1 ? NSLocalizedString(@"Records", @"Record plural") : NSLocalizedString(@"Record", @"Record singular") )];
+    if( results && [results count] > 0 ) {
+        // Names and dates are worked out off the main thread, then the list is rebuilt from them
+        NSUInteger generation = formatGeneration;
+        SFVRowFormatter *formatter = [[SFVRowFormatter alloc] initWithFields:[self listRowFields] dateField:[self orderingDateField]];
         
-        [self.pullRefreshTableViewController.tableView reloadData];
-        [self.pullRefreshTableViewController.tableView setContentOffset:CGPointZero animated:NO];
+        [formatter formatRecords:results
+                   completeBlock:^(NSArray *rows) {
+                       if( ![self isViewLoaded] || generation != formatGeneration )
+                           return;
+                       
+                       [self refreshFormattedRows:rows];
+                   }];
         
-        if( [self.detailViewController mostRecentlySelectedRecord] )
-            [self selectAccountWithId:[[self.detailViewController mostRecentlySelectedRecord] objectForKey:@"Id"]];
+        [formatter release];
     } else {
         storedSize = 0;
         orderingControl.enabled = NO;
@@ -961,8 +999,44 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
     }
 }
 
+// The first page of a refresh, formatted
+- (void) refreshFormattedRows:(NSArray *)rows {
+    SFRelease(recordList);
+    [recordWindow removeAllRows];
+    
+    rows = [self addRecordRows:rows];
+    
+    switch( orderingControl.selectedSegmentIndex ) {
+        case OrderingName:
+            recordList = [[SFVSectionedList alloc] init];
+            [recordList addRecords:[rows valueForKey:@"record"] sortNames:[rows valueForKey:@"sortName"]];
+            self.myRecords = [recordList sections];
+            break;
+        default:
+            self.myRecords = [NSMutableDictionary dictionaryWithDictionary:[self recordsGroupedByDateFromRows:rows]];
+            break;
+    }
+    
+    storedSize = [rows count];
+    orderingControl.enabled = YES;
+    orderingControl.alpha = 1.0f;
+    
+    rowCountLabel.text = [NSString stringWithFormat:@"%i%@ %@",
+                          storedSize,
+                          ( [recordCursor hasMore] ? @"+" : @"" ),
+                          ( storedSize != 1 ? NSLocalizedString(@"Records", @"Record plural") : NSLocalizedString(@"Record", @"Record singular") )];
+    
+    [self.pullRefreshTableViewController.tableView reloadData];
+    [self.pullRefreshTableViewController.tableView setContentOffset:CGPointZero animated:NO];
+    
+    if( [self.detailViewController mostRecentlySelectedRecord] )
+        [self selectAccountWithId:[[self.detailViewController mostRecentlySelectedRecord] objectForKey:@"Id"]];
+    
+    [self updateRecordWindowViewport];
+}
+
 - (void) queryMore {
-    if( storedSize >= maxAccounts || !queryLocator )
+    if( storedSize + [stagedRows count] >= maxAccounts || ![recordCursor hasMore] )
         return;
     
     // If we are no longer visible, stop querying more
@@ -975,10 +1049,13 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
     orderingControl.enabled = NO;
     orderingControl.alpha = 0.3f;
     
-    [SFVAsync performQueryMore:queryLocator
-                     failBlock:^(NSException *e) {
-                         if( ![self isViewLoaded] ) 
-                             return;
+    // Usually the cursor already has this page buffered, and calls us right back
+    [recordCursor nextPage:^(NSArray *records, NSException *e) {
+                     if( ![self isViewLoaded] ) 
+                         return;
+                     
+                     if( e ) {
+                         [[SFVUtil sharedSFVUtil] receivedException:e];
                          
                          if( [self isEqual:[self.rootViewController currentSubNavViewController]] )
                              [DSBezelActivityView removeViewAnimated:YES];
@@ -987,81 +1064,247 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
                          
                          [self setLoadingViewVisible:NO];
                          
+                         queryingMore = NO;
                          orderingControl.enabled = YES;
                          orderingControl.alpha = 1.0f;
                          
                          return;
                      }
-                 completeBlock:^(ZKQueryResult *qr) {
-                     if( ![self isViewLoaded] ) 
+                     
+                     if( !records || [records count] == 0 ) {
+                         queryingMore = NO;
+                         [self setLoadingViewVisible:NO];
+                         orderingControl.enabled = YES;
+                         orderingControl.alpha = 1.0f;
                          return;
+                     }
                      
-                     queryingMore = NO;
-                     [self setLoadingViewVisible:NO];
-                     orderingControl.enabled = YES;
-                     orderingControl.alpha = 1.0f;
-                     NSMutableDictionary *toAdd = nil;
-                     NSMutableIndexSet *sections = [NSMutableIndexSet indexSet];
+                     NSUInteger generation = formatGeneration;
+                     SFVRowFormatter *formatter = [[SFVRowFormatter alloc] initWithFields:[self listRowFields] dateField:[self orderingDateField]];
                      
-                     if( qr && [qr records] && [[qr records] count] > 0 ) {
-                         switch( orderingControl.selectedSegmentIndex ) {
-                             case OrderingName:
-                                 self.myRecords = [NSMutableDictionary dictionaryWithDictionary:
-                                                   [SFVUtil dictionaryByAddingAccounts:[qr records]
-                                                                          toDictionary:self.myRecords]];
-                                 break;
-                             default:
-                                 if( orderingControl.selectedSegmentIndex == 1 && [[orderingControl titleForSegmentAtIndex:1] isEqualToString:NSLocalizedString(@"Created", @"Created")] )
-                                     toAdd = [NSMutableDictionary dictionaryWithDictionary:[SFVUtil dictionaryFromRecordsGroupedByDate:[qr records]
-                                                                                                                             dateField:@"CreatedDate"]];
-                                 else
-                                     toAdd = [NSMutableDictionary dictionaryWithDictionary:[SFVUtil dictionaryFromRecordsGroupedByDate:[qr records]
-                                                                                                                             dateField:@"LastModifiedDate"]];
-                                 
-                                 for( NSNumber *key in [toAdd allKeys] ) {
-                                     [sections addIndex:[key intValue]];
-                                     
-                                     if( ![SFVUtil isEmpty:[self.myRecords objectForKey:key]] )
-                                         [[self.myRecords objectForKey:key] addObjectsFromArray:[toAdd objectForKey:key]];
-                                     else
-                                         [self.myRecords setObject:[toAdd objectForKey:key] forKey:key];  
-                                 }
-                                 
-                                 break;
-                         }
-                         
-                         if( [qr queryLocator] ) {
-                             if( queryLocator ) 
-                                 SFRelease(queryLocator);
-                             
-                             queryLocator = [[qr queryLocator] copy];                    
-                         } else
-                             NSLog(@"no more to query");
-                         
-                         if( [sections count] > 0 )
-                             [self.pullRefreshTableViewController.tableView reloadSections:sections
-                                                                          withRowAnimation:UITableViewRowAnimationFade];
-                         else
-                             [self.pullRefreshTableViewController.tableView reloadData];
-                         
-                         if( [self.detailViewController mostRecentlySelectedRecord] )
-                             [self selectAccountWithId:[[self.detailViewController mostRecentlySelectedRecord] objectForKey:@"Id"]];
-                         
-                         storedSize += [[qr records] count];
-                         rowCountLabel.text = [NSString stringWithFormat:@"%i%@ %@",
-                                               storedSize,
-                                               ( queryLocator ? @"+" : @"" ),
-                                               ( storedSize != 1 ? NSLocalizedString(@"Records", @"Records plural") : NSLocalizedString(@"Record", @"Record singular") )];
-                         
-                     }
+                     [formatter formatRecords:records
+                                completeBlock:^(NSArray *rows) {
+                                    if( ![self isViewLoaded] || generation != formatGeneration )
+                                        return;
+                                    
+                                    queryingMore = NO;
+                                    orderingControl.enabled = YES;
+                                    orderingControl.alpha = 1.0f;
+                                    
+                                    [self stageRows:rows];
+                                }];
+                     
+                     [formatter release];
                  }];
 }
 
+// Pages are held back while the table is moving, since reloading sections mid-fling stutters.
+// The merge is queued in the default run loop mode, which doesn't run while the user is
+// dragging or the table is decelerating, so it happens on the first idle pass after.
+- (void) stageRows:(NSArray *)rows {
+    if( !stagedRows )
+        stagedRows = [[NSMutableArray alloc] init];
+    
+    [stagedRows addObjectsFromArray:rows];
+    
+    UITableView *tableView = self.pullRefreshTableViewController.tableView;
+    
+    // Unless they're already waiting at the bottom for it
+    if( tableView.contentOffset.y + tableView.frame.size.height >= tableView.contentSize.height ) {
+        [self mergeStagedRows];
+        return;
+    }
+    
+    [NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(mergeStagedRows) object:nil];
+    [self performSelector:@selector(mergeStagedRows) 
+               withObject:nil 
+               afterDelay:0 
+                  inModes:[NSArray arrayWithObject:NSDefaultRunLoopMode]];
+}
+
+- (void) mergeStagedRows {
+    [NSObject cancelPreviousPerformRequestsWithTarget:self selector:@selector(mergeStagedRows) object:nil];
+    [self setLoadingViewVisible:NO];
+    
+    if( [stagedRows count] == 0 || ![self isViewLoaded] )
+        return;
+    
+    NSArray *rows = [[stagedRows copy] autorelease];
+    NSMutableDictionary *toAdd = nil;
+    NSMutableIndexSet *sections = [NSMutableIndexSet indexSet];
+    
+    [stagedRows removeAllObjects];
+    rows = [self addRecordRows:rows];
+    
+    switch( orderingControl.selectedSegmentIndex ) {
+        case OrderingName:
+            [[self sectionedRecordList] addRecords:[rows valueForKey:@"record"] 
+                                         sortNames:[rows valueForKey:@"sortName"]];
+            break;
+        default:
+            toAdd = [NSMutableDictionary dictionaryWithDictionary:[self recordsGroupedByDateFromRows:rows]];
+            
+            for( NSNumber *key in [toAdd allKeys] ) {
+                [sections addIndex:[key intValue]];
+                
+                if( ![SFVUtil isEmpty:[self.myRecords objectForKey:key]] )
+                    [[self.myRecords objectForKey:key] addObjectsFromArray:[toAdd objectForKey:key]];
+                else
+                    [self.myRecords setObject:[toAdd objectForKey:key] forKey:key];  
+            }
+            
+            [self sectionKeysDidChange];
+            
+            break;
+    }
+    
+    if( ![recordCursor hasMore] )
+        NSLog(@"no more to query");
+    
+    if( [sections count] > 0 )
+        [self.pullRefreshTableViewController.tableView reloadSections:sections
+                                                     withRowAnimation:UITableViewRowAnimationFade];
+    else
+        [self.pullRefreshTableViewController.tableView reloadData];
+    
+    if( [self.detailViewController mostRecentlySelectedRecord] )
+        [self selectAccountWithId:[[self.detailViewController mostRecentlySelectedRecord] objectForKey:@"Id"]];
+    
+    [self updateRecordWindowViewport];
+    
+    storedSize += [rows count];
+    rowCountLabel.text = [NSString stringWithFormat:@"%i%@ %@",
+                          storedSize,
+                          ( [recordCursor hasMore] ? @"+" : @"" ),
+                          ( storedSize != 1 ? NSLocalizedString(@"Records", @"Records plural") : NSLocalizedString(@"Record", @"Record singular") )];
+}
+
+// Asks for the next page before the user gets to the end of the list, further ahead the faster
+// they're heading there, so that it's usually in by the time they arrive
+- (void) prefetchForScrollView:(UIScrollView *)scrollView {
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    CGFloat offset = scrollView.contentOffset.y;
+    CGFloat screen = scrollView.frame.size.height;
+    CGFloat remaining = scrollView.contentSize.height - ( offset + screen );
+    
+    if( lastScrollTime > 0 && now > lastScrollTime )
+        scrollVelocity = ( offset - lastScrollOffset ) / ( now - lastScrollTime );
+    
+    lastScrollOffset = offset;
+    lastScrollTime = now;
+    
+    if( remaining <= 0 ) {
+        // Whatever we have is wanted now
+        if( [stagedRows count] > 0 ) {
+            [self mergeStagedRows];
+            return;
+        }
+        
+        if( queryingMore ) {
+            [self setLoadingViewVisible:YES];
+            return;
+        }
+    }
+    
+    // One page ahead of the user at a time
+    if( queryingMore || [stagedRows count] > 0 || ![recordCursor hasMore] )
+        return;
+    
+    if( remaining > kPrefetchScreens * screen + MAX( scrollVelocity, 0 ) * kPrefetchLeadTime )
+        return;
+    
+    if( remaining > 0 && ![self spendPrefetchBudget] )
+        return;
+    
+    if( remaining <= 0 )
+        [self setLoadingViewVisible:YES];
+    
+    [self queryMore];
+}
+
+- (BOOL) spendPrefetchBudget {
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    
+    if( prefetchBudgetTime > 0 )
+        prefetchBudget = MIN( kPrefetchBudgetPages, prefetchBudget + ( now - prefetchBudgetTime ) / kPrefetchBudgetRefill );
+    
+    prefetchBudgetTime = now;
+    
+    if( prefetchBudget < 1 )
+        return NO;
+    
+    prefetchBudget -= 1;
+    return YES;
+}
+
+// Tells the record window which rows are on screen and around it, nearest first, so that the
+// records it keeps are the ones about to be wanted. One row above the viewport for every two
+// below, since lists are mostly scrolled down.
+- (void) updateRecordWindowViewport {
+    if( !recordWindow || searching || subNavTableType != SubNavListOfRemoteRecords )
+        return;
+    
+    NSArray *keys = [self sortedRecordKeys];
+    NSArray *visible = [self.pullRefreshTableViewController.tableView indexPathsForVisibleRows];
+    NSIndexPath *top = ( [visible count] > 0 ? [visible objectAtIndex:0] : [NSIndexPath indexPathForRow:0 inSection:0] );
+    NSUInteger limit = kRecordWindowCapacity;
+    NSMutableArray *below = [NSMutableArray arrayWithCapacity:limit];
+    NSMutableArray *above = [NSMutableArray arrayWithCapacity:limit / 2];
+    
+    if( top.section >= (NSInteger)[keys count] )
+        return;
+    
+    // From the top of the screen down
+    for( NSUInteger section = top.section; section < [keys count] && [below count] < limit; section++ ) {
+        NSArray *records = [self.myRecords objectForKey:[keys objectAtIndex:section]];
+        
+        for( NSUInteger row = ( section == top.section ? top.row : 0 ); row < [records count] && [below count] < limit; row++ ) {
+            NSString *recordId = [[records objectAtIndex:row] objectForKey:@"Id"];
+            
+            if( recordId )
+                [below addObject:recordId];
+        }
+    }
+    
+    // And from just above it up
+    for( NSInteger section = top.section; section >= 0 && [above count] < limit / 2; section-- ) {
+        NSArray *records = [self.myRecords objectForKey:[keys objectAtIndex:section]];
+        
+        for( NSInteger row = ( section == top.section ? top.row : (NSInteger)[records count] ) - 1; row >= 0 && [above count] < limit / 2; row-- ) {
+            NSString *recordId = [[records objectAtIndex:row] objectForKey:@"Id"];
+            
+            if( recordId )
+                [above addObject:recordId];
+        }
+    }
+    
+    NSUInteger onScreen = MIN( [visible count], [below count] );
+    NSUInteger b = onScreen, a = 0;
+    NSMutableArray *ids = [NSMutableArray arrayWithArray:[below subarrayWithRange:NSMakeRange( 0, onScreen )]];
+    
+    while( [ids count] < limit && ( b < [below count] || a < [above count] ) ) {
+        for( NSUInteger i = 0; i < 2 && b < [below count] && [ids count] < limit; i++ )
+            [ids addObject:[below objectAtIndex:b++]];
+        
+        if( a < [above count] && [ids count] < limit )
+            [ids addObject:[above objectAtIndex:a++]];
+    }
+    
+    [recordWindow setViewportIds:ids];
+}
+
 #pragma mark - scrolling delegate
 
 - (void)scrollViewDidEndDragging:(UIScrollView *)scrollView willDecelerate:(BOOL)decelerate {
     if( [self.pullRefreshTableViewController respondsToSelector:@selector(scrollViewDidEndDragging:willDecelerate:)] )
         [self.pullRefreshTableViewController scrollViewDidEndDragging:scrollView willDecelerate:decelerate];
+    
+    if( !decelerate )
+        [self updateRecordWindowViewport];
+}
+
+- (void) scrollViewDidEndDecelerating:(UIScrollView *)scrollView {
+    [self updateRecordWindowViewport];
 }
 
 - (void)scrollViewWillBeginDragging:(UIScrollView *)scrollView {
@@ -1075,11 +1318,8 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
     if( [self.pullRefreshTableViewController respondsToSelector:@selector(scrollViewDidScroll:)] )
         [self.pullRefreshTableViewController scrollViewDidScroll:scrollView];
 
-    if( subNavTableType == SubNavListOfRemoteRecords && !queryingMore && queryLocator &&
-        ([scrollView contentOffset].y + scrollView.frame.size.height) >= [scrollView contentSize].height ) {
-        [self setLoadingViewVisible:YES];        
-        [self queryMore];
-    }
+    if( subNavTableType == SubNavListOfRemoteRecords )
+        [self prefetchForScrollView:scrollView];
 }
 
 #pragma mark - searching table view
@@ -1182,6 +1422,8 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
             for( NSString *name in [self.myRecords allKeys] )
                 if( [[self.myRecords objectForKey:name] rangeOfString:searchText options:NSCaseInsensitiveSearch].location != NSNotFound )
                     [self.searchResults setObject:[self.myRecords objectForKey:name] forKey:name];
+            
+            [self sectionKeysDidChange];
                    
             rowCountLabel.text = [NSString stringWithFormat:@"%i %@",
                                   [searchResults count],
@@ -1227,6 +1469,7 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
                                                     [(PullRefreshTableViewController *)self.pullRefreshTableViewController stopLoading];
                                                 
                                                 [self.searchResults removeAllObjects];
+                                                [self sectionKeysDidChange];
                                                 
                                                 if( results && [results count] > 0 )
                                                     self.searchResults = [NSMutableDictionary dictionaryWithDictionary:
@@ -1287,6 +1530,98 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
 
 #pragma mark - follow actions
 
+// The list behind myRecords when it's ordered by name
+- (SFVSectionedList *) sectionedRecordList {
+    if( !recordList ) {
+        recordList = [[SFVSectionedList alloc] initWithSections:self.myRecords];
+        self.myRecords = [recordList sections];
+    }
+    
+    return recordList;
+}
+
+// When ordering by name the record list keeps its own section order, otherwise the keys are
+// sorted the first time they're asked for and kept until the records change.
+- (NSArray *) sortedRecordKeys {
+    if( recordList && self.myRecords == [recordList sections] )
+        return [recordList sectionTitles];
+    
+    if( !sortedRecordKeys )
+        sortedRecordKeys = [[SFVUtil sortArray:[self.myRecords allKeys]] retain];
+    
+    return sortedRecordKeys;
+}
+
+- (NSArray *) sortedSearchKeys {
+    if( !sortedSearchKeys )
+        sortedSearchKeys = [[SFVUtil sortArray:[self.searchResults allKeys]] retain];
+    
+    return sortedSearchKeys;
+}
+
+// Call after adding or removing keys in myRecords or searchResults in place
+- (void) sectionKeysDidChange {
+    SFRelease(sortedRecordKeys);
+    SFRelease(sortedSearchKeys);
+}
+
+// The date field records are grouped by when we're not ordering by name
+- (NSString *) orderingDateField {
+    if( orderingControl.selectedSegmentIndex == 1 && [[orderingControl titleForSegmentAtIndex:1] isEqualToString:NSLocalizedString(@"Created", @"Created")] )
+        return @"CreatedDate";
+    
+    return @"LastModifiedDate";
+}
+
+// Groups formatted rows by the date they were formatted with
+- (NSDictionary *) recordsGroupedByDateFromRows:(NSArray *)rows {
+    NSMutableArray *records = [NSMutableArray arrayWithCapacity:[rows count]];
+    NSMutableData *column = [NSMutableData dataWithLength:[rows count] * sizeof(NSTimeInterval)];
+    NSTimeInterval *seconds = (NSTimeInterval *)[column mutableBytes];
+    NSUInteger i = 0;
+    
+    for( SFVFormattedRow *row in rows ) {
+        [records addObject:[row record]];
+        seconds[i++] = [row date];
+    }
+    
+    return [SFVUtil dictionaryFromRecords:records groupedByDateColumn:column];
+}
+
+// Hands formatted rows to the record window, returning the summary rows that go in the list
+- (NSArray *) addRecordRows:(NSArray *)rows {
+    if( !recordWindow )
+        recordWindow = [[SFVRecordWindow alloc] initWithObject:sObjectType
+                                                      capacity:kRecordWindowCapacity];
+    
+    return [recordWindow addRows:rows];
+}
+
+// What the formatter works out for each row, beyond its name and date: the detail line
+- (NSArray *) listRowFields {
+    NSString *field = [[SFVAppCache sharedSFVAppCache] descriptionFieldForObject:sObjectType];
+    
+    return ( field ? [NSArray arrayWithObject:field] : [NSArray array] );
+}
+
+- (void) setMyRecords:(NSMutableDictionary *)records {
+    if( records != myRecords ) {
+        [myRecords release];
+        myRecords = [records retain];
+    }
+    
+    [self sectionKeysDidChange];
+}
+
+- (void) setSearchResults:(NSMutableDictionary *)results {
+    if( results != searchResults ) {
+        [searchResults release];
+        searchResults = [results retain];
+    }
+    
+    [self sectionKeysDidChange];
+}
+
 - (void) removeFollowedRecordWithId:(NSString *)recordId {
     if( self.subNavTableType != SubNavListOfRemoteRecords || self.subNavObjectListType != ObjectListRecordsIFollow || 
         [self.myRecords count] == 0 )
@@ -1302,24 +1637,21 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
     }
     
     NSDictionary *record = [NSDictionary dictionaryWithObject:recordId forKey:@"Id"];
-    NSIndexPath *ip = [SFVUtil indexPathForAccountDictionary:record allAccountDictionary:self.myRecords];
+    NSIndexPath *ip = [SFVUtil indexPathForAccountDictionary:record allAccountDictionary:self.myRecords sortedKeys:[self sortedRecordKeys]];
     
     if( ip ) {
         // Update datasource
-        NSString *key = [[SFVUtil sortArray:[self.myRecords allKeys]] objectAtIndex:ip.section];
-        NSMutableArray *indexRecords = [NSMutableArray arrayWithArray:[self.myRecords objectForKey:key]];
-        [indexRecords removeObjectAtIndex:ip.row];
+        NSString *key = [[self sortedRecordKeys] objectAtIndex:ip.section];
+        [[self sectionedRecordList] removeRecordWithId:recordId];
+        [recordWindow removeRowWithId:recordId];
         
         // Update tableview
-        if( [indexRecords count] == 0 ) {
-            [self.myRecords removeObjectForKey:key];
+        if( ![self.myRecords objectForKey:key] )
             [self.pullRefreshTableViewController.tableView deleteSections:[NSIndexSet indexSetWithIndex:ip.section]
                                                          withRowAnimation:UITableViewRowAnimationFade];
-        } else {
-            [self.myRecords setObject:indexRecords forKey:key];
+        else
             [self.pullRefreshTableViewController.tableView deleteRowsAtIndexPaths:[NSArray arrayWithObject:ip]
-                                                                 withRowAnimation:UITableViewRowAnimationFade];        
-        }
+                                                                 withRowAnimation:UITableViewRowAnimationFade];
     }
 }
 
@@ -1337,13 +1669,11 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
     }
     
     // Merge into our data source
-    NSDictionary *newDictionary = [SFVUtil dictionaryByAddingAccounts:[NSArray arrayWithObject:record] toDictionary:self.myRecords];
-    NSIndexPath *ip = [SFVUtil indexPathForAccountDictionary:record allAccountDictionary:newDictionary];
+    [[self sectionedRecordList] addRecords:[NSArray arrayWithObject:record]];
+    NSIndexPath *ip = [SFVUtil indexPathForAccountDictionary:record allAccountDictionary:self.myRecords sortedKeys:[self sortedRecordKeys]];
     
     if( ip ) {
-        // Update data source
-        self.myRecords = [NSMutableDictionary dictionaryWithDictionary:newDictionary];
-        NSString *key = [[SFVUtil sortArray:[self.myRecords allKeys]] objectAtIndex:ip.section];
+        NSString *key = [[self sortedRecordKeys] objectAtIndex:ip.section];
         
         // Update tableview
         if( [[self.myRecords objectForKey:key] count] == 1 )
@@ -1371,7 +1701,7 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
     else {
         arr = [[NSUserDefaults standardUserDefaults] arrayForKey:( subNavTableType == SubNavAllObjects ? GlobalObjectOrderingKey : FavoriteObjectsKey )];
         name = ( arr && [arr count] > 0 ? [arr objectAtIndex:index] : 
-                [[SFVUtil sortArray:[self.myRecords allKeys]] objectAtIndex:index] );
+                [[self sortedRecordKeys] objectAtIndex:index] );
     }
     
     NSString *imgURL = [[SFVAppCache sharedSFVAppCache] logoURLForSObjectTab:name];
@@ -1412,7 +1742,7 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
     } else {
         arr = [[NSUserDefaults standardUserDefaults] arrayForKey:( subNavTableType == SubNavAllObjects ? GlobalObjectOrderingKey : FavoriteObjectsKey )];
         name = ( arr && [arr count] > 0 ? [arr objectAtIndex:index] : 
-               [[SFVUtil sortArray:[self.myRecords allKeys]] objectAtIndex:index] );
+               [[self sortedRecordKeys] objectAtIndex:index] );
         label = [self.myRecords objectForKey:name];
     }
         
@@ -1452,7 +1782,7 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
     } else {        
         arr = [[NSUserDefaults standardUserDefaults] arrayForKey:( subNavTableType == SubNavAllObjects ? GlobalObjectOrderingKey : FavoriteObjectsKey )];
         name = ( arr && [arr count] > 0 ? [arr objectAtIndex:index] : 
-                [[SFVUtil sortArray:[self.myRecords allKeys]] objectAtIndex:index] );
+                [[self sortedRecordKeys] objectAtIndex:index] );
     }
     
     [DSBezelActivityView newActivityViewForView:self.view];
@@ -1741,7 +2071,7 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
             customLabel.text = [[[SFVAppCache sharedSFVAppCache] listAllAppLabels] objectAtIndex:self.appIndex];
         else if( ( subNavTableType == SubNavObjectListTypePicker && searching ) ||
             ( subNavTableType == SubNavListOfRemoteRecords && orderingControl.selectedSegmentIndex <= 0 ) )
-            customLabel.text = [[SFVUtil sortArray:( searching ? [searchResults allKeys] : [myRecords allKeys] )] objectAtIndex:section];
+            customLabel.text = [( searching ? [self sortedSearchKeys] : [self sortedRecordKeys] ) objectAtIndex:section];
         else if( subNavTableType != SubNavObjectListTypePicker )
             customLabel.text = [DateGroupsArray objectAtIndex:section];
         else
@@ -1769,7 +2099,8 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
     if( accountId ) {        
         NSDictionary *d = [NSDictionary dictionaryWithObjectsAndKeys:accountId, @"Id", nil];
         NSIndexPath *path = [SFVUtil indexPathForAccountDictionary:d
-                                                  allAccountDictionary:( searching ? self.searchResults : self.myRecords )];
+                                                  allAccountDictionary:( searching ? self.searchResults : self.myRecords )
+                                                            sortedKeys:( searching ? [self sortedSearchKeys] : [self sortedRecordKeys] )];
                 
         if( path )
             [self.pullRefreshTableViewController.tableView selectRowAtIndexPath:path animated:NO scrollPosition:UITableViewScrollPositionNone];
@@ -1799,7 +2130,7 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
 
 - (NSInteger)tableView:(UITableView *)tableView sectionForSectionIndexTitle:(NSString *)title atIndex:(NSInteger)index {           
     if( orderingControl.selectedSegmentIndex <= 0 ) {
-        NSArray *sortedKeys = [SFVUtil sortArray:( searching ? [searchResults allKeys] : [myRecords allKeys] )];
+        NSArray *sortedKeys = ( searching ? [self sortedSearchKeys] : [self sortedRecordKeys] );
         int ret = 0;
         
         for( int x = 0; x < [sortedKeys count]; x++ )        
@@ -1822,7 +2153,7 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
     
     if( subNavTableType == SubNavListOfRemoteRecords ||
         ( subNavTableType == SubNavObjectListTypePicker && searching ) )
-        return ( searching ? [[searchResults allKeys] count] : [[myRecords allKeys] count] );
+        return ( searching ? [searchResults count] : [myRecords count] );
     
     return 1;
 }
@@ -1842,18 +2173,18 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
                 if( [searchResults count] == 0 )
                     return 0;
                 
-                sortedKeys = [SFVUtil sortArray:[searchResults allKeys]];
+                sortedKeys = [self sortedSearchKeys];
                 return [[searchResults objectForKey:[sortedKeys objectAtIndex:section]] count];
             }                
             
             return [[self listsForObject] count];            
         case SubNavListOfRemoteRecords:
             if( searching ) {
-                sortedKeys = [SFVUtil sortArray:[searchResults allKeys]];
+                sortedKeys = [self sortedSearchKeys];
                 return [[searchResults objectForKey:[sortedKeys objectAtIndex:section]] count];
             }
             
-            sortedKeys = [SFVUtil sortArray:[myRecords allKeys]];
+            sortedKeys = [self sortedRecordKeys];
             return [[myRecords objectForKey:[sortedKeys objectAtIndex:section]] count];
         default:
             return 0;
@@ -1883,7 +2214,7 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
                 keys = [[NSUserDefaults standardUserDefaults] arrayForKey:GlobalObjectOrderingKey];
                 
                 if( !keys || [keys count] == 0 )
-                    keys = [SFVUtil sortArray:[self.myRecords allKeys]];
+                    keys = [self sortedRecordKeys];
             }
             
             NSString *str = [keys objectAtIndex:indexPath.row];
@@ -1903,12 +2234,9 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
                                         if( ![self isViewLoaded] || ![self.rootViewController isLoggedIn] )
                                             return;
                                         
-                                        if( [tableView numberOfSections] < indexPath.section || [tableView numberOfRowsInSection:indexPath.section] < indexPath.row )
-                                            return;
-                                        
                                         if( !wasLoadedFromCache )
-                                            [tableView reloadRowsAtIndexPaths:[NSArray arrayWithObject:indexPath]
-                                                             withRowAnimation:UITableViewRowAnimationFade];
+                                            [tableView setNeedsReloadRowAtIndexPath:indexPath
+                                                                   withRowAnimation:UITableViewRowAnimationFade];
                                     }];
 }
 
@@ -1969,7 +2297,7 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
                 keys = [[NSUserDefaults standardUserDefaults] arrayForKey:GlobalObjectOrderingKey];
                 
                 if( !keys || [keys count] == 0 )
-                    keys = [SFVUtil sortArray:[self.myRecords allKeys]];
+                    keys = [self sortedRecordKeys];
             }
             
             str = [keys objectAtIndex:indexPath.row];
@@ -1989,7 +2317,7 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
         case SubNavObjectListTypePicker:
         case SubNavListOfRemoteRecords:
             if( searching )
-                record = [SFVUtil accountFromIndexPath:indexPath accountDictionary:searchResults];
+                record = [SFVUtil accountFromIndexPath:indexPath accountDictionary:searchResults sortedKeys:[self sortedSearchKeys]];
             else if( subNavTableType == SubNavObjectListTypePicker ) {
                 DTCustomColoredAccessory *accessory = [DTCustomColoredAccessory accessoryWithColor:cell.textLabel.textColor];
                 accessory.highlightedColor = [UIColor whiteColor];
@@ -2064,20 +2392,26 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
                 
                 return cell;
             } else
-                record = [SFVUtil accountFromIndexPath:indexPath accountDictionary:myRecords];
+                record = [SFVUtil accountFromIndexPath:indexPath accountDictionary:myRecords sortedKeys:[self sortedRecordKeys]];
             
-            cell.textLabel.text = [[SFVAppCache sharedSFVAppCache] nameForSObject:record];  
+            SFVFormattedRow *row = [recordWindow rowWithId:[record objectForKey:@"Id"]];
+            
+            cell.textLabel.text = ( row ? [row name] : [[SFVAppCache sharedSFVAppCache] nameForSObject:record] );
             cell.imageView.image = nil;
             cell.accessoryType = UITableViewCellAccessoryNone;
             
             if( subNavTableType == SubNavListOfRemoteRecords ) {
-                if( orderingControl.selectedSegmentIndex <= 0 )
-                    cell.detailTextLabel.text = [[SFVAppCache sharedSFVAppCache] descriptionValueForRecord:record];
-                else if( orderingControl.selectedSegmentIndex == 1 &&
-                            [[orderingControl titleForSegmentAtIndex:1] isEqualToString:NSLocalizedString(@"Created", @"Created")] )
-                    cell.detailTextLabel.text = [SFVUtil relativeTime:[SFVUtil dateFromSOQLDatetime:[record objectForKey:@"CreatedDate"]]];
-                else
-                    cell.detailTextLabel.text = [SFVUtil relativeTime:[SFVUtil dateFromSOQLDatetime:[record objectForKey:@"LastModifiedDate"]]];                        
+                if( orderingControl.selectedSegmentIndex <= 0 ) {
+                    if( row )
+                        cell.detailTextLabel.text = ( [[row values] count] > 0 ? [[row values] objectAtIndex:0] : @"" );
+                    else
+                        cell.detailTextLabel.text = [[SFVAppCache sharedSFVAppCache] descriptionValueForRecord:record];
+                } else {
+                    if( row )
+                        cell.detailTextLabel.text = [SFVUtil relativeTime:[NSDate dateWithTimeIntervalSince1970:[row date]]];
+                    else
+                        cell.detailTextLabel.text = [SFVUtil relativeTime:[NSDate dateWithTimeIntervalSince1970:[SFVUtil timeIntervalFromSOQLDatetime:[record objectForKey:[self orderingDateField]]]]];
+                }
             } else
                 cell.detailTextLabel.text = [[SFVAppCache sharedSFVAppCache] descriptionValueForRecord:record];
             
@@ -2126,7 +2460,7 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
             } else {        
                 arr = [[NSUserDefaults standardUserDefaults] arrayForKey:GlobalObjectOrderingKey];
                 name = ( arr && [arr count] > 0 ? [arr objectAtIndex:indexPath.row] : 
-                        [[SFVUtil sortArray:[self.myRecords allKeys]] objectAtIndex:indexPath.row] );
+                        [[self sortedRecordKeys] objectAtIndex:indexPath.row] );
             }
             
             [self.rootViewController pushSubNavControllerForSObject:name];
@@ -2136,7 +2470,7 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
         case SubNavListOfRemoteRecords:
         case SubNavObjectListTypePicker:              
             if( searching )
-                record = [SFVUtil accountFromIndexPath:indexPath accountDictionary:self.searchResults];
+                record = [SFVUtil accountFromIndexPath:indexPath accountDictionary:self.searchResults sortedKeys:[self sortedSearchKeys]];
             else if( subNavTableType == SubNavObjectListTypePicker ) {
                 self.title = NSLocalizedString(@"Lists", nil);
                 
@@ -2153,8 +2487,16 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
                                                                             sObject:sObjectType];
                 
                 return;
-            } else
-                record = [SFVUtil accountFromIndexPath:indexPath accountDictionary:self.myRecords];
+            } else {
+                record = [SFVUtil accountFromIndexPath:indexPath accountDictionary:self.myRecords sortedKeys:[self sortedRecordKeys]];
+                
+                // The list only holds summaries. If the full record has been evicted, the summary
+                // is still enough to open it by Id.
+                NSDictionary *full = [recordWindow recordWithId:[record objectForKey:@"Id"]];
+                
+                if( full )
+                    record = full;
+            }
             
             if( !record ) {
                 [self.pullRefreshTableViewController.tableView deselectRowAtIndexPath:[self.pullRefreshTableViewController.tableView indexPathForSelectedRow] animated:YES];
@@ -2229,6 +2571,7 @@ static NSString *draggingCellIdentifier = @"DraggingCellIdentifier";
     refreshButton.enabled = NO;
     [DSBezelActivityView newActivityViewForView:self.view];
     [self.myRecords removeAllObjects];
+    [self sectionKeysDidChange];
     [self.pullRefreshTableViewController.tableView reloadData];
     
     if( [self.rootViewController.popoverController isPopoverVisible] )
@@ -30,6 +30,7 @@
 
 #import "NewsTableViewCell.h"
 #import "SFVUtil.h"
+#import "SFVFormatterPool.h"
 #import "RecordNewsViewController.h"
 #import <QuartzCore/QuartzCore.h>
 #import "UIImage+ImageUtils.h"
@@ -116,12 +117,7 @@
     headline.text = [SFVUtil stringByDecodingEntities:[articleJSON objectForKey:@"titleNoFormatting"]];
     
     // article source
-    NSDateFormatter *dateFormat = [[NSDateFormatter alloc] init];
-    [dateFormat setLocale:[NSLocale currentLocale]];
-    [dateFormat setDateFormat:@"EEE, dd MMM yyyy H:m:s Z"];
-    
-    NSDate *date = [dateFormat dateFromString:[articleJSON objectForKey:@"publishedDate"]];
-    [dateFormat release];
+    NSDate *date = [[SFVFormatterPool dateFormatterWithFormat:@"EEE, dd MMM yyyy H:m:s Z"] dateFromString:[articleJSON objectForKey:@"publishedDate"]];
     
     NSString *pubTime = [SFVUtil relativeTime:date];
     
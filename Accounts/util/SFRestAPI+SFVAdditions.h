@@ -56,4 +56,13 @@
                                            failBlock:(SFRestFailBlock)failBlock 
                                        completeBlock:(SFRestDictionaryResponseBlock)completeBlock;
 
+/**
+ * As above, but with refresh set, always describes the object again, even if we have a cached
+ * describe, and replaces the cached and stored describe with the result.
+ */
+- (SFRestRequest *) SFVperformDescribeWithObjectType:(NSString *)objectType 
+                                             refresh:(BOOL)refresh
+                                           failBlock:(SFRestFailBlock)failBlock 
+                                       completeBlock:(SFRestDictionaryResponseBlock)completeBlock;
+
 @end
@@ -49,9 +49,16 @@ FIX_CATEGORY_BUG(SFVAdditions);
 }
 
 - (SFRestRequest *) SFVperformDescribeWithObjectType:(NSString *)objectType failBlock:(SFRestFailBlock)failBlock completeBlock:(SFRestDictionaryResponseBlock)completeBlock {
+    return [self SFVperformDescribeWithObjectType:objectType
+                                          refresh:NO
+                                        failBlock:failBlock
+                                    completeBlock:completeBlock];
+}
+
+- (SFRestRequest *) SFVperformDescribeWithObjectType:(NSString *)objectType refresh:(BOOL)refresh failBlock:(SFRestFailBlock)failBlock completeBlock:(SFRestDictionaryResponseBlock)completeBlock {
     
     // Intercept; read cache first
-    if( kObjectDescribeCacheEnabled ) {
+    if( kObjectDescribeCacheEnabled && !refresh ) {
         NSDictionary *cachedResult = [[SFVAppCache sharedSFVAppCache] cachedDescribeForObject:objectType];
         
         if( completeBlock && cachedResult ) {
@@ -28,6 +28,7 @@
 // This singleton calls out for and caches metadata about apps (tabsets) and tabs
 
 #import <Foundation/Foundation.h>
+#import <pthread.h>
 #import "zkSforce.h"
 
 // fuck yeah semicolons
@@ -36,6 +37,15 @@
 #define kRecordTypeIdField                  @"RecordTypeId"
 #define kRecordTypeRelationshipField        @"RecordType"
 
+@class SFVFieldDescribe, SFVDescribeSnapshot;
+
+// Org-wide features, worked out from the describes the first time they're asked for
+typedef struct {
+    BOOL chatterEnabled;
+    BOOL multiCurrencyEnabled;
+    BOOL personAccountEnabled;
+} SFVOrgCapabilities;
+
 @interface SFVAppCache : NSObject {    
     // Cache of tab sets
     NSMutableArray *appCache;
@@ -46,8 +56,30 @@
     // Global describe cache. key: sObject name
     NSMutableDictionary *globalDescribeCache;
     
+    // Queryable sObjects by key prefix. key: packed prefix (see keyPrefixCode), value: sObject name
+    CFMutableDictionaryRef keyPrefixIndex;
+    
     // Individual object describe cache. key: sObject name
     NSMutableDictionary *objectDescribeCache;
+    
+    // Compiled field describes. key: sObject name, value: dictionary of field name -> SFVFieldDescribe
+    NSMutableDictionary *fieldDescribeCache;
+    
+    // Recomputed when the global describe or the Account describe changes
+    SFVOrgCapabilities orgCapabilities;
+    BOOL orgCapabilitiesValid;
+    
+    NSUInteger describeGeneration;
+    
+    // Replaced whole by the main thread whenever the describes change, read from any thread.
+    // Only read or swapped while holding snapshotLock. That's a mutex rather than a spin lock,
+    // since the main thread spinning on a lock held by a lower priority reader can stall for good.
+    SFVDescribeSnapshot *describeSnapshot;
+    pthread_mutex_t snapshotLock;
+    
+    // Object describes arrive in bursts, so they're published and saved once per run loop pass
+    BOOL describeSnapshotNeedsPublishing;
+    BOOL objectDescribesNeedSaving;
 }
 
 + (SFVAppCache *)sharedSFVAppCache; 
@@ -113,7 +145,8 @@ typedef enum FieldDescribeStringProperties {
     FieldRelationshipName,
     FieldRelationshipOrder,
     FieldControllingFieldName,
-    FieldType
+    FieldType,
+    FieldNumStringProperties
 } FieldDescribeStringProperty;
 
 // Arrays to return from a field's describe
@@ -127,9 +160,36 @@ typedef enum FieldDescribeNumberProperties {
     FieldDigits = 0,
     FieldLength,
     FieldPrecision,
-    FieldScale
+    FieldScale,
+    FieldNumNumberProperties
 } FieldDescribeNumberProperty;
 
+// A field's data type, the 'type' of its describe
+typedef enum FieldDescribeDataTypes {
+    FieldDataTypeUnknown = 0,
+    FieldDataTypeString,
+    FieldDataTypeTextArea,
+    FieldDataTypeBoolean,
+    FieldDataTypeInteger,
+    FieldDataTypeDouble,
+    FieldDataTypeCurrency,
+    FieldDataTypePercent,
+    FieldDataTypeDate,
+    FieldDataTypeDateTime,
+    FieldDataTypeTime,
+    FieldDataTypePicklist,
+    FieldDataTypeMultiPicklist,
+    FieldDataTypeComboBox,
+    FieldDataTypeReference,
+    FieldDataTypeId,
+    FieldDataTypeEmail,
+    FieldDataTypePhone,
+    FieldDataTypeURL,
+    FieldDataTypeBase64,
+    FieldDataTypeEncryptedString,
+    FieldDataTypeAnyType
+} FieldDescribeDataType;
+
 // util
 
 + (NSString *) valueOrEmptyStringForString:(id)string;
@@ -139,6 +199,10 @@ typedef enum FieldDescribeNumberProperties {
 - (BOOL) isLoaded;
 - (void) emptyCaches;
 
+// Synchronously fill the caches from the metadata store, returns NO if the store didn't
+// have enough to go on. Anything cached after this is also written back to the store.
+- (BOOL) loadCachesFromMetadataStore;
+
 // caching. these expect REST (NSDictionary) responses, not SOAP (zksforce) responses
 
 - (void) cacheTabSetResults:(NSArray *)results;
@@ -167,6 +231,17 @@ typedef enum FieldDescribeNumberProperties {
 
 // global describe sObjects
 
+- (SFVOrgCapabilities) orgCapabilities;
+
+// Goes up every time a global or object describe is cached, or the caches are emptied,
+// so anything derived from the describes can tell when it's stale.
+@property (nonatomic, readonly) NSUInteger describeGeneration;
+
+// The describes as of the last time they changed. Safe to call from any thread, though off the
+// main thread a describe cached on this run loop pass may not be in it yet.
+// Take one at the start of a job and use it throughout, so the whole job sees the same metadata.
+- (SFVDescribeSnapshot *) describeSnapshot;
+
 - (BOOL) isMultiCurrencyEnabled;
 - (BOOL) isChatterEnabled;
 - (BOOL) doesGlobalObject:(NSString *)object haveProperty:(GlobalDescribeBooleanProperty)property;
@@ -187,6 +262,9 @@ typedef enum FieldDescribeNumberProperties {
 - (NSDictionary *) describeGlobalsObject:(NSString *)sObject;
 - (NSString *) sObjectFromRecordId:(NSString *)recordId;
 
+// sObject name for each record Id, in the same order, NSNull for Ids we can't resolve
+- (NSArray *) sObjectsFromRecordIds:(NSArray *)recordIds;
+
 // describing individual objects
 
 // check cache
@@ -198,12 +276,14 @@ typedef enum FieldDescribeNumberProperties {
 - (BOOL) doesField:(NSString *)field onObject:(NSString *)object haveProperty:(FieldDescribeBooleanProperty)property;
 - (NSString *) object:(NSString *)object stringProperty:(ObjectDescribeStringProperty)property;
 - (NSDictionary *) describeForField:(NSString *)field onObject:(NSString *)object;
+- (SFVFieldDescribe *) compiledDescribeForField:(NSString *)field onObject:(NSString *)object;
 
 
 // fields
 - (NSArray *) field:(NSString *)field onObject:(NSString *)object arrayProperty:(FieldDescribeArrayProperty)property;
 - (NSString *) field:(NSString *)field onObject:(NSString *)object stringProperty:(FieldDescribeStringProperty)property;
 - (NSInteger) field:(NSString *)field onObject:(NSString *)object numberProperty:(FieldDescribeNumberProperty)property;
+- (FieldDescribeDataType) dataTypeForField:(NSString *)field onObject:(NSString *)object;
 
 - (NSString *) nameFieldForsObject:(NSString *)sObject;
 - (NSString *) nameForSObject:(NSDictionary *)object;
@@ -221,4 +301,55 @@ typedef enum FieldDescribeNumberProperties {
 - (NSString *) webURLForURL:(NSString *)url;
 
 
+
+@end
+
+// An unchanging copy of the describes SFVAppCache had when it was taken. Nothing in it is ever
+// modified, so it can be read from any thread while the cache itself moves on. Its answers are the
+// same as SFVAppCache's for the same describes.
+@interface SFVDescribeSnapshot : NSObject {
+    NSUInteger generation;
+    
+    // key: sObject name, value: global describe
+    NSDictionary *globalDescribes;
+    
+    // key: sObject name, value: object describe, as cached by SFVAppCache
+    NSDictionary *objectDescribes;
+    
+    // key: sObject name, value: dictionary of field name -> SFVFieldDescribe
+    NSDictionary *fieldDescribes;
+    
+    // key: sObject name, value: name field
+    NSDictionary *nameFields;
+    
+    // same as SFVAppCache's, never modified once we have it
+    CFDictionaryRef keyPrefixIndex;
+    
+    SFVOrgCapabilities orgCapabilities;
+}
+
+// The describeGeneration this was taken at
+@property (nonatomic, readonly) NSUInteger generation;
+
+@property (nonatomic, readonly) SFVOrgCapabilities orgCapabilities;
+
+// key: sObject name, value: object describe. Immutable.
+@property (nonatomic, readonly) NSDictionary *objectDescribes;
+
+- (BOOL) doesGlobalObject:(NSString *)object haveProperty:(GlobalDescribeBooleanProperty)property;
+- (NSString *) globalObject:(NSString *)object property:(GlobalDescribeStringProperty)property;
+- (NSString *) sObjectFromRecordId:(NSString *)recordId;
+
+- (NSDictionary *) cachedDescribeForObject:(NSString *)object;
+- (NSArray *) namesOfFieldsOnObject:(NSString *)object;
+
+- (SFVFieldDescribe *) compiledDescribeForField:(NSString *)field onObject:(NSString *)object;
+- (BOOL) doesField:(NSString *)field onObject:(NSString *)object haveProperty:(FieldDescribeBooleanProperty)property;
+- (NSString *) field:(NSString *)field onObject:(NSString *)object stringProperty:(FieldDescribeStringProperty)property;
+- (NSArray *) field:(NSString *)field onObject:(NSString *)object arrayProperty:(FieldDescribeArrayProperty)property;
+- (FieldDescribeDataType) dataTypeForField:(NSString *)field onObject:(NSString *)object;
+
+- (NSString *) nameFieldForsObject:(NSString *)sObject;
+- (NSString *) nameForSObject:(NSDictionary *)object;
+
 @end
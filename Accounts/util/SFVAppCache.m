@@ -33,9 +33,31 @@
 #import "SFVAsync.h"
 #import "NSData+Base64.h"
 #import "UIImage+ImageUtils.h"
+#import "SFVMetadataStore.h"
+#import "SFVFieldDescribe.h"
+
+@interface SFVAppCache (Private)
+- (void) loadGlobalDescribeResults:(NSDictionary *)results;
+- (void) loadTabSetResults:(NSArray *)results;
+- (void) compileFieldsForDescribe:(NSDictionary *)describe;
+- (SFVOrgCapabilities) computeOrgCapabilities;
+- (void) publishDescribeSnapshot;
+- (void) setNeedsPublishDescribeSnapshot;
+@end
+
+@interface SFVDescribeSnapshot (Private)
+- (id) initWithGeneration:(NSUInteger)aGeneration
+          globalDescribes:(NSDictionary *)globals
+          objectDescribes:(NSDictionary *)objects
+           fieldDescribes:(NSDictionary *)fields
+               nameFields:(NSDictionary *)names
+           keyPrefixIndex:(CFDictionaryRef)prefixes;
+@end
 
 @implementation SFVAppCache
 
+@synthesize describeGeneration;
+
 static NSString *kFieldsKey = @"fields";
 static NSString *kNameField = @"name";
 
@@ -44,11 +66,96 @@ static NSString *kReferenceToKey = @"referenceTo";
 static NSString *kRelatedObjectsArrayKey = @"relatedObjects";
 static NSString *kNameFieldKey = @"nameField";
 
+// sections in the metadata store
+static NSString *kGlobalDescribeSection = @"globalDescribe";
+static NSString *kObjectDescribeSection = @"objectDescribes";
+static NSString *kTabSetSection = @"tabSets";
+
 // dictionary where key = controlling parent value, value = array of valid child values
 //static NSString *kDependentPicklistDictionaryKey = @"dependentPicklistDictionary";
 
 SYNTHESIZE_SINGLETON_FOR_CLASS(SFVAppCache);
 
+// Key prefixes are three ASCII characters, so we pack them into an integer rather than
+// make a substring for every lookup. Returns 0 for anything that isn't ASCII.
+static inline uintptr_t keyPrefixCode(NSString *str) {
+    unichar c[3];
+    
+    if( [str length] < 3 )
+        return 0;
+    
+    [str getCharacters:c range:NSMakeRange(0, 3)];
+    
+    if( c[0] > 0x7F || c[1] > 0x7F || c[2] > 0x7F )
+        return 0;
+    
+    return ( (uintptr_t)c[0] << 16 ) | ( (uintptr_t)c[1] << 8 ) | (uintptr_t)c[2];
+}
+
+static NSString *globalBooleanKey(GlobalDescribeBooleanProperty property) {
+    switch( property ) {
+        case GlobalObjectIsQueryable:
+            return @"queryable";
+        case GlobalObjectIsLayoutable:
+            return @"layoutable";
+        case GlobalObjectIsSearchable:
+            return @"searchable";
+        case GlobalObjectIsFeedEnabled:
+            return @"feedEnabled";
+        case GlobalObjectIsCustom:
+            return @"custom";
+        case GlobalObjectIsDeletable:
+            return @"deletable";
+    }
+    
+    return nil;
+}
+
+static NSString *globalStringKey(GlobalDescribeStringProperty property) {
+    switch( property ) {
+        case GlobalObjectName:
+            return @"name";
+        case GlobalObjectKeyPrefix:
+            return @"keyPrefix";
+        case GlobalObjectLabel:
+            return @"label";
+        case GlobalObjectLabelPlural:
+            return @"labelPlural";
+    }
+    
+    return nil;
+}
+
+static SFVOrgCapabilities capabilitiesForDescribes(NSDictionary *globals, NSDictionary *fields) {
+    SFVOrgCapabilities caps = { NO, NO, NO };
+    
+    if( globals ) {
+        for( NSDictionary *ob in [globals allValues] )
+            if( [[ob objectForKey:@"feedEnabled"] boolValue] ) {
+                caps.chatterEnabled = YES;
+                break;
+            }
+        
+        caps.multiCurrencyEnabled = [globals objectForKey:@"CurrencyType"] != nil;
+    }
+    
+    caps.personAccountEnabled = [[fields objectForKey:@"Account"] objectForKey:@"PersonContactId"] != nil;
+    
+    return caps;
+}
+
+static NSString *sObjectForKeyPrefix(CFDictionaryRef index, NSString *recordId) {
+    if( !index || ![recordId isKindOfClass:[NSString class]] || [recordId length] < 15 )
+        return nil; // local record
+    
+    uintptr_t code = keyPrefixCode(recordId);
+    
+    if( !code )
+        return nil;
+    
+    return (NSString *)CFDictionaryGetValue(index, (const void *)code);
+}
+
 + (NSString *)valueOrEmptyStringForString:(id)string {
     if( !string || [SFVUtil isEmpty:string] )
         return @"";
@@ -58,23 +165,93 @@ SYNTHESIZE_SINGLETON_FOR_CLASS(SFVAppCache);
 
 #pragma mark - init
 
+- (id) init {
+    if(( self = [super init] )) {
+        pthread_mutex_init(&snapshotLock, NULL);
+        [self publishDescribeSnapshot];
+    }
+    
+    return self;
+}
+
 - (BOOL) isLoaded {
     return appCache != nil;
 }
 
+- (BOOL) loadCachesFromMetadataStore {
+    SFVMetadataStore *store = [SFVMetadataStore sharedSFVMetadataStore];
+    NSDictionary *globalDescribe = [store objectForSection:kGlobalDescribeSection];
+    NSArray *tabSets = [store objectForSection:kTabSetSection];
+    
+    // we need both of these to draw anything useful
+    if( !globalDescribe || !tabSets )
+        return NO;
+    
+    [self loadGlobalDescribeResults:globalDescribe];
+    [self loadTabSetResults:tabSets];
+    
+    NSDictionary *describes = [store objectForSection:kObjectDescribeSection];
+    
+    SFRelease(objectDescribeCache);
+    SFRelease(fieldDescribeCache);
+    
+    if( describes )
+        objectDescribeCache = [describes mutableCopy];
+    
+    for( NSDictionary *describe in [describes allValues] )
+        [self compileFieldsForDescribe:describe];
+    
+    orgCapabilitiesValid = NO;
+    [self publishDescribeSnapshot];
+    
+    return YES;
+}
+
 #pragma mark - caching
 
-- (void)cacheGlobalDescribeResults:(NSDictionary *)results {    
+- (void)cacheGlobalDescribeResults:(NSDictionary *)results {
+    [self loadGlobalDescribeResults:results];
+    [self publishDescribeSnapshot];
+    [[SFVMetadataStore sharedSFVMetadataStore] setObject:results forSection:kGlobalDescribeSection];
+}
+
+- (void)loadGlobalDescribeResults:(NSDictionary *)results {    
     if( globalDescribeCache )
         SFRelease(globalDescribeCache);
     
     globalDescribeCache = [[NSMutableDictionary dictionary] retain];
+    orgCapabilitiesValid = NO;
+    describeGeneration++;
+    
+    if( keyPrefixIndex )
+        CFRelease(keyPrefixIndex);
     
-    for( NSDictionary *object in [results objectForKey:@"sobjects"] )
-        [globalDescribeCache setObject:object forKey:[object objectForKey:kNameField]];
+    // keys are small integers, not objects
+    keyPrefixIndex = CFDictionaryCreateMutable(NULL, 0, NULL, &kCFTypeDictionaryValueCallBacks);
+    
+    for( NSDictionary *object in [results objectForKey:@"sobjects"] ) {
+        NSString *name = [object objectForKey:kNameField];
+        
+        [globalDescribeCache setObject:object forKey:name];
+        
+        // a few prefixes are shared between objects, the first queryable one wins
+        NSString *prefix = [object objectForKey:@"keyPrefix"];
+        uintptr_t code = ( [SFVUtil isEmpty:prefix] ? 0 : keyPrefixCode(prefix) );
+        
+        if( code && [[object objectForKey:@"queryable"] boolValue] 
+            && !CFDictionaryContainsKey(keyPrefixIndex, (const void *)code) )
+            CFDictionarySetValue(keyPrefixIndex, (const void *)code, name);
+    }
 }
 
-- (void)cacheTabSetResults:(NSArray *)results {    
+- (void)cacheTabSetResults:(NSArray *)results {
+    [self loadTabSetResults:results];
+    
+    if( results )
+        [[SFVMetadataStore sharedSFVMetadataStore] setObject:results forSection:kTabSetSection];
+}
+
+- (void)loadTabSetResults:(NSArray *)results {    
     if( appCache )
         SFRelease(appCache);
     
@@ -168,6 +345,30 @@ SYNTHESIZE_SINGLETON_FOR_CLASS(SFVAppCache);
         objectDescribeCache = [[NSMutableDictionary dictionaryWithObject:describe 
                                                                   forKey:[describe objectForKey:kNameField]] 
                                retain];
+    
+    [self compileFieldsForDescribe:describe];
+    
+    // person accounts show up in the Account describe
+    if( [[describe objectForKey:kNameField] isEqualToString:@"Account"] )
+        orgCapabilitiesValid = NO;
+    
+    objectDescribesNeedSaving = YES;
+    [self setNeedsPublishDescribeSnapshot];
+}
+
+- (void) compileFieldsForDescribe:(NSDictionary *)describe {
+    NSDictionary *fields = [describe objectForKey:kFieldsKey];
+    NSMutableDictionary *compiled = [NSMutableDictionary dictionaryWithCapacity:[fields count]];
+    
+    for( NSString *field in fields )
+        [compiled setObject:[SFVFieldDescribe fieldDescribeWithDictionary:[fields objectForKey:field]]
+                     forKey:field];
+    
+    if( !fieldDescribeCache )
+        fieldDescribeCache = [[NSMutableDictionary alloc] init];
+    
+    [fieldDescribeCache setObject:compiled forKey:[describe objectForKey:kNameField]];
+    describeGeneration++;
 }
 
 - (void) emptyCaches {
@@ -183,6 +384,78 @@ SYNTHESIZE_SINGLETON_FOR_CLASS(SFVAppCache);
     
     [objectDescribeCache removeAllObjects];
     SFRelease(objectDescribeCache);
+    
+    [fieldDescribeCache removeAllObjects];
+    SFRelease(fieldDescribeCache);
+    
+    orgCapabilitiesValid = NO;
+    describeGeneration++;
+    
+    if( keyPrefixIndex ) {
+        CFRelease(keyPrefixIndex);
+        keyPrefixIndex = NULL;
+    }
+    
+    // Nothing left to save, and publishing now drops any pending publish
+    objectDescribesNeedSaving = NO;
+    [self publishDescribeSnapshot];
+}
+
+// Logging in describes dozens of objects back to back, and rebuilding the snapshot for each one
+// copies every describe we have each time. Instead we publish once, on the next run loop pass.
+- (void) setNeedsPublishDescribeSnapshot {
+    if( describeSnapshotNeedsPublishing )
+        return;
+    
+    describeSnapshotNeedsPublishing = YES;
+    [self performSelector:@selector(publishDescribeSnapshot) 
+               withObject:nil 
+               afterDelay:0];
+}
+
+// Only ever called on the main thread, after the caches have changed. Every dictionary that
+// goes into a snapshot is either copied here or replaced rather than changed later on.
+- (void) publishDescribeSnapshot {
+    NSMutableDictionary *names = nil;
+    
+    if( objectDescribeCache ) {
+        names = [NSMutableDictionary dictionaryWithCapacity:[objectDescribeCache count]];
+        
+        for( NSString *sObject in objectDescribeCache ) {
+            NSString *nameField = [[objectDescribeCache objectForKey:sObject] objectForKey:kNameFieldKey];
+            
+            if( nameField )
+                [names setObject:nameField forKey:sObject];
+        }
+    }
+    
+    SFVDescribeSnapshot *snapshot = [[SFVDescribeSnapshot alloc] initWithGeneration:describeGeneration
+                                                                    globalDescribes:globalDescribeCache
+                                                                    objectDescribes:objectDescribeCache
+                                                                     fieldDescribes:fieldDescribeCache
+                                                                         nameFields:names
+                                                                     keyPrefixIndex:keyPrefixIndex];
+    
+    pthread_mutex_lock(&snapshotLock);
+    SFVDescribeSnapshot *old = describeSnapshot;
+    describeSnapshot = snapshot;
+    pthread_mutex_unlock(&snapshotLock);
+    
+    // Every reader that got the old snapshot retained it under the lock, so it's ours to let go
+    [old release];
+    
+    if( describeSnapshotNeedsPublishing ) {
+        [NSObject cancelPreviousPerformRequestsWithTarget:self 
+                                                 selector:@selector(publishDescribeSnapshot) 
+                                                   object:nil];
+        describeSnapshotNeedsPublishing = NO;
+    }
+    
+    // The snapshot's copy is never changed, so the store keeps it as it is instead of copying it again
+    if( objectDescribesNeedSaving ) {
+        [[SFVMetadataStore sharedSFVMetadataStore] setObject:[snapshot objectDescribes] forSection:kObjectDescribeSection];
+        objectDescribesNeedSaving = NO;
+    }
 }
 
 #pragma mark - apps
@@ -300,22 +573,39 @@ SYNTHESIZE_SINGLETON_FOR_CLASS(SFVAppCache);
     return [[[globalDescribeCache objectForKey:sObject] copy] autorelease];
 }
 
-- (BOOL) isChatterEnabled {
-    if( !globalDescribeCache )
-        return NO;
-    
-    for( NSString *ob in [self allGlobalSObjects] )
-        if( [self doesGlobalObject:ob haveProperty:GlobalObjectIsFeedEnabled] )
-            return YES;
+- (SFVOrgCapabilities) computeOrgCapabilities {
+    return capabilitiesForDescribes(globalDescribeCache, fieldDescribeCache);
+}
+
+- (SFVOrgCapabilities) orgCapabilities {
+    if( !orgCapabilitiesValid ) {
+        orgCapabilities = [self computeOrgCapabilities];
+        orgCapabilitiesValid = YES;
+    }
     
-    return NO;
+    return orgCapabilities;
+}
+
+- (SFVDescribeSnapshot *) describeSnapshot {
+    // Code on the main thread may have just cached a describe, so it shouldn't wait for the next pass
+    if( describeSnapshotNeedsPublishing && [NSThread isMainThread] )
+        [self publishDescribeSnapshot];
+    
+    // The retain has to happen under the lock, or the main thread could release this snapshot
+    // between our reading the pointer and retaining it
+    pthread_mutex_lock(&snapshotLock);
+    SFVDescribeSnapshot *snapshot = [describeSnapshot retain];
+    pthread_mutex_unlock(&snapshotLock);
+    
+    return [snapshot autorelease];
+}
+
+- (BOOL) isChatterEnabled {
+    return [self orgCapabilities].chatterEnabled;
 }
 
 - (BOOL)isMultiCurrencyEnabled {
-    if( !globalDescribeCache )
-        return NO;
-    
-    return [[self allGlobalSObjects] containsObject:@"CurrencyType"];
+    return [self orgCapabilities].multiCurrencyEnabled;
 }
 
 - (BOOL)doesGlobalObject:(NSString *)object haveProperty:(GlobalDescribeBooleanProperty)property {
@@ -327,28 +617,7 @@ SYNTHESIZE_SINGLETON_FOR_CLASS(SFVAppCache);
     if( !ob )
         return NO;
     
-    NSString *key = nil;
-    
-    switch( property ) {
-        case GlobalObjectIsQueryable:
-            key = @"queryable";
-            break;
-        case GlobalObjectIsLayoutable:
-            key = @"layoutable";
-            break;
-        case GlobalObjectIsSearchable:
-            key = @"searchable";
-            break;
-        case GlobalObjectIsFeedEnabled:
-            key = @"feedEnabled";
-            break;
-        case GlobalObjectIsCustom:
-            key = @"custom";
-            break;
-        case GlobalObjectIsDeletable:
-            key = @"deletable";
-            break;
-    }
+    NSString *key = globalBooleanKey(property);
     
     if( [SFVUtil isEmpty:[ob objectForKey:key]] )
         return NO;
@@ -365,22 +634,7 @@ SYNTHESIZE_SINGLETON_FOR_CLASS(SFVAppCache);
     if( !ob )
         return nil;
     
-    NSString *key = nil;
-    
-    switch( property ) {
-        case GlobalObjectName:
-            key = @"name";
-            break;
-        case GlobalObjectKeyPrefix:
-            key = @"keyPrefix";
-            break;
-        case GlobalObjectLabel:
-            key = @"label";
-            break;
-        case GlobalObjectLabelPlural:
-            key = @"labelPlural";
-            break;
-    }
+    NSString *key = globalStringKey(property);
     
     if( [SFVUtil isEmpty:[ob objectForKey:key]] )
         return nil;
@@ -393,17 +647,20 @@ SYNTHESIZE_SINGLETON_FOR_CLASS(SFVAppCache);
 }
 
 - (NSString *) sObjectFromRecordId:(NSString *)recordId {
-    if( !recordId || [recordId length] < 15 )
-        return nil; // local record
-    
-    NSString *prefix = [recordId substringToIndex:3];
+    return sObjectForKeyPrefix(keyPrefixIndex, recordId);
+}
+
+- (NSArray *) sObjectsFromRecordIds:(NSArray *)recordIds {
+    NSMutableArray *ret = [NSMutableArray arrayWithCapacity:[recordIds count]];
+    NSNull *null = [NSNull null];
     
-    for( NSString *sObject in [self allGlobalSObjects] )
-        if( [self doesGlobalObject:sObject haveProperty:GlobalObjectIsQueryable] &&
-            [[self globalObject:sObject property:GlobalObjectKeyPrefix] isEqualToString:prefix] )
-            return sObject;
+    for( NSString *recordId in recordIds ) {
+        NSString *sObject = [self sObjectFromRecordId:recordId];
+        
+        [ret addObject:( sObject ? sObject : null )];
+    }
     
-    return nil;
+    return ret;
 }
 
 - (UIImage *) imageForSObject:(NSString *)sObject {
@@ -442,7 +699,7 @@ SYNTHESIZE_SINGLETON_FOR_CLASS(SFVAppCache);
 #pragma mark - describing individual objects
 
 - (BOOL)isPersonAccountEnabled {
-    return [self describeForField:@"PersonContactId" onObject:@"Account"] != nil;
+    return [self orgCapabilities].personAccountEnabled;
 }
 
 - (BOOL)doesObject:(NSString *)object haveProperty:(ObjectDescribeBooleanProperty)property {
@@ -516,12 +773,15 @@ SYNTHESIZE_SINGLETON_FOR_CLASS(SFVAppCache);
     return [ob objectForKey:key];
 }
 
-- (NSDictionary *)describeForField:(NSString *)field onObject:(NSString *)object {
-    if( !field || !object || !objectDescribeCache )
+- (SFVFieldDescribe *)compiledDescribeForField:(NSString *)field onObject:(NSString *)object {
+    if( !field || !object || !fieldDescribeCache )
         return nil;
     
-    return [[objectDescribeCache objectForKey:object] valueForKeyPath:[NSString stringWithFormat:@"%@.%@", 
-                                                                       kFieldsKey, field]];
+    return [[fieldDescribeCache objectForKey:object] objectForKey:field];
+}
+
+- (NSDictionary *)describeForField:(NSString *)field onObject:(NSString *)object {
+    return [[self compiledDescribeForField:field onObject:object] describe];
 }
 
 - (NSArray *)namesOfFieldsOnObject:(NSString *)object {
@@ -537,139 +797,23 @@ SYNTHESIZE_SINGLETON_FOR_CLASS(SFVAppCache);
 }
 
 - (BOOL)doesField:(NSString *)field onObject:(NSString *)object haveProperty:(FieldDescribeBooleanProperty)property {
-    NSDictionary *fieldDesc = [self describeForField:field onObject:object];
-    
-    if( !fieldDesc )
-        return NO;
-    
-    NSString *key = nil;
-    
-    switch( property ) {
-        case FieldIsCustom:
-            key = @"custom";
-            break;
-        case FieldIsHTML:
-            key = @"htmlFormatted";
-            break;
-        case FieldIsCreateable:
-            key = @"createable";
-            break;
-        case FieldIsUpdateable:
-            key = @"updateable";
-            break;
-        case FieldIsNameField:
-            key = @"nameField";
-            break;
-        case FieldIsFormulaField:
-            key = @"calculated";
-            break;
-        case FieldIsNillable:
-            key = @"nillable";
-            break;
-        case FieldIsDependentPicklist:
-            key = @"dependentPicklist";
-            break;
-        case FieldIsReferenceField:
-            return [[self field:field onObject:object stringProperty:FieldType] isEqualToString:@"reference"];
-        case FieldIsRestrictedPicklist:
-            key = @"restrictedPicklist";
-            break;
-    }
-    
-    if( [fieldDesc objectForKey:key] )    
-        return [[fieldDesc objectForKey:key] boolValue];
-    
-    return NO;
+    return [[self compiledDescribeForField:field onObject:object] hasProperty:property];
 }
 
 - (NSString *)field:(NSString *)field onObject:(NSString *)object stringProperty:(FieldDescribeStringProperty)property {
-    NSDictionary *fieldDesc = [self describeForField:field onObject:object];
-    
-    if( !fieldDesc )
-        return nil;
-    
-    NSString *key = nil;
-    
-    switch( property ) {
-        case FieldName:
-            key = @"name";
-            break;
-        case FieldLabel:
-            key = @"label";
-            break;
-        case FieldType:
-            key = @"type";
-            break;
-        case FieldDefaultValue:
-            key = @"defaultValue";
-            break;
-        case FieldCalculatedFormula:
-            key = @"calculatedFormula";
-            break;
-        case FieldInlineHelpText:
-            key = @"inlineHelpText";
-            break;
-        case FieldDefaultValueFormula:
-            key = @"defaultValueFormula";
-            break;
-        case FieldRelationshipName:
-            key = @"relationshipName";
-            break;
-        case FieldRelationshipOrder:
-            key = @"relationshipOrder";
-            break;
-        case FieldControllingFieldName:
-            key = @"controllerName";
-            break;
-    }
-    
-    return [SFVAppCache valueOrEmptyStringForString:[fieldDesc objectForKey:key]];
+    return [[self compiledDescribeForField:field onObject:object] stringProperty:property];
 }
 
 - (NSArray *)field:(NSString *)field onObject:(NSString *)object arrayProperty:(FieldDescribeArrayProperty)property {
-    NSDictionary *fieldDesc = [self describeForField:field onObject:object];
-    
-    if( !fieldDesc )
-        return nil;
-    
-    NSString *key = nil;
-    
-    switch( property ) {
-        case FieldReferenceTo:
-            key = kReferenceToKey;
-            break;
-        case FieldPicklistValues:
-            key = @"picklistValues";
-            break;
-    }
-    
-    return [[(NSArray *)[fieldDesc objectForKey:key] copy] autorelease];
+    return [[self compiledDescribeForField:field onObject:object] arrayProperty:property];
 }
 
 - (NSInteger)field:(NSString *)field onObject:(NSString *)object numberProperty:(FieldDescribeNumberProperty)property {
-    NSDictionary *fieldDesc = [self describeForField:field onObject:object];
-    
-    if( !fieldDesc )
-        return 0;
-    
-    NSString *key = nil;
-    
-    switch( property ) {
-        case FieldScale:
-            key = @"scale";
-            break;
-        case FieldDigits:
-            key = @"digits";
-            break;
-        case FieldLength:
-            key = @"length";
-            break;
-        case FieldPrecision:
-            key = @"precision";
-            break;
-    }
-    
-    return [[fieldDesc objectForKey:key] integerValue];
+    return [[self compiledDescribeForField:field onObject:object] numberProperty:property];
+}
+
+- (FieldDescribeDataType)dataTypeForField:(NSString *)field onObject:(NSString *)object {
+    return [[self compiledDescribeForField:field onObject:object] dataType];
 }
 
 - (NSString *)nameFieldForsObject:(NSString *)sObject {
@@ -788,3 +932,122 @@ SYNTHESIZE_SINGLETON_FOR_CLASS(SFVAppCache);
 }
 
 @end
+
+@implementation SFVDescribeSnapshot
+
+@synthesize generation, orgCapabilities, objectDescribes;
+
+- (id) initWithGeneration:(NSUInteger)aGeneration
+          globalDescribes:(NSDictionary *)globals
+          objectDescribes:(NSDictionary *)objects
+           fieldDescribes:(NSDictionary *)fields
+               nameFields:(NSDictionary *)names
+           keyPrefixIndex:(CFDictionaryRef)prefixes {
+    if(( self = [super init] )) {
+        generation = aGeneration;
+        globalDescribes = [globals copy];
+        objectDescribes = [objects copy];
+        fieldDescribes = [fields copy];
+        nameFields = [names copy];
+        orgCapabilities = capabilitiesForDescribes(globalDescribes, fieldDescribes);
+        
+        if( prefixes )
+            keyPrefixIndex = (CFDictionaryRef)CFRetain(prefixes);
+    }
+    
+    return self;
+}
+
+- (void) dealloc {
+    SFRelease(globalDescribes);
+    SFRelease(objectDescribes);
+    SFRelease(fieldDescribes);
+    SFRelease(nameFields);
+    
+    if( keyPrefixIndex )
+        CFRelease(keyPrefixIndex);
+    
+    [super dealloc];
+}
+
+#pragma mark - global describes
+
+- (BOOL) doesGlobalObject:(NSString *)object haveProperty:(GlobalDescribeBooleanProperty)property {
+    NSDictionary *ob = ( object ? [globalDescribes objectForKey:object] : nil );
+    
+    if( !ob || [SFVUtil isEmpty:[ob objectForKey:globalBooleanKey(property)]] )
+        return NO;
+    
+    return [[ob objectForKey:globalBooleanKey(property)] boolValue];
+}
+
+- (NSString *) globalObject:(NSString *)object property:(GlobalDescribeStringProperty)property {
+    NSDictionary *ob = ( object ? [globalDescribes objectForKey:object] : nil );
+    
+    if( !ob || [SFVUtil isEmpty:[ob objectForKey:globalStringKey(property)]] )
+        return nil;
+    
+    return [ob objectForKey:globalStringKey(property)];
+}
+
+- (NSString *) sObjectFromRecordId:(NSString *)recordId {
+    return sObjectForKeyPrefix(keyPrefixIndex, recordId);
+}
+
+#pragma mark - object describes
+
+- (NSDictionary *) cachedDescribeForObject:(NSString *)object {
+    return ( object ? [objectDescribes objectForKey:object] : nil );
+}
+
+- (NSArray *) namesOfFieldsOnObject:(NSString *)object {
+    return [[[self cachedDescribeForObject:object] objectForKey:kFieldsKey] allKeys];
+}
+
+- (SFVFieldDescribe *) compiledDescribeForField:(NSString *)field onObject:(NSString *)object {
+    if( !field || !object )
+        return nil;
+    
+    return [[fieldDescribes objectForKey:object] objectForKey:field];
+}
+
+- (BOOL) doesField:(NSString *)field onObject:(NSString *)object haveProperty:(FieldDescribeBooleanProperty)property {
+    return [[self compiledDescribeForField:field onObject:object] hasProperty:property];
+}
+
+- (NSString *) field:(NSString *)field onObject:(NSString *)object stringProperty:(FieldDescribeStringProperty)property {
+    return [[self compiledDescribeForField:field onObject:object] stringProperty:property];
+}
+
+- (NSArray *) field:(NSString *)field onObject:(NSString *)object arrayProperty:(FieldDescribeArrayProperty)property {
+    return [[self compiledDescribeForField:field onObject:object] arrayProperty:property];
+}
+
+- (FieldDescribeDataType) dataTypeForField:(NSString *)field onObject:(NSString *)object {
+    return [[self compiledDescribeForField:field onObject:object] dataType];
+}
+
+#pragma mark - names
+
+- (NSString *) nameFieldForsObject:(NSString *)sObject {
+    if( !nameFields || !sObject || [sObject isEqualToString:@"Name"] )
+        return [kNameField capitalizedString];
+    
+    NSString *nameField = [nameFields objectForKey:sObject];
+    
+    return ( nameField ? nameField : @"Id" );
+}
+
+- (NSString *) nameForSObject:(NSDictionary *)object {
+    if( [SFVUtil isEmpty:object] )
+        return @"";
+    
+    NSString *objectType = [object objectForKey:kObjectTypeKey];
+    
+    if( !objectType )
+        objectType = [self sObjectFromRecordId:[object objectForKey:@"Id"]];
+    
+    return [SFVAppCache valueOrEmptyStringForString:[object objectForKey:[self nameFieldForsObject:objectType]]];
+}
+
+@end
@@ -101,6 +101,22 @@ typedef void (^SFVDictionaryCompleteBlock) (NSDictionary *results);
                       failBlock:(SFVFailBlock)failBlock 
                   completeBlock:(void(^)(id results))completeBlock;
 
+// Cancelling requests.
+// Any request started with an owner is cancelled when cancelRequestsForOwner: is called
+// (e.g. when a flying window is closed). A cancelled request never calls its fail or complete block.
+// The owner's blocks usually retain it, so it won't be deallocated while its requests are
+// outstanding: owners have to cancel explicitly when they go away.
+// A nil owner gets a fresh token that nothing else will cancel.
++ (ZKCancellationToken *) cancellationTokenForOwner:(id)owner;
++ (void) cancelRequestsForOwner:(id)owner;
+
+// Same as above, but the operation is cancelled along with the owner's other requests.
+// The operation still blocks a background thread while it runs, prefer the non-blocking calls below.
++ (void) performSFVAsyncRequest:(NSObject *(^)(void))operation 
+                          owner:(id)owner
+                      failBlock:(SFVFailBlock)failBlock 
+                  completeBlock:(void(^)(id results))completeBlock;
+
 // Actually execute a SOQL query.
 // query - the query
 // failblock - block executed on fail
@@ -109,11 +125,22 @@ typedef void (^SFVDictionaryCompleteBlock) (NSDictionary *results);
                 failBlock:(SFVFailBlock)failBlock
             completeBlock:(SFVQueryResultCompleteBlock)completeBlock;
 
+// These don't hold a thread while waiting on the server, and are cancelled along with owner.
++ (void) performSOQLQuery:(NSString *)query 
+                    owner:(id)owner
+                failBlock:(SFVFailBlock)failBlock
+            completeBlock:(SFVQueryResultCompleteBlock)completeBlock;
+
 // Execute a querymore
 + (void) performQueryMore:(NSString *)queryLocator
                 failBlock:(SFVFailBlock)failBlock 
             completeBlock:(SFVQueryResultCompleteBlock)completeBlock;
 
++ (void) performQueryMore:(NSString *)queryLocator
+                    owner:(id)owner
+                failBlock:(SFVFailBlock)failBlock 
+            completeBlock:(SFVQueryResultCompleteBlock)completeBlock;
+
 // Actually execute a SOSL query.
 // query - the query
 // failblock - block executed on fail
@@ -134,6 +161,13 @@ typedef void (^SFVDictionaryCompleteBlock) (NSDictionary *results);
                          failBlock:(SFVFailBlock)failBlock 
                      completeBlock:(SFVDictionaryCompleteBlock)completeBlock;
 
++ (void) performRetrieveWithFields:(NSArray *)fields 
+                           sObject:(NSString *)sObject 
+                               ids:(NSArray *)ids 
+                             owner:(id)owner
+                         failBlock:(SFVFailBlock)failBlock 
+                     completeBlock:(SFVDictionaryCompleteBlock)completeBlock;
+
 // Perform a DML insert.
 // sObjects - array of zkSObjects
 // failblock - to be executed on fail
@@ -26,6 +26,48 @@
  */
 
 #import "SFVAsync.h"
+#import <objc/runtime.h>
+#import <libkern/OSAtomic.h>
+
+static char kOwnerTokenKey;
+
+// Attached to an owner as an associated object, so that cancelRequestsForOwner: can find the
+// owner's token. It's cancelled when it's dropped, which is usually by cancelRequestsForOwner:.
+@interface SFVAsyncOwnerToken : NSObject {
+    ZKCancellationToken *token;
+}
+
+@property (nonatomic, readonly) ZKCancellationToken *token;
+
+@end
+
+@implementation SFVAsyncOwnerToken
+
+@synthesize token;
+
+- (id) init {
+    if(( self = [super init] ))
+        token = [[ZKCancellationToken alloc] init];
+    
+    return self;
+}
+
+- (void) dealloc {
+    [token cancel];
+    SFRelease(token);
+    [super dealloc];
+}
+
+@end
+
+@interface SFVAsync (Private)
+
++ (void) performZKAsyncRequest:(void (^)(ZKCancellationToken *token, void (^doneBlock)(id results), ZKFailBlock errorBlock))operation
+                         owner:(id)owner
+                     failBlock:(SFVFailBlock)failBlock
+                 completeBlock:(void(^)(id results))completeBlock;
+
+@end
 
 @implementation SFVAsync
 
@@ -177,15 +219,56 @@
     return query;
 }
 
+#pragma mark - cancellation
+
++ (ZKCancellationToken *)cancellationTokenForOwner:(id)owner {
+    if( !owner )
+        return [ZKCancellationToken token];
+    
+    @synchronized( self ) {
+        SFVAsyncOwnerToken *ownerToken = objc_getAssociatedObject(owner, &kOwnerTokenKey);
+        
+        if( !ownerToken ) {
+            ownerToken = [[SFVAsyncOwnerToken alloc] init];
+            objc_setAssociatedObject(owner, &kOwnerTokenKey, ownerToken, OBJC_ASSOCIATION_RETAIN);
+            [ownerToken release];
+        }
+        
+        return ownerToken.token;
+    }
+}
+
++ (void)cancelRequestsForOwner:(id)owner {
+    if( !owner )
+        return;
+    
+    // Dropping the owner token cancels it, and the owner gets a new one for any later requests
+    @synchronized( self ) {
+        objc_setAssociatedObject(owner, &kOwnerTokenKey, nil, OBJC_ASSOCIATION_RETAIN);
+    }
+}
+
 #pragma mark - async operations
 
 + (void)performSFVAsyncRequest:(NSObject *(^)(void))operation failBlock:(SFVFailBlock)failBlock completeBlock:(void (^)(id))completeBlock {
+    [self performSFVAsyncRequest:operation
+                           owner:nil
+                       failBlock:failBlock
+                   completeBlock:completeBlock];
+}
+
++ (void)performSFVAsyncRequest:(NSObject *(^)(void))operation owner:(id)owner failBlock:(SFVFailBlock)failBlock completeBlock:(void (^)(id))completeBlock {
     if( !operation )
         return;
     
+    ZKCancellationToken *token = [self cancellationTokenForOwner:owner];
+    
     [[SFVUtil sharedSFVUtil] startNetworkAction];
     
     dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT,0), ^(void) {        
+        // Any zkSforce calls the operation makes on this thread can now be cancelled
+        [ZKCancellationToken setCurrentToken:token];
+        
         @try {
             NSObject *result = operation();
             
@@ -193,15 +276,81 @@
             
             if( completeBlock )
                 dispatch_async(dispatch_get_main_queue(), ^(void) {
-                    completeBlock(result);
+                    if( ![token isCancelled] )
+                        completeBlock(result);
                 });
         } @catch( NSException *e ) {            
             [[SFVUtil sharedSFVUtil] endNetworkAction];
+            
+            if( [token isCancelled] )
+                return;
+            
+            [[SFVUtil sharedSFVUtil] receivedException:e];
+            
+            if( failBlock )
+                dispatch_async(dispatch_get_main_queue(), ^(void) {
+                    if( ![token isCancelled] )
+                        failBlock(e);
+                });
+        } @finally {
+            [ZKCancellationToken setCurrentToken:nil];
+        }
+    });
+}
+
++ (void)performZKAsyncRequest:(void (^)(ZKCancellationToken *, void (^)(id), ZKFailBlock))operation owner:(id)owner failBlock:(SFVFailBlock)failBlock completeBlock:(void (^)(id))completeBlock {
+    if( !operation )
+        return;
+    
+    ZKCancellationToken *token = [self cancellationTokenForOwner:owner];
+    
+    // A cancelled request never hears back from zkSforce, so the cancel handler has to balance
+    // the network activity count instead. Whichever gets here first wins.
+    __block int32_t finished = 0;
+    
+    void (^endNetworkAction)(void) = ^(void) {
+        if( OSAtomicCompareAndSwap32(0, 1, &finished) )
+            [[SFVUtil sharedSFVUtil] endNetworkAction];
+    };
+    
+    [[SFVUtil sharedSFVUtil] startNetworkAction];
+    
+    id cancelHandler = [token addCancelHandler:endNetworkAction];
+    
+    // Kicking off the request is quick, but may need to refresh the session first, so keep it off the main thread
+    dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT,0), ^(void) {
+        @try {
+            operation(token, 
+                      ^(id results) {
+                          endNetworkAction();
+                          [token removeCancelHandler:cancelHandler];
+                          
+                          if( completeBlock )
+                              dispatch_async(dispatch_get_main_queue(), ^(void) {
+                                  if( ![token isCancelled] )
+                                      completeBlock(results);
+                              });
+                      },
+                      ^(NSException *e) {
+                          endNetworkAction();
+                          [token removeCancelHandler:cancelHandler];
+                          [[SFVUtil sharedSFVUtil] receivedException:e];
+                          
+                          if( failBlock )
+                              dispatch_async(dispatch_get_main_queue(), ^(void) {
+                                  if( ![token isCancelled] )
+                                      failBlock(e);
+                              });
+                      });
+        } @catch( NSException *e ) {
+            endNetworkAction();
+            [token removeCancelHandler:cancelHandler];
             [[SFVUtil sharedSFVUtil] receivedException:e];
             
             if( failBlock )
                 dispatch_async(dispatch_get_main_queue(), ^(void) {
-                    failBlock(e);
+                    if( ![token isCancelled] )
+                        failBlock(e);
                 });
         }
     });
@@ -210,6 +359,15 @@
 #pragma mark - DML
 
 + (void)performRetrieveWithFields:(NSArray *)fields sObject:(NSString *)sObject ids:(NSArray *)ids failBlock:(SFVFailBlock)failBlock completeBlock:(SFVDictionaryCompleteBlock)completeBlock {
+    [self performRetrieveWithFields:fields
+                            sObject:sObject
+                                ids:ids
+                              owner:nil
+                          failBlock:failBlock
+                      completeBlock:completeBlock];
+}
+
++ (void)performRetrieveWithFields:(NSArray *)fields sObject:(NSString *)sObject ids:(NSArray *)ids owner:(id)owner failBlock:(SFVFailBlock)failBlock completeBlock:(SFVDictionaryCompleteBlock)completeBlock {
     // require sobject and ids
     if( !sObject || !ids || [ids count] == 0 )
         return;
@@ -226,30 +384,45 @@
     
     fieldList = [self sanitizeSOQLQueryFieldList:fieldList];
     
-    [SFVAsync performSFVAsyncRequest:(id)^{
-                            return [[[SFVUtil sharedSFVUtil] client] retrieve:fieldList
-                                                                      sobject:sObject 
-                                                                          ids:ids];
-                        }
-                       failBlock:^(NSException *e) {
-                           if( failBlock )
-                               failBlock(e);
-                       }
-                   completeBlock:^(id results) {
-                        if( completeBlock )
-                            completeBlock( results );
-                   }];
+    [SFVAsync performZKAsyncRequest:^(ZKCancellationToken *token, void (^doneBlock)(id), ZKFailBlock errorBlock) {
+                                [[[SFVUtil sharedSFVUtil] client] retrieve:fieldList
+                                                                   sobject:sObject
+                                                                       ids:ids
+                                                         cancellationToken:token
+                                                             completeBlock:doneBlock
+                                                                 failBlock:errorBlock];
+                            }
+                              owner:owner
+                          failBlock:^(NSException *e) {
+                              if( failBlock )
+                                  failBlock(e);
+                          }
+                      completeBlock:^(id results) {
+                          if( completeBlock )
+                              completeBlock( results );
+                      }];
 }
 
 + (void)performSOQLQuery:(NSString *)query failBlock:(SFVFailBlock)failBlock completeBlock:(SFVQueryResultCompleteBlock)completeBlock {
+    [self performSOQLQuery:query
+                     owner:nil
+                 failBlock:failBlock
+             completeBlock:completeBlock];
+}
+
++ (void)performSOQLQuery:(NSString *)query owner:(id)owner failBlock:(SFVFailBlock)failBlock completeBlock:(SFVQueryResultCompleteBlock)completeBlock {
     if( !query || [query length] == 0 )
         return;
         
     NSLog(@"** SOQL: %@", query);
         
-    [SFVAsync performSFVAsyncRequest:(id)^{
-                                return [[[SFVUtil sharedSFVUtil] client] query:query];
+    [SFVAsync performZKAsyncRequest:^(ZKCancellationToken *token, void (^doneBlock)(id), ZKFailBlock errorBlock) {
+                                [[[SFVUtil sharedSFVUtil] client] query:query
+                                                      cancellationToken:token
+                                                          completeBlock:doneBlock
+                                                              failBlock:errorBlock];
                             }
+                              owner:owner
                            failBlock:^(NSException *e) {
                                if( failBlock )
                                    failBlock( e );
@@ -282,14 +455,25 @@
 }
 
 + (void)performQueryMore:(NSString *)queryLocator failBlock:(SFVFailBlock)failBlock completeBlock:(SFVQueryResultCompleteBlock)completeBlock {
+    [self performQueryMore:queryLocator
+                     owner:nil
+                 failBlock:failBlock
+             completeBlock:completeBlock];
+}
+
++ (void)performQueryMore:(NSString *)queryLocator owner:(id)owner failBlock:(SFVFailBlock)failBlock completeBlock:(SFVQueryResultCompleteBlock)completeBlock {
     if( !queryLocator || [queryLocator length] == 0 )
         return;
         
     NSLog(@"** SOSL QueryMore: %@", queryLocator);
     
-    [SFVAsync performSFVAsyncRequest:(id)^{
-                                return [[[SFVUtil sharedSFVUtil] client] queryMore:queryLocator];
+    [SFVAsync performZKAsyncRequest:^(ZKCancellationToken *token, void (^doneBlock)(id), ZKFailBlock errorBlock) {
+                                [[[SFVUtil sharedSFVUtil] client] queryMore:queryLocator
+                                                          cancellationToken:token
+                                                              completeBlock:doneBlock
+                                                                  failBlock:errorBlock];
                             }
+                              owner:owner
                            failBlock:^(NSException *e) {
                                if( failBlock )
                                    failBlock( e );
@@ -0,0 +1,85 @@
+/* 
+ * Copyright (c) 2011, salesforce.com, inc.
+ * Author: Jonathan Hersh jhersh@salesforce.com
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided 
+ * that the following conditions are met:
+ * 
+ *    Redistributions of source code must retain the above copyright notice, this list of conditions and the 
+ *    following disclaimer.
+ *  
+ *    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and 
+ *    the following disclaimer in the documentation and/or other materials provided with the distribution. 
+ *    
+ *    Neither the name of salesforce.com, inc. nor the names of its contributors may be used to endorse or 
+ *    promote products derived from this software without specific prior written permission.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED 
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR 
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED 
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// A field describe compiled down to flags and numbers when its object is cached, so the
+// property lookups made while building lists and layouts don't go back to the JSON.
+
+#import <Foundation/Foundation.h>
+#import "SFVAppCache.h"
+
+@interface SFVFieldDescribe : NSObject {
+    NSDictionary *describe;
+    
+    // one bit per FieldDescribeBooleanProperty
+    uint32_t flags;
+    
+    FieldDescribeDataType dataType;
+    NSInteger numbers[FieldNumNumberProperties];
+    NSString *strings[FieldNumStringProperties];
+    NSArray *picklistValues, *referenceTo;
+    
+    // Picklist bitsets, one bit per entry in picklistValues, decoded the first time they're needed
+    volatile BOOL picklistBitsBuilt;
+    NSUInteger picklistWords;
+    uint32_t *activeValues;
+    
+    // Dependent picklists: one row of picklistWords per controlling value index, with the
+    // bits set for the values that are valid when the controlling field has that value
+    uint32_t *validFor;
+    NSUInteger validForRows;
+    
+    // key: picklist value, value: its index in picklistValues
+    NSDictionary * volatile picklistIndexes;
+}
+
++ (SFVFieldDescribe *) fieldDescribeWithDictionary:(NSDictionary *)fieldDesc;
+
+// The describe we were compiled from
+@property (nonatomic, readonly) NSDictionary *describe;
+@property (nonatomic, readonly) FieldDescribeDataType dataType;
+
+- (BOOL) hasProperty:(FieldDescribeBooleanProperty)property;
+
+// never nil, empty string if the describe doesn't have this property
+- (NSString *) stringProperty:(FieldDescribeStringProperty)property;
+
+- (NSArray *) arrayProperty:(FieldDescribeArrayProperty)property;
+- (NSInteger) numberProperty:(FieldDescribeNumberProperty)property;
+
+// Picklist bitsets are picklistWordCount words long, bit i is picklistValues[i]
+- (NSUInteger) picklistWordCount;
+- (const uint32_t *) activePicklistValues;
+
+// For a dependent picklist, which values are valid when the controlling field's value
+// is at this index. NULL if none are.
+- (const uint32_t *) validPicklistValuesForControllingIndex:(NSInteger)index;
+
+// Index of this value in picklistValues, which is how dependent picklists refer to their
+// controlling values. -1 if it isn't there.
+- (NSInteger) indexOfPicklistValue:(NSString *)value;
+
+@end
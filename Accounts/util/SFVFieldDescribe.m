@@ -0,0 +1,313 @@
+/* 
+ * Copyright (c) 2011, salesforce.com, inc.
+ * Author: Jonathan Hersh jhersh@salesforce.com
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided 
+ * that the following conditions are met:
+ * 
+ *    Redistributions of source code must retain the above copyright notice, this list of conditions and the 
+ *    following disclaimer.
+ *  
+ *    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and 
+ *    the following disclaimer in the documentation and/or other materials provided with the distribution. 
+ *    
+ *    Neither the name of salesforce.com, inc. nor the names of its contributors may be used to endorse or 
+ *    promote products derived from this software without specific prior written permission.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED 
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR 
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED 
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import "SFVFieldDescribe.h"
+#import "SFVUtil.h"
+#import "NSData+Base64.h"
+#import <libkern/OSAtomic.h>
+
+@interface SFVFieldDescribe (Private)
+- (id) initWithDictionary:(NSDictionary *)fieldDesc;
+- (void) buildPicklistBits;
+- (void) ensurePicklistBits;
+@end
+
+@implementation SFVFieldDescribe
+
+@synthesize describe, dataType;
+
+// describe keys for each FieldDescribeBooleanProperty. FieldIsReferenceField comes from the type.
+static NSString * const kBooleanKeys[] = {
+    [FieldIsFormulaField]       = @"calculated",
+    [FieldIsCustom]             = @"custom",
+    [FieldIsHTML]               = @"htmlFormatted",
+    [FieldIsNameField]          = @"nameField",
+    [FieldIsCreateable]         = @"createable",
+    [FieldIsUpdateable]         = @"updateable",
+    [FieldIsNillable]           = @"nillable",
+    [FieldIsDependentPicklist]  = @"dependentPicklist",
+    [FieldIsRestrictedPicklist] = @"restrictedPicklist",
+    [FieldIsReferenceField]     = nil
+};
+
+static NSString * const kStringKeys[FieldNumStringProperties] = {
+    [FieldCalculatedFormula]    = @"calculatedFormula",
+    [FieldDefaultValue]         = @"defaultValue",
+    [FieldDefaultValueFormula]  = @"defaultValueFormula",
+    [FieldInlineHelpText]       = @"inlineHelpText",
+    [FieldName]                 = @"name",
+    [FieldLabel]                = @"label",
+    [FieldRelationshipName]     = @"relationshipName",
+    [FieldRelationshipOrder]    = @"relationshipOrder",
+    [FieldControllingFieldName] = @"controllerName",
+    [FieldType]                 = @"type"
+};
+
+static NSString * const kNumberKeys[FieldNumNumberProperties] = {
+    [FieldDigits]               = @"digits",
+    [FieldLength]               = @"length",
+    [FieldPrecision]            = @"precision",
+    [FieldScale]                = @"scale"
+};
+
++ (FieldDescribeDataType) dataTypeForTypeName:(NSString *)type {
+    static NSDictionary *types = nil;
+    static dispatch_once_t onceToken;
+    
+    dispatch_once(&onceToken, ^{
+        types = [[NSDictionary alloc] initWithObjectsAndKeys:
+                 NSNumberFromInt(FieldDataTypeString),          @"string",
+                 NSNumberFromInt(FieldDataTypeTextArea),        @"textarea",
+                 NSNumberFromInt(FieldDataTypeBoolean),         @"boolean",
+                 NSNumberFromInt(FieldDataTypeInteger),         @"int",
+                 NSNumberFromInt(FieldDataTypeDouble),          @"double",
+                 NSNumberFromInt(FieldDataTypeCurrency),        @"currency",
+                 NSNumberFromInt(FieldDataTypePercent),         @"percent",
+                 NSNumberFromInt(FieldDataTypeDate),            @"date",
+                 NSNumberFromInt(FieldDataTypeDateTime),        @"datetime",
+                 NSNumberFromInt(FieldDataTypeTime),            @"time",
+                 NSNumberFromInt(FieldDataTypePicklist),        @"picklist",
+                 NSNumberFromInt(FieldDataTypeMultiPicklist),   @"multipicklist",
+                 NSNumberFromInt(FieldDataTypeComboBox),        @"combobox",
+                 NSNumberFromInt(FieldDataTypeReference),       @"reference",
+                 NSNumberFromInt(FieldDataTypeId),              @"id",
+                 NSNumberFromInt(FieldDataTypeEmail),           @"email",
+                 NSNumberFromInt(FieldDataTypePhone),           @"phone",
+                 NSNumberFromInt(FieldDataTypeURL),             @"url",
+                 NSNumberFromInt(FieldDataTypeBase64),          @"base64",
+                 NSNumberFromInt(FieldDataTypeEncryptedString), @"encryptedstring",
+                 NSNumberFromInt(FieldDataTypeAnyType),         @"anyType",
+                 nil];
+    });
+    
+    return (FieldDescribeDataType)[[types objectForKey:type] intValue];
+}
+
++ (SFVFieldDescribe *) fieldDescribeWithDictionary:(NSDictionary *)fieldDesc {
+    return [[[self alloc] initWithDictionary:fieldDesc] autorelease];
+}
+
+- (id) initWithDictionary:(NSDictionary *)fieldDesc {
+    if(( self = [super init] )) {
+        describe = [fieldDesc retain];
+        
+        for( int i = 0; i < FieldNumStringProperties; i++ )
+            strings[i] = [[SFVAppCache valueOrEmptyStringForString:[fieldDesc objectForKey:kStringKeys[i]]] copy];
+        
+        for( int i = 0; i < FieldNumNumberProperties; i++ ) {
+            id num = [fieldDesc objectForKey:kNumberKeys[i]];
+            numbers[i] = ( [num respondsToSelector:@selector(integerValue)] ? [num integerValue] : 0 );
+        }
+        
+        for( int i = 0; i < sizeof(kBooleanKeys) / sizeof(kBooleanKeys[0]); i++ ) {
+            if( !kBooleanKeys[i] )
+                continue;
+            
+            id val = [fieldDesc objectForKey:kBooleanKeys[i]];
+            
+            if( [val respondsToSelector:@selector(boolValue)] && [val boolValue] )
+                flags |= ( 1 << i );
+        }
+        
+        dataType = [[self class] dataTypeForTypeName:strings[FieldType]];
+        
+        if( dataType == FieldDataTypeReference )
+            flags |= ( 1 << FieldIsReferenceField );
+        
+        id values = [fieldDesc objectForKey:@"picklistValues"];
+        picklistValues = [( [values isKindOfClass:[NSArray class]] ? values : nil ) copy];
+        
+        values = [fieldDesc objectForKey:@"referenceTo"];
+        referenceTo = [( [values isKindOfClass:[NSArray class]] ? values : nil ) copy];
+    }
+    
+    return self;
+}
+
+- (void) dealloc {
+    for( int i = 0; i < FieldNumStringProperties; i++ )
+        [strings[i] release];
+    
+    SFRelease(describe);
+    SFRelease(picklistValues);
+    SFRelease(referenceTo);
+    SFRelease(picklistIndexes);
+    free(activeValues);
+    free(validFor);
+    [super dealloc];
+}
+
+- (BOOL) hasProperty:(FieldDescribeBooleanProperty)property {
+    return ( flags & ( 1 << property ) ) != 0;
+}
+
+- (NSString *) stringProperty:(FieldDescribeStringProperty)property {
+    if( property >= FieldNumStringProperties )
+        return @"";
+    
+    return strings[property];
+}
+
+- (NSArray *) arrayProperty:(FieldDescribeArrayProperty)property {
+    switch( property ) {
+        case FieldPicklistValues:
+            return picklistValues;
+        case FieldReferenceTo:
+            return referenceTo;
+    }
+    
+    return nil;
+}
+
+- (NSInteger) numberProperty:(FieldDescribeNumberProperty)property {
+    if( property >= FieldNumNumberProperties )
+        return 0;
+    
+    return numbers[property];
+}
+
+#pragma mark - picklists
+
+- (void) buildPicklistBits {
+    NSUInteger count = [picklistValues count];
+    NSMutableArray *validForData = [NSMutableArray arrayWithCapacity:count];
+    NSUInteger maxBytes = 0;
+    
+    picklistWords = ( count + 31 ) / 32;
+    activeValues = calloc( MAX( picklistWords, 1 ), sizeof(uint32_t) );
+    
+    for( NSUInteger i = 0; i < count; i++ ) {
+        NSDictionary *entry = [picklistValues objectAtIndex:i];
+        NSString *base64 = [entry objectForKey:@"validFor"];
+        NSData *data = nil;
+        
+        if( [[entry objectForKey:@"active"] boolValue] )
+            activeValues[i >> 5] |= ( 1u << ( i & 31 ) );
+        
+        if( [base64 isKindOfClass:[NSString class]] && [base64 length] > 0 )
+            data = [NSData dataFromBase64String:base64];
+        
+        [validForData addObject:( data ? data : [NSData data] )];
+        maxBytes = MAX( maxBytes, [data length] );
+    }
+    
+    if( [self hasProperty:FieldIsDependentPicklist] && maxBytes > 0 ) {
+        // validFor is a big-endian bitmap over the controlling field's values. Turn it
+        // around, so each controlling value gets a row of the dependent values it allows.
+        validForRows = maxBytes * 8;
+        validFor = calloc( validForRows * picklistWords, sizeof(uint32_t) );
+        
+        for( NSUInteger j = 0; j < count; j++ ) {
+            NSData *data = [validForData objectAtIndex:j];
+            const Byte *bytes = [data bytes];
+            uint32_t bit = 1u << ( j & 31 );
+            NSUInteger word = j >> 5;
+            
+            for( NSUInteger b = 0; b < [data length]; b++ ) {
+                if( !bytes[b] )
+                    continue;
+                
+                for( int k = 0; k < 8; k++ )
+                    if( bytes[b] & ( 0x80 >> k ) )
+                        validFor[( b * 8 + k ) * picklistWords + word] |= bit;
+            }
+        }
+    }
+    
+    // Readers check the flag without locking, so everything above has to be visible first
+    OSMemoryBarrier();
+    picklistBitsBuilt = YES;
+}
+
+// Describes are shared with background threads through SFVDescribeSnapshot, so the first
+// caller builds the bits and anyone racing it waits.
+- (void) ensurePicklistBits {
+    BOOL built = picklistBitsBuilt;
+    OSMemoryBarrier();
+    
+    if( built )
+        return;
+    
+    @synchronized( self ) {
+        if( !picklistBitsBuilt )
+            [self buildPicklistBits];
+    }
+}
+
+- (NSUInteger) picklistWordCount {
+    [self ensurePicklistBits];
+    
+    return picklistWords;
+}
+
+- (const uint32_t *) activePicklistValues {
+    [self ensurePicklistBits];
+    
+    return activeValues;
+}
+
+- (const uint32_t *) validPicklistValuesForControllingIndex:(NSInteger)index {
+    [self ensurePicklistBits];
+    
+    if( !validFor || index < 0 || (NSUInteger)index >= validForRows )
+        return NULL;
+    
+    return validFor + index * picklistWords;
+}
+
+- (NSInteger) indexOfPicklistValue:(NSString *)value {
+    if( !value )
+        return -1;
+    
+    NSDictionary *indexMap = picklistIndexes;
+    OSMemoryBarrier();
+    
+    if( !indexMap ) {
+        NSMutableDictionary *indexes = [NSMutableDictionary dictionaryWithCapacity:[picklistValues count]];
+        
+        for( NSUInteger i = 0; i < [picklistValues count]; i++ ) {
+            id v = [[picklistValues objectAtIndex:i] objectForKey:@"value"];
+            
+            if( v && ![indexes objectForKey:v] )
+                [indexes setObject:[NSNumber numberWithUnsignedInteger:i] forKey:v];
+        }
+        
+        indexMap = [indexes copy];
+        
+        // Whoever gets there first wins, the rest use theirs
+        if( !OSAtomicCompareAndSwapPtrBarrier(nil, indexMap, (void * volatile *)&picklistIndexes) ) {
+            [indexMap release];
+            indexMap = picklistIndexes;
+        }
+    }
+    
+    NSNumber *index = [indexMap objectForKey:value];
+    
+    return ( index ? [index integerValue] : -1 );
+}
+
+@end
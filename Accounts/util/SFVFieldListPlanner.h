@@ -0,0 +1,74 @@
+/* 
+ * Copyright (c) 2011, salesforce.com, inc.
+ * Author: Jonathan Hersh jhersh@salesforce.com
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided 
+ * that the following conditions are met:
+ * 
+ *    Redistributions of source code must retain the above copyright notice, this list of conditions and the 
+ *    following disclaimer.
+ *  
+ *    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and 
+ *    the following disclaimer in the documentation and/or other materials provided with the distribution. 
+ *    
+ *    Neither the name of salesforce.com, inc. nor the names of its contributors may be used to endorse or 
+ *    promote products derived from this software without specific prior written permission.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED 
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR 
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED 
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+// Works out which fields to query for a record layout, and remembers the answer for each
+// layout and set of org capabilities until the layout or the describes change.
+
+#import <Foundation/Foundation.h>
+#import "SFVAppCache.h"
+
+@interface SFVFieldListPlan : NSObject {
+    NSString *layoutId;
+    NSArray *fields;
+    NSDictionary *relationshipColumns;
+    
+    // What this plan was built from, so we can tell when it's out of date
+    SFVOrgCapabilities capabilities;
+    NSUInteger describeGeneration;
+    NSUInteger layoutGeneration;
+}
+
+@property (nonatomic, readonly) NSString *layoutId;
+
+// Field names to select, unique
+@property (nonatomic, readonly) NSArray *fields;
+
+// key: relationship name, value: NSNumber, how many columns expanding that relationship added
+@property (nonatomic, readonly) NSDictionary *relationshipColumns;
+
+// Total columns added by relationship expansions
+- (NSUInteger) relationshipColumnCount;
+
+@end
+
+@interface SFVFieldListPlanner : NSObject {
+    // key: layoutId + capability bits, value: SFVFieldListPlan
+    NSMutableDictionary *plans;
+}
+
++ (SFVFieldListPlanner *) sharedSFVFieldListPlanner;
+
+// The cached plan for this layout, rebuilt if the layout or describes have changed since
+- (SFVFieldListPlan *) planForLayoutId:(NSString *)layoutId;
+
+// Always builds a new plan, bypassing the cache
+- (SFVFieldListPlan *) buildPlanForLayoutId:(NSString *)layoutId;
+
+- (void) removeAllPlans;
+
+@end
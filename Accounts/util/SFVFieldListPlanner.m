@@ -0,0 +1,272 @@
+/* 
+ * Copyright (c) 2011, salesforce.com, inc.
+ * Author: Jonathan Hersh jhersh@salesforce.com
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided 
+ * that the following conditions are met:
+ * 
+ *    Redistributions of source code must retain the above copyright notice, this list of conditions and the 
+ *    following disclaimer.
+ *  
+ *    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and 
+ *    the following disclaimer in the documentation and/or other materials provided with the distribution. 
+ *    
+ *    Neither the name of salesforce.com, inc. nor the names of its contributors may be used to endorse or 
+ *    promote products derived from this software without specific prior written permission.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED 
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR 
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED 
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#import "SFVFieldListPlanner.h"
+#import "SFVUtil.h"
+#import "SFVFieldDescribe.h"
+#import "SynthesizeSingleton.h"
+
+@interface SFVFieldListPlan (Private)
+- (id) initWithLayoutId:(NSString *)layoutId fields:(NSArray *)fields relationshipColumns:(NSDictionary *)relationshipColumns;
+- (BOOL) isCurrentForCapabilities:(SFVOrgCapabilities)caps;
+@end
+
+@implementation SFVFieldListPlan
+
+@synthesize layoutId, fields, relationshipColumns;
+
+- (id) initWithLayoutId:(NSString *)lid fields:(NSArray *)f relationshipColumns:(NSDictionary *)columns {
+    if(( self = [super init] )) {
+        layoutId = [lid copy];
+        fields = [f copy];
+        relationshipColumns = [columns copy];
+        capabilities = [[SFVAppCache sharedSFVAppCache] orgCapabilities];
+        describeGeneration = [[SFVAppCache sharedSFVAppCache] describeGeneration];
+        layoutGeneration = [[SFVUtil sharedSFVUtil] layoutGeneration];
+    }
+    
+    return self;
+}
+
+- (void) dealloc {
+    SFRelease(layoutId);
+    SFRelease(fields);
+    SFRelease(relationshipColumns);
+    [super dealloc];
+}
+
+- (BOOL) isCurrentForCapabilities:(SFVOrgCapabilities)caps {
+    return describeGeneration == [[SFVAppCache sharedSFVAppCache] describeGeneration]
+        && layoutGeneration == [[SFVUtil sharedSFVUtil] layoutGeneration]
+        && capabilities.chatterEnabled == caps.chatterEnabled
+        && capabilities.multiCurrencyEnabled == caps.multiCurrencyEnabled
+        && capabilities.personAccountEnabled == caps.personAccountEnabled;
+}
+
+- (NSUInteger) relationshipColumnCount {
+    NSUInteger count = 0;
+    
+    for( NSNumber *n in [relationshipColumns allValues] )
+        count += [n unsignedIntegerValue];
+    
+    return count;
+}
+
+- (NSString *) description {
+    return [NSString stringWithFormat:@"%@: %i fields, %i from relationships %@",
+            layoutId, [fields count], [self relationshipColumnCount], relationshipColumns];
+}
+
+@end
+
+@implementation SFVFieldListPlanner
+
+SYNTHESIZE_SINGLETON_FOR_CLASS(SFVFieldListPlanner);
+
+- (id) init {
+    if(( self = [super init] )) {
+        plans = [[NSMutableDictionary alloc] init];
+    }
+    
+    return self;
+}
+
+- (void) dealloc {
+    SFRelease(plans);
+    [super dealloc];
+}
+
+- (void) removeAllPlans {
+    [plans removeAllObjects];
+}
+
+- (SFVFieldListPlan *) planForLayoutId:(NSString *)layoutId {
+    if( [SFVUtil isEmpty:layoutId] )
+        return nil;
+    
+    SFVOrgCapabilities caps = [[SFVAppCache sharedSFVAppCache] orgCapabilities];
+    NSString *key = [NSString stringWithFormat:@"%@:%i%i%i", layoutId,
+                     caps.chatterEnabled, caps.multiCurrencyEnabled, caps.personAccountEnabled];
+    
+    SFVFieldListPlan *plan = [plans objectForKey:key];
+    
+    if( plan && [plan isCurrentForCapabilities:caps] )
+        return plan;
+    
+    plan = [self buildPlanForLayoutId:layoutId];
+    
+    // Don't remember plans for layouts we haven't described yet
+    if( [[SFVUtil sharedSFVUtil] layoutWithLayoutId:layoutId] )
+        [plans setObject:plan forKey:key];
+    else
+        [plans removeObjectForKey:key];
+    
+    return plan;
+}
+
+- (SFVFieldListPlan *) buildPlanForLayoutId:(NSString *)layoutId {
+    NSMutableArray *ret = [NSMutableArray arrayWithObject:@"Id"];
+    
+    // key: relationship name, value: NSMutableSet of the columns expanding it added
+    NSMutableDictionary *columns = [NSMutableDictionary dictionary];
+    
+    SFVAppCache *appCache = [SFVAppCache sharedSFVAppCache];
+    SFVOrgCapabilities caps = [appCache orgCapabilities];
+    ZKDescribeLayout *layout = [[SFVUtil sharedSFVUtil] layoutWithLayoutId:layoutId];
+    NSString *sObject = [[SFVUtil sharedSFVUtil] sObjectFromLayoutId:layoutId];
+    
+    if( !layout ) 
+        return [[[SFVFieldListPlan alloc] initWithLayoutId:layoutId fields:ret relationshipColumns:columns] autorelease];
+        
+    // 1. Loop through all sections in this page layout
+    for( ZKDescribeLayoutSection *section in [layout detailLayoutSections] ) {
+        
+        // 2. Loop through all rows within this section
+        for( ZKDescribeLayoutRow *dlr in [section layoutRows]) {
+            
+            // 3. Each individual item on this row
+            for ( ZKDescribeLayoutItem *item in [dlr layoutItems] ) {
+                
+                // If this item is blank or a placeholder, we ignore it
+                if( [item placeholder] || [[item layoutComponents] count] == 0 )
+                    continue;
+                
+                for( ZKDescribeLayoutComponent *dlc in [item layoutComponents] ) {                    
+                    if( ![[dlc typeName] isEqualToString:@"Field"] )
+                        continue;
+                    
+                    NSString *fname = [dlc value];
+                    SFVFieldDescribe *describe = [appCache compiledDescribeForField:fname onObject:sObject];
+                    
+                    if( !describe )
+                        continue;
+                    
+                    FieldDescribeDataType fieldType = [describe dataType];
+                    
+                    if( fieldType == FieldDataTypeReference ) {        
+                        NSString *relationshipName = [appCache field:fname
+                                                            onObject:sObject 
+                                                      stringProperty:FieldRelationshipName];
+                        NSArray *referenceTo = [appCache field:fname
+                                                      onObject:sObject
+                                                 arrayProperty:FieldReferenceTo];
+                        NSUInteger before = [ret count];
+                        
+                        // Special handling for the 'What' and 'Who' fields on Task, which can refer to just about anything                        
+                        if( [relationshipName isEqualToString:@"What"] )
+                            [ret addObject:@"What.Name"];
+                        else if( [relationshipName isEqualToString:@"Who"] )
+                            [ret addObject:@"Who.Name"];
+                        else if( [referenceTo count] == 1 && [referenceTo containsObject:@"User"] ) {
+                            // Special handling for Task/Event, as they use the Name field for owner (sigh)
+                            if( ( [sObject isEqualToString:@"Task"] || [sObject isEqualToString:@"Event"] ) && [relationshipName isEqualToString:@"Owner"] )
+                                [ret addObject:[NSString stringWithFormat:@"%@.%@", relationshipName, @"Name"]];
+                            else if( ![SFVUtil isEmpty:relationshipName] ) {
+                                NSArray *newFields = [NSArray arrayWithObjects:@"Name", @"email", @"title", @"phone", 
+                                                                @"mobilephone", @"city", @"state", @"department", nil];
+                                
+                                if( caps.chatterEnabled )
+                                    newFields = [newFields arrayByAddingObjectsFromArray:[NSArray arrayWithObjects:@"smallphotourl", @"fullphotourl", @"aboutme", nil]];
+                                
+                                for( NSString *s in newFields ) 
+                                    [ret addObject:[NSString stringWithFormat:@"%@.%@", relationshipName, s]];
+                            }
+                        } else if( ![SFVUtil isEmpty:relationshipName] ) {
+                            [ret addObject:[NSString stringWithFormat:@"%@.Id", relationshipName]];
+                            
+                            for( NSString *refTo in referenceTo ) {
+                                [ret addObject:[NSString stringWithFormat:@"%@.%@",
+                                                                relationshipName,
+                                                                [appCache nameFieldForsObject:refTo]]];
+                                
+                                if( [appCache doesObject:refTo haveProperty:ObjectIsRecordTypeEnabled] )
+                                    [ret addObject:[NSString stringWithFormat:@"%@.%@",
+                                                    relationshipName,
+                                                    kRecordTypeIdField]];
+                            }
+                        }
+                        
+                        if( [ret count] > before && ![SFVUtil isEmpty:relationshipName] ) {
+                            NSMutableSet *added = [columns objectForKey:relationshipName];
+                            
+                            if( !added ) {
+                                added = [NSMutableSet set];
+                                [columns setObject:added forKey:relationshipName];
+                            }
+                            
+                            // The same relationship can be on a layout more than once, count its columns once
+                            [added addObjectsFromArray:[ret subarrayWithRange:NSMakeRange( before, [ret count] - before )]];
+                        }
+                    } else if( fieldType == FieldDataTypeCurrency && caps.multiCurrencyEnabled )
+                        [ret addObject:@"CurrencyIsoCode"];                        
+                    
+                    [ret addObject:fname];
+                }     
+            }
+        }
+    }
+    
+    // Ensure that header fields are included in the query for accounts
+    if( [sObject isEqualToString:@"Account"] ) 
+        for( NSString *headerField in [NSArray arrayWithObjects:@"Name", @"Phone", @"Industry", @"Website", nil] ) {
+            NSDictionary *desc = [appCache describeForField:headerField onObject:@"Account"];
+            
+            // access check for this field. even though it's a standard field, some users may not have access
+            if( desc )
+                [ret addObject:headerField];
+        }
+    
+    if( [sObject isEqualToString:@"Lead"] ) {
+        [ret addObject:@"IsUnreadByOwner"];
+        [ret addObject:@"IsConverted"];
+    }
+    
+    if( [appCache doesObject:sObject haveProperty:ObjectIsRecordTypeEnabled] ) {
+        [ret addObject:kRecordTypeIdField];
+        [ret addObject:@"RecordType.Name"];
+    }
+    
+    // Handle person accounts
+    if( caps.personAccountEnabled && [sObject isEqualToString:@"Account"] )
+        [ret addObjectsFromArray:[NSArray arrayWithObjects:@"PersonContactId", @"IsPersonAccount", nil]];
+    
+    // Also, some page layouts don't include the record name so we must be sure to include it
+    [ret addObject:[appCache nameFieldForsObject:sObject]];
+    
+    NSMutableDictionary *columnCounts = [NSMutableDictionary dictionaryWithCapacity:[columns count]];
+    
+    for( NSString *relationshipName in columns )
+        [columnCounts setObject:[NSNumber numberWithUnsignedInteger:[[columns objectForKey:relationshipName] count]]
+                         forKey:relationshipName];
+    
+    return [[[SFVFieldListPlan alloc] initWithLayoutId:layoutId
+                                                fields:[[NSSet setWithArray:ret] allObjects]
+                                   relationshipColumns:columnCounts] autorelease];
+}
+
+@end
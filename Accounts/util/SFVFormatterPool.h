@@ -0,0 +1,51 @@
+/* 
+ * Copyright (c) 2011, salesforce.com, inc.
+ * Author: Jonathan Hersh jhersh@salesforce.com
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided 
+ * that the following conditions are met:
+ * 
+ *    Redistributions of source code must retain the above copyright notice, this list of conditions and the 
+ *    following disclaimer.
+ *  
+ *    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and 
+ *    the following disclaimer in the documentation and/or other materials provided with the distribution. 
+ *    
+ *    Neither the name of salesforce.com, inc. nor the names of its contributors may be used to endorse or 
+ *    promote products derived from this software without specific prior written permission.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED 
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR 
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED 
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+// Number and date formatters set up for the current locale. They're expensive to make and
+// can't be shared between threads, so each thread keeps its own, one per configuration.
+// Don't change the formatters you get back; ask for the configuration you need instead.
+
+#import <Foundation/Foundation.h>
+
+@interface SFVFormatterPool : NSObject
+
++ (NSDateFormatter *) dateFormatterWithDateStyle:(NSDateFormatterStyle)dateStyle timeStyle:(NSDateFormatterStyle)timeStyle;
++ (NSDateFormatter *) dateFormatterWithFormat:(NSString *)format;
+
++ (NSNumberFormatter *) numberFormatterWithStyle:(NSNumberFormatterStyle)style;
+
+// currencyCode may be nil for the locale's own currency
++ (NSNumberFormatter *) currencyFormatterWithCode:(NSString *)currencyCode;
+
+// precision is the total number of digits, scale the number of digits after the decimal point
++ (NSNumberFormatter *) decimalFormatterWithPrecision:(NSInteger)precision scale:(NSInteger)scale;
+
+// Every thread starts over with new formatters. Called for us when the locale or time zone changes.
++ (void) removeAllFormatters;
+
+@end
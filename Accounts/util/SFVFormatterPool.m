@@ -0,0 +1,171 @@
+/* 
+ * Copyright (c) 2011, salesforce.com, inc.
+ * Author: Jonathan Hersh jhersh@salesforce.com
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided 
+ * that the following conditions are met:
+ * 
+ *    Redistributions of source code must retain the above copyright notice, this list of conditions and the 
+ *    following disclaimer.
+ *  
+ *    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and 
+ *    the following disclaimer in the documentation and/or other materials provided with the distribution. 
+ *    
+ *    Neither the name of salesforce.com, inc. nor the names of its contributors may be used to endorse or 
+ *    promote products derived from this software without specific prior written permission.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED 
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR 
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED 
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#import "SFVFormatterPool.h"
+#import <libkern/OSAtomic.h>
+
+static NSString * const kFormatterPoolKey = @"SFVFormatterPool.formatters";
+static NSString * const kFormatterPoolGenerationKey = @"SFVFormatterPool.generation";
+
+// Bumped to throw away every thread's formatters
+static volatile int32_t poolGeneration = 0;
+
+@interface SFVFormatterPool (Private)
++ (NSMutableDictionary *) formattersForCurrentThread;
+@end
+
+@implementation SFVFormatterPool
+
++ (void) initialize {
+    if( self != [SFVFormatterPool class] )
+        return;
+    
+    [[NSNotificationCenter defaultCenter] addObserver:self
+                                             selector:@selector(removeAllFormatters)
+                                                 name:NSCurrentLocaleDidChangeNotification
+                                               object:nil];
+    [[NSNotificationCenter defaultCenter] addObserver:self
+                                             selector:@selector(removeAllFormatters)
+                                                 name:NSSystemTimeZoneDidChangeNotification
+                                               object:nil];
+}
+
++ (void) removeAllFormatters {
+    OSAtomicIncrement32Barrier( &poolGeneration );
+}
+
++ (NSMutableDictionary *) formattersForCurrentThread {
+    NSMutableDictionary *threadDictionary = [[NSThread currentThread] threadDictionary];
+    NSMutableDictionary *formatters = [threadDictionary objectForKey:kFormatterPoolKey];
+    int32_t generation = poolGeneration;
+    
+    if( !formatters || [[threadDictionary objectForKey:kFormatterPoolGenerationKey] intValue] != generation ) {
+        formatters = [NSMutableDictionary dictionary];
+        [threadDictionary setObject:formatters forKey:kFormatterPoolKey];
+        [threadDictionary setObject:[NSNumber numberWithInt:generation] forKey:kFormatterPoolGenerationKey];
+    }
+    
+    return formatters;
+}
+
+#pragma mark - dates
+
++ (NSDateFormatter *) dateFormatterWithDateStyle:(NSDateFormatterStyle)dateStyle timeStyle:(NSDateFormatterStyle)timeStyle {
+    NSMutableDictionary *formatters = [self formattersForCurrentThread];
+    NSString *key = [NSString stringWithFormat:@"date.%d.%d", dateStyle, timeStyle];
+    NSDateFormatter *formatter = [formatters objectForKey:key];
+    
+    if( !formatter ) {
+        formatter = [[NSDateFormatter alloc] init];
+        [formatter setLocale:[NSLocale currentLocale]];
+        [formatter setDateStyle:dateStyle];
+        [formatter setTimeStyle:timeStyle];
+        [formatters setObject:formatter forKey:key];
+        [formatter release];
+    }
+    
+    return formatter;
+}
+
++ (NSDateFormatter *) dateFormatterWithFormat:(NSString *)format {
+    NSMutableDictionary *formatters = [self formattersForCurrentThread];
+    NSString *key = [@"format." stringByAppendingString:format];
+    NSDateFormatter *formatter = [formatters objectForKey:key];
+    
+    if( !formatter ) {
+        formatter = [[NSDateFormatter alloc] init];
+        [formatter setLocale:[NSLocale currentLocale]];
+        [formatter setDateFormat:format];
+        [formatters setObject:formatter forKey:key];
+        [formatter release];
+    }
+    
+    return formatter;
+}
+
+#pragma mark - numbers
+
++ (NSNumberFormatter *) numberFormatterWithStyle:(NSNumberFormatterStyle)style {
+    NSMutableDictionary *formatters = [self formattersForCurrentThread];
+    NSString *key = [NSString stringWithFormat:@"number.%d", style];
+    NSNumberFormatter *formatter = [formatters objectForKey:key];
+    
+    if( !formatter ) {
+        formatter = [[NSNumberFormatter alloc] init];
+        [formatter setLocale:[NSLocale currentLocale]];
+        [formatter setNumberStyle:style];
+        [formatters setObject:formatter forKey:key];
+        [formatter release];
+    }
+    
+    return formatter;
+}
+
++ (NSNumberFormatter *) currencyFormatterWithCode:(NSString *)currencyCode {
+    NSMutableDictionary *formatters = [self formattersForCurrentThread];
+    NSString *key = [@"currency." stringByAppendingString:( currencyCode ? currencyCode : @"" )];
+    NSNumberFormatter *formatter = [formatters objectForKey:key];
+    
+    if( !formatter ) {
+        formatter = [[NSNumberFormatter alloc] init];
+        [formatter setLocale:[NSLocale currentLocale]];
+        [formatter setNumberStyle:NSNumberFormatterCurrencyStyle];
+        
+        if( currencyCode )
+            [formatter setCurrencyCode:currencyCode];
+        
+        [formatters setObject:formatter forKey:key];
+        [formatter release];
+    }
+    
+    return formatter;
+}
+
++ (NSNumberFormatter *) decimalFormatterWithPrecision:(NSInteger)precision scale:(NSInteger)scale {
+    NSMutableDictionary *formatters = [self formattersForCurrentThread];
+    NSString *key = [NSString stringWithFormat:@"decimal.%d.%d", precision, scale];
+    NSNumberFormatter *formatter = [formatters objectForKey:key];
+    
+    if( !formatter ) {
+        formatter = [[NSNumberFormatter alloc] init];
+        [formatter setLocale:[NSLocale currentLocale]];
+        [formatter setNumberStyle:NSNumberFormatterDecimalStyle];
+        
+        // No direct means of getting the number of digits to the left of the decimal, so we just subtract them
+        [formatter setMinimumFractionDigits:scale];
+        [formatter setMaximumFractionDigits:scale];
+        [formatter setMaximumIntegerDigits:( precision - scale )];
+        
+        [formatters setObject:formatter forKey:key];
+        [formatter release];
+    }
+    
+    return formatter;
+}
+
+@end
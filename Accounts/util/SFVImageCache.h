@@ -0,0 +1,81 @@
+/* 
+ * Copyright (c) 2011, salesforce.com, inc.
+ * Author: Jonathan Hersh jhersh@salesforce.com
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided 
+ * that the following conditions are met:
+ * 
+ *    Redistributions of source code must retain the above copyright notice, this list of conditions and the 
+ *    following disclaimer.
+ *  
+ *    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and 
+ *    the following disclaimer in the documentation and/or other materials provided with the distribution. 
+ *    
+ *    Neither the name of salesforce.com, inc. nor the names of its contributors may be used to endorse or 
+ *    promote products derived from this software without specific prior written permission.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED 
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR 
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED 
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+// Two tier image cache. Decoded images are kept in memory, least recently used first out,
+// up to a limit on their decoded size. The compressed originals are also kept on disk so they
+// survive a relaunch. Resized copies of an image are cached alongside the original, keyed
+// by the maximum dimension they were resized to.
+
+#import <Foundation/Foundation.h>
+#import <UIKit/UIKit.h>
+
+@class SFVImageCacheEntry;
+
+typedef void (^ImageDataCompletionBlock) (NSData *data);
+
+@interface SFVImageCache : NSObject {
+    // key: cache key, or cache key + maximum dimension for resized copies. value: SFVImageCacheEntry
+    NSMutableDictionary *memoryEntries;
+    
+    // LRU list through memoryEntries
+    SFVImageCacheEntry *mostRecentEntry, *leastRecentEntry;
+    
+    NSUInteger memoryCost, memoryCostLimit;
+    
+    dispatch_queue_t diskQueue;
+    
+    // Only touched on diskQueue. -1 until we've added up what's already on disk.
+    long long diskSize;
+    NSUInteger diskSizeLimit;
+}
+
++ (SFVImageCache *) sharedSFVImageCache;
+
+// Strips the session from an image URL, so the same image is found again after logging in anew
++ (NSString *) cacheKeyForURL:(NSString *)url;
+
+// Bytes of decoded images to keep in memory
+@property (nonatomic, assign) NSUInteger memoryCostLimit;
+
+// Bytes of compressed images to keep on disk
+@property (nonatomic, assign) NSUInteger diskSizeLimit;
+
+// memory tier. A maxDimension of 0 means the original image.
+
+- (UIImage *) imageForKey:(NSString *)key maxDimension:(CGFloat)maxDimension;
+- (void) setImage:(UIImage *)image forKey:(NSString *)key maxDimension:(CGFloat)maxDimension;
+- (void) removeAllMemoryImages;
+
+// disk tier. Reads and writes happen on a background queue, the read block is called
+// on the main queue, with nil if there's nothing on disk for this key.
+
+- (void) loadDataForKey:(NSString *)key completeBlock:(ImageDataCompletionBlock)completeBlock;
+- (void) storeData:(NSData *)data forKey:(NSString *)key;
+- (void) removeAllDiskImages;
+
+@end
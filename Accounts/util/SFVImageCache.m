@@ -0,0 +1,346 @@
+/* 
+ * Copyright (c) 2011, salesforce.com, inc.
+ * Author: Jonathan Hersh jhersh@salesforce.com
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided 
+ * that the following conditions are met:
+ * 
+ *    Redistributions of source code must retain the above copyright notice, this list of conditions and the 
+ *    following disclaimer.
+ *  
+ *    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and 
+ *    the following disclaimer in the documentation and/or other materials provided with the distribution. 
+ *    
+ *    Neither the name of salesforce.com, inc. nor the names of its contributors may be used to endorse or 
+ *    promote products derived from this software without specific prior written permission.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED 
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR 
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED 
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#import "SFVImageCache.h"
+#import "SFVUtil.h"
+#import "SynthesizeSingleton.h"
+#import <CommonCrypto/CommonDigest.h>
+
+// Defaults
+static NSUInteger const kMemoryCostLimit    = 8 * 1024 * 1024;
+static NSUInteger const kDiskSizeLimit      = 20 * 1024 * 1024;
+
+// When the disk tier is over its limit, trim it to this fraction of the limit
+static double const kDiskTrimRatio          = 0.75;
+
+@interface SFVImageCacheEntry : NSObject {
+@public
+    NSString *key;
+    UIImage *image;
+    NSUInteger cost;
+    
+    // not retained, memoryEntries owns every entry
+    SFVImageCacheEntry *newer, *older;
+}
+@end
+
+@implementation SFVImageCacheEntry
+
+- (void) dealloc {
+    SFRelease(key);
+    SFRelease(image);
+    [super dealloc];
+}
+
+@end
+
+@interface SFVImageCache (Private)
+- (NSString *) diskPath;
+- (NSString *) diskPathForKey:(NSString *)key;
+- (void) unlinkEntry:(SFVImageCacheEntry *)entry;
+- (void) pushEntry:(SFVImageCacheEntry *)entry;
+- (void) removeEntry:(SFVImageCacheEntry *)entry;
+- (void) trimDiskToSize:(long long)size;
+@end
+
+static NSString *memoryKey( NSString *key, CGFloat maxDimension ) {
+    if( maxDimension <= 0 )
+        return key;
+    
+    return [NSString stringWithFormat:@"%@#%.0f", key, maxDimension];
+}
+
+static NSUInteger decodedCost( UIImage *image ) {
+    CGImageRef cg = [image CGImage];
+    
+    if( !cg )
+        return 0;
+    
+    return CGImageGetBytesPerRow( cg ) * CGImageGetHeight( cg );
+}
+
+@implementation SFVImageCache
+
+SYNTHESIZE_SINGLETON_FOR_CLASS(SFVImageCache);
+
+@synthesize memoryCostLimit, diskSizeLimit;
+
+- (id) init {
+    if(( self = [super init] )) {
+        memoryEntries = [[NSMutableDictionary alloc] init];
+        memoryCostLimit = kMemoryCostLimit;
+        diskSizeLimit = kDiskSizeLimit;
+        diskSize = -1;
+        diskQueue = dispatch_queue_create("com.salesforce.imagecache", NULL);
+    }
+    
+    return self;
+}
+
+- (void) dealloc {
+    SFRelease(memoryEntries);
+    dispatch_release(diskQueue);
+    [super dealloc];
+}
+
++ (NSString *) cacheKeyForURL:(NSString *)url {
+    NSRange r = [url rangeOfString:@"oauth_token="];
+    
+    if( r.location == NSNotFound || r.location == 0 )
+        return url;
+    
+    // drop the token and the ? or & in front of it
+    NSString *before = [url substringToIndex:r.location - 1];
+    NSRange end = [url rangeOfString:@"&" options:0 range:NSMakeRange( r.location, [url length] - r.location )];
+    
+    if( end.location == NSNotFound )
+        return before;
+    
+    NSString *separator = [url substringWithRange:NSMakeRange( r.location - 1, 1 )];
+    
+    return [NSString stringWithFormat:@"%@%@%@", before, separator, [url substringFromIndex:end.location + 1]];
+}
+
+#pragma mark - memory tier
+
+- (void) unlinkEntry:(SFVImageCacheEntry *)entry {
+    if( entry->newer )
+        entry->newer->older = entry->older;
+    else
+        mostRecentEntry = entry->older;
+    
+    if( entry->older )
+        entry->older->newer = entry->newer;
+    else
+        leastRecentEntry = entry->newer;
+    
+    entry->newer = entry->older = nil;
+}
+
+- (void) pushEntry:(SFVImageCacheEntry *)entry {
+    entry->older = mostRecentEntry;
+    entry->newer = nil;
+    
+    if( mostRecentEntry )
+        mostRecentEntry->newer = entry;
+    
+    mostRecentEntry = entry;
+    
+    if( !leastRecentEntry )
+        leastRecentEntry = entry;
+}
+
+- (void) removeEntry:(SFVImageCacheEntry *)entry {
+    [self unlinkEntry:entry];
+    memoryCost -= entry->cost;
+    [memoryEntries removeObjectForKey:entry->key];
+}
+
+- (UIImage *) imageForKey:(NSString *)key maxDimension:(CGFloat)maxDimension {
+    if( !key )
+        return nil;
+    
+    @synchronized( self ) {
+        SFVImageCacheEntry *entry = [memoryEntries objectForKey:memoryKey( key, maxDimension )];
+        
+        if( !entry )
+            return nil;
+        
+        if( entry != mostRecentEntry ) {
+            [self unlinkEntry:entry];
+            [self pushEntry:entry];
+        }
+        
+        return [[entry->image retain] autorelease];
+    }
+}
+
+- (void) setImage:(UIImage *)image forKey:(NSString *)key maxDimension:(CGFloat)maxDimension {
+    if( !image || !key )
+        return;
+    
+    NSString *mkey = memoryKey( key, maxDimension );
+    NSUInteger cost = decodedCost( image );
+    
+    @synchronized( self ) {
+        SFVImageCacheEntry *existing = [memoryEntries objectForKey:mkey];
+        
+        if( existing )
+            [self removeEntry:existing];
+        
+        // Not worth evicting everything else for
+        if( cost > memoryCostLimit / 2 )
+            return;
+        
+        SFVImageCacheEntry *entry = [[SFVImageCacheEntry alloc] init];
+        entry->key = [mkey copy];
+        entry->image = [image retain];
+        entry->cost = cost;
+        
+        [memoryEntries setObject:entry forKey:mkey];
+        [self pushEntry:entry];
+        memoryCost += cost;
+        [entry release];
+        
+        while( memoryCost > memoryCostLimit && leastRecentEntry )
+            [self removeEntry:leastRecentEntry];
+    }
+}
+
+- (void) removeAllMemoryImages {
+    @synchronized( self ) {
+        mostRecentEntry = leastRecentEntry = nil;
+        memoryCost = 0;
+        [memoryEntries removeAllObjects];
+    }
+}
+
+#pragma mark - disk tier
+
+- (NSString *) diskPath {
+    NSString *caches = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES) objectAtIndex:0];
+    
+    return [caches stringByAppendingPathComponent:@"Images"];
+}
+
+- (NSString *) diskPathForKey:(NSString *)key {
+    const char *str = [key UTF8String];
+    unsigned char digest[CC_SHA1_DIGEST_LENGTH];
+    
+    CC_SHA1( str, (CC_LONG)strlen( str ), digest );
+    
+    NSMutableString *name = [NSMutableString stringWithCapacity:CC_SHA1_DIGEST_LENGTH * 2];
+    
+    for( int i = 0; i < CC_SHA1_DIGEST_LENGTH; i++ )
+        [name appendFormat:@"%02x", digest[i]];
+    
+    return [[self diskPath] stringByAppendingPathComponent:name];
+}
+
+- (void) loadDataForKey:(NSString *)key completeBlock:(ImageDataCompletionBlock)completeBlock {
+    if( !key || !completeBlock )
+        return;
+    
+    NSString *path = [self diskPathForKey:key];
+    completeBlock = [[completeBlock copy] autorelease];
+    
+    dispatch_async(diskQueue, ^{
+        NSData *data = [NSData dataWithContentsOfFile:path];
+        
+        // Mark as recently used, so trimming takes the oldest first
+        if( data ) {
+            NSFileManager *fm = [[[NSFileManager alloc] init] autorelease];
+            [fm setAttributes:[NSDictionary dictionaryWithObject:[NSDate date] forKey:NSFileModificationDate]
+                 ofItemAtPath:path
+                        error:nil];
+        }
+        
+        dispatch_async(dispatch_get_main_queue(), ^{
+            completeBlock( data );
+        });
+    });
+}
+
+- (void) storeData:(NSData *)data forKey:(NSString *)key {
+    if( !key || [data length] == 0 || [data length] > diskSizeLimit )
+        return;
+    
+    NSString *path = [self diskPathForKey:key];
+    data = [[data copy] autorelease];
+    
+    dispatch_async(diskQueue, ^{
+        NSFileManager *fm = [[[NSFileManager alloc] init] autorelease];
+        
+        [fm createDirectoryAtPath:[self diskPath] withIntermediateDirectories:YES attributes:nil error:nil];
+        
+        // First write since launch, find out how much is already there
+        if( diskSize < 0 ) {
+            diskSize = 0;
+            
+            for( NSString *file in [fm contentsOfDirectoryAtPath:[self diskPath] error:nil] )
+                diskSize += [[fm attributesOfItemAtPath:[[self diskPath] stringByAppendingPathComponent:file] error:nil] fileSize];
+        }
+        
+        unsigned long long replaced = [[fm attributesOfItemAtPath:path error:nil] fileSize];
+        NSError *error = nil;
+        
+        if( ![data writeToFile:path 
+                       options:NSDataWritingAtomic | NSDataWritingFileProtectionComplete 
+                         error:&error] ) {
+            NSLog(@"Failed to write image to disk cache: %@", error);
+            return;
+        }
+        
+        diskSize += (long long)[data length] - (long long)replaced;
+        
+        if( diskSize > (long long)diskSizeLimit )
+            [self trimDiskToSize:(long long)( diskSizeLimit * kDiskTrimRatio )];
+    });
+}
+
+// runs on diskQueue
+- (void) trimDiskToSize:(long long)size {
+    NSFileManager *fm = [[[NSFileManager alloc] init] autorelease];
+    NSMutableArray *files = [NSMutableArray array];
+    
+    for( NSString *file in [fm contentsOfDirectoryAtPath:[self diskPath] error:nil] ) {
+        NSString *path = [[self diskPath] stringByAppendingPathComponent:file];
+        NSDictionary *attributes = [fm attributesOfItemAtPath:path error:nil];
+        
+        if( attributes )
+            [files addObject:[NSDictionary dictionaryWithObjectsAndKeys:
+                              path, @"path",
+                              [attributes fileModificationDate], NSFileModificationDate,
+                              [NSNumber numberWithUnsignedLongLong:[attributes fileSize]], NSFileSize,
+                              nil]];
+    }
+    
+    [files sortUsingDescriptors:[NSArray arrayWithObject:
+                                 [NSSortDescriptor sortDescriptorWithKey:NSFileModificationDate ascending:YES]]];
+    
+    for( NSDictionary *file in files ) {
+        if( diskSize <= size )
+            break;
+        
+        if( [fm removeItemAtPath:[file objectForKey:@"path"] error:nil] )
+            diskSize -= [[file objectForKey:NSFileSize] longLongValue];
+    }
+}
+
+- (void) removeAllDiskImages {
+    NSString *path = [self diskPath];
+    
+    // queue behind any write that's in progress
+    dispatch_async(diskQueue, ^{
+        NSFileManager *fm = [[[NSFileManager alloc] init] autorelease];
+        [fm removeItemAtPath:path error:nil];
+        diskSize = 0;
+    });
+}
+
+@end
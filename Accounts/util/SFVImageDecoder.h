@@ -0,0 +1,59 @@
+/* 
+ * Copyright (c) 2011, salesforce.com, inc.
+ * Author: Jonathan Hersh jhersh@salesforce.com
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided 
+ * that the following conditions are met:
+ * 
+ *    Redistributions of source code must retain the above copyright notice, this list of conditions and the 
+ *    following disclaimer.
+ *  
+ *    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and 
+ *    the following disclaimer in the documentation and/or other materials provided with the distribution. 
+ *    
+ *    Neither the name of salesforce.com, inc. nor the names of its contributors may be used to endorse or 
+ *    promote products derived from this software without specific prior written permission.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED 
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR 
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED 
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+// Decodes, scales and rounds images on background threads, a few at a time, and hands the
+// finished bitmaps back on the main queue.
+
+#import <Foundation/Foundation.h>
+#import <UIKit/UIKit.h>
+
+// original is the full size decoded image, or nil if we started from an already decoded image.
+// sized fits the requested dimension and corner radius, and may be the same as original.
+typedef void (^ImageDecodeCompletionBlock) (UIImage *original, UIImage *sized);
+
+@interface SFVImageDecoder : NSObject {
+    // Feeds work to the global queues, waiting on decodeSlots first
+    dispatch_queue_t feederQueue;
+    dispatch_semaphore_t decodeSlots;
+}
+
++ (SFVImageDecoder *) sharedSFVImageDecoder;
+
+// Decode compressed image data. Both images are nil if the data isn't an image.
+- (void) decodeImageData:(NSData *)data 
+            maxDimension:(CGFloat)maxDimension 
+            cornerRadius:(CGFloat)cornerRadius
+           completeBlock:(ImageDecodeCompletionBlock)completeBlock;
+
+// Make a sized and/or rounded copy of an image we've already decoded
+- (void) decodeImage:(UIImage *)image
+        maxDimension:(CGFloat)maxDimension 
+        cornerRadius:(CGFloat)cornerRadius
+       completeBlock:(ImageDecodeCompletionBlock)completeBlock;
+
+@end
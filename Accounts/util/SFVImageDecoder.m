@@ -0,0 +1,123 @@
+/* 
+ * Copyright (c) 2011, salesforce.com, inc.
+ * Author: Jonathan Hersh jhersh@salesforce.com
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided 
+ * that the following conditions are met:
+ * 
+ *    Redistributions of source code must retain the above copyright notice, this list of conditions and the 
+ *    following disclaimer.
+ *  
+ *    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and 
+ *    the following disclaimer in the documentation and/or other materials provided with the distribution. 
+ *    
+ *    Neither the name of salesforce.com, inc. nor the names of its contributors may be used to endorse or 
+ *    promote products derived from this software without specific prior written permission.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED 
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR 
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED 
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#import "SFVImageDecoder.h"
+#import "SFVUtil.h"
+#import "SynthesizeSingleton.h"
+#import "UIImage+ImageUtils.h"
+
+// How many images to decode at once
+static long const kMaxConcurrentDecodes = 2;
+
+@interface SFVImageDecoder (Private)
+- (void) performDecode:(dispatch_block_t)decode;
+@end
+
+static BOOL imageFitsMaxDimension( UIImage *image, CGFloat maxDimension ) {
+    return maxDimension <= 0 || MAX( image.size.width, image.size.height ) <= maxDimension;
+}
+
+@implementation SFVImageDecoder
+
+SYNTHESIZE_SINGLETON_FOR_CLASS(SFVImageDecoder);
+
+- (id) init {
+    if(( self = [super init] )) {
+        feederQueue = dispatch_queue_create("com.salesforce.imagedecoder", NULL);
+        decodeSlots = dispatch_semaphore_create(kMaxConcurrentDecodes);
+    }
+    
+    return self;
+}
+
+- (void) dealloc {
+    dispatch_release(feederQueue);
+    dispatch_release(decodeSlots);
+    [super dealloc];
+}
+
+- (void) performDecode:(dispatch_block_t)decode {
+    dispatch_async(feederQueue, ^{
+        dispatch_semaphore_wait(decodeSlots, DISPATCH_TIME_FOREVER);
+        
+        dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+            NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+            decode();
+            [pool drain];
+            
+            dispatch_semaphore_signal(decodeSlots);
+        });
+    });
+}
+
+- (void) decodeImageData:(NSData *)data maxDimension:(CGFloat)maxDimension cornerRadius:(CGFloat)cornerRadius completeBlock:(ImageDecodeCompletionBlock)completeBlock {
+    if( !completeBlock )
+        return;
+    
+    CGFloat scale = DeviceScale;
+    
+    completeBlock = [[completeBlock copy] autorelease];
+    
+    [self performDecode:^{
+        UIImage *original = [[UIImage imageWithData:data] decodedImageWithMaxDimension:0 
+                                                                          cornerRadius:0 
+                                                                                 scale:scale];
+        UIImage *sized = original;
+        
+        if( original && ( cornerRadius > 0 || !imageFitsMaxDimension( original, maxDimension ) ) )
+            sized = [original decodedImageWithMaxDimension:maxDimension cornerRadius:cornerRadius scale:scale];
+        
+        dispatch_async(dispatch_get_main_queue(), ^{
+            completeBlock( original, sized );
+        });
+    }];
+}
+
+- (void) decodeImage:(UIImage *)image maxDimension:(CGFloat)maxDimension cornerRadius:(CGFloat)cornerRadius completeBlock:(ImageDecodeCompletionBlock)completeBlock {
+    if( !completeBlock )
+        return;
+    
+    if( !image || ( cornerRadius <= 0 && imageFitsMaxDimension( image, maxDimension ) ) ) {
+        completeBlock( nil, image );
+        return;
+    }
+    
+    CGFloat scale = image.scale;
+    
+    completeBlock = [[completeBlock copy] autorelease];
+    
+    [self performDecode:^{
+        UIImage *sized = [image decodedImageWithMaxDimension:maxDimension cornerRadius:cornerRadius scale:scale];
+        
+        dispatch_async(dispatch_get_main_queue(), ^{
+            completeBlock( nil, sized );
+        });
+    }];
+}
+
+@end
@@ -0,0 +1,81 @@
+/* 
+ * Copyright (c) 2011, salesforce.com, inc.
+ * Author: Jonathan Hersh jhersh@salesforce.com
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided 
+ * that the following conditions are met:
+ * 
+ *    Redistributions of source code must retain the above copyright notice, this list of conditions and the 
+ *    following disclaimer.
+ *  
+ *    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and 
+ *    the following disclaimer in the documentation and/or other materials provided with the distribution. 
+ *    
+ *    Neither the name of salesforce.com, inc. nor the names of its contributors may be used to endorse or 
+ *    promote products derived from this software without specific prior written permission.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED 
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR 
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED 
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Holds the describeLayout results for each sObject, indexed as they're added so that
+// layouts, record type mappings and picklists can be found without scanning them all.
+
+#import <Foundation/Foundation.h>
+#import "zkSforce.h"
+
+@interface SFVLayoutStore : NSObject {
+    // key: sObject, value: ZKDescribeLayoutResult
+    NSMutableDictionary *layoutResults;
+    
+    // key: layoutId, value: ZKDescribeLayout
+    NSMutableDictionary *layoutsById;
+    
+    // key: layoutId, value: sObject
+    NSMutableDictionary *sObjectsByLayoutId;
+    
+    // key: recordTypeId, value: sObject. The master record type Id is shared by every
+    // object, so it maps to whichever was added first.
+    NSMutableDictionary *sObjectsByRecordTypeId;
+    
+    // key: sObject, value: dictionary of recordTypeId -> ZKRecordTypeMapping
+    NSMutableDictionary *mappingsBySObject;
+    
+    // key: sObject, value: default ZKRecordTypeMapping
+    NSMutableDictionary *defaultMappings;
+    
+    // key: sObject, value: dictionary of recordTypeId -> dictionary of picklist name -> values.
+    // Filled in as they're asked for.
+    NSMutableDictionary *picklistsBySObject;
+    
+    NSUInteger generation;
+}
+
+// Goes up every time layouts are added or removed
+@property (nonatomic, readonly) NSUInteger generation;
+
+- (void) addLayoutResult:(ZKDescribeLayoutResult *)result forSObject:(NSString *)sObject;
+- (void) removeAllLayouts;
+
+// key: sObject, value: ZKDescribeLayoutResult
+- (NSDictionary *) allLayoutResults;
+
+- (ZKDescribeLayoutResult *) layoutResultForSObject:(NSString *)sObject;
+- (ZKDescribeLayout *) layoutWithId:(NSString *)layoutId;
+- (NSString *) sObjectForLayoutId:(NSString *)layoutId;
+- (NSString *) sObjectForRecordTypeId:(NSString *)recordTypeId;
+- (ZKRecordTypeMapping *) recordTypeMappingForSObject:(NSString *)sObject recordTypeId:(NSString *)recordTypeId;
+- (ZKRecordTypeMapping *) defaultRecordTypeMappingForSObject:(NSString *)sObject;
+
+// key: picklist name, value: array of ZKPicklistEntry. Uses the default record type mapping
+// if there's no mapping for this recordTypeId.
+- (NSDictionary *) picklistsForSObject:(NSString *)sObject recordTypeId:(NSString *)recordTypeId;
+
+@end
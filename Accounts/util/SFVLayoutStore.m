@@ -0,0 +1,196 @@
+/* 
+ * Copyright (c) 2011, salesforce.com, inc.
+ * Author: Jonathan Hersh jhersh@salesforce.com
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided 
+ * that the following conditions are met:
+ * 
+ *    Redistributions of source code must retain the above copyright notice, this list of conditions and the 
+ *    following disclaimer.
+ *  
+ *    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and 
+ *    the following disclaimer in the documentation and/or other materials provided with the distribution. 
+ *    
+ *    Neither the name of salesforce.com, inc. nor the names of its contributors may be used to endorse or 
+ *    promote products derived from this software without specific prior written permission.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED 
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR 
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED 
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import "SFVLayoutStore.h"
+#import "SFVUtil.h"
+
+@implementation SFVLayoutStore
+
+@synthesize generation;
+
+- (id) init {
+    if(( self = [super init] )) {
+        layoutResults = [[NSMutableDictionary alloc] init];
+        layoutsById = [[NSMutableDictionary alloc] init];
+        sObjectsByLayoutId = [[NSMutableDictionary alloc] init];
+        sObjectsByRecordTypeId = [[NSMutableDictionary alloc] init];
+        mappingsBySObject = [[NSMutableDictionary alloc] init];
+        defaultMappings = [[NSMutableDictionary alloc] init];
+        picklistsBySObject = [[NSMutableDictionary alloc] init];
+    }
+    
+    return self;
+}
+
+- (void) dealloc {
+    SFRelease(layoutResults);
+    SFRelease(layoutsById);
+    SFRelease(sObjectsByLayoutId);
+    SFRelease(sObjectsByRecordTypeId);
+    SFRelease(mappingsBySObject);
+    SFRelease(defaultMappings);
+    SFRelease(picklistsBySObject);
+    [super dealloc];
+}
+
+#pragma mark - adding and removing
+
+- (void) addLayoutResult:(ZKDescribeLayoutResult *)result forSObject:(NSString *)sObject {
+    if( !result || !sObject )
+        return;
+    
+    // Layouts and record types that were in the last result for this object may since have been deleted
+    ZKDescribeLayoutResult *previous = [layoutResults objectForKey:sObject];
+    
+    for( ZKDescribeLayout *layout in [previous layouts] )
+        if( [layout Id] && [[sObjectsByLayoutId objectForKey:[layout Id]] isEqualToString:sObject] ) {
+            [layoutsById removeObjectForKey:[layout Id]];
+            [sObjectsByLayoutId removeObjectForKey:[layout Id]];
+        }
+    
+    for( ZKRecordTypeMapping *mapping in [previous recordTypeMappings] )
+        if( [mapping recordTypeId] && [[sObjectsByRecordTypeId objectForKey:[mapping recordTypeId]] isEqualToString:sObject] )
+            [sObjectsByRecordTypeId removeObjectForKey:[mapping recordTypeId]];
+    
+    [layoutResults setObject:result forKey:sObject];
+    generation++;
+    [picklistsBySObject removeObjectForKey:sObject];
+    [defaultMappings removeObjectForKey:sObject];
+    
+    for( ZKDescribeLayout *layout in [result layouts] ) {
+        NSString *layoutId = [layout Id];
+        
+        if( !layoutId )
+            continue;
+        
+        [layoutsById setObject:layout forKey:layoutId];
+        [sObjectsByLayoutId setObject:sObject forKey:layoutId];
+    }
+    
+    NSMutableDictionary *mappings = [NSMutableDictionary dictionary];
+    
+    for( ZKRecordTypeMapping *mapping in [result recordTypeMappings] ) {
+        NSString *recordTypeId = [mapping recordTypeId];
+        
+        if( [mapping defaultRecordTypeMapping] && ![defaultMappings objectForKey:sObject] )
+            [defaultMappings setObject:mapping forKey:sObject];
+        
+        if( !recordTypeId )
+            continue;
+        
+        // the last mapping for a record type wins, as it did when we scanned for it
+        [mappings setObject:mapping forKey:recordTypeId];
+        
+        if( ![sObjectsByRecordTypeId objectForKey:recordTypeId] )
+            [sObjectsByRecordTypeId setObject:sObject forKey:recordTypeId];
+    }
+    
+    [mappingsBySObject setObject:mappings forKey:sObject];
+}
+
+- (void) removeAllLayouts {
+    generation++;
+    [layoutResults removeAllObjects];
+    [layoutsById removeAllObjects];
+    [sObjectsByLayoutId removeAllObjects];
+    [sObjectsByRecordTypeId removeAllObjects];
+    [mappingsBySObject removeAllObjects];
+    [defaultMappings removeAllObjects];
+    [picklistsBySObject removeAllObjects];
+}
+
+- (NSDictionary *) allLayoutResults {
+    return [[layoutResults copy] autorelease];
+}
+
+#pragma mark - lookups
+
+- (ZKDescribeLayoutResult *) layoutResultForSObject:(NSString *)sObject {
+    return ( sObject ? [layoutResults objectForKey:sObject] : nil );
+}
+
+- (ZKDescribeLayout *) layoutWithId:(NSString *)layoutId {
+    return ( layoutId ? [layoutsById objectForKey:layoutId] : nil );
+}
+
+- (NSString *) sObjectForLayoutId:(NSString *)layoutId {
+    return ( layoutId ? [sObjectsByLayoutId objectForKey:layoutId] : nil );
+}
+
+- (NSString *) sObjectForRecordTypeId:(NSString *)recordTypeId {
+    return ( recordTypeId ? [sObjectsByRecordTypeId objectForKey:recordTypeId] : nil );
+}
+
+- (ZKRecordTypeMapping *) recordTypeMappingForSObject:(NSString *)sObject recordTypeId:(NSString *)recordTypeId {
+    if( !sObject || !recordTypeId )
+        return nil;
+    
+    return [[mappingsBySObject objectForKey:sObject] objectForKey:recordTypeId];
+}
+
+- (ZKRecordTypeMapping *) defaultRecordTypeMappingForSObject:(NSString *)sObject {
+    return ( sObject ? [defaultMappings objectForKey:sObject] : nil );
+}
+
+- (NSDictionary *) picklistsForSObject:(NSString *)sObject recordTypeId:(NSString *)recordTypeId {
+    if( !sObject || ![layoutResults objectForKey:sObject] )
+        return nil;
+    
+    ZKRecordTypeMapping *mapping = [self recordTypeMappingForSObject:sObject recordTypeId:recordTypeId];
+    
+    if( !mapping )
+        mapping = [self defaultRecordTypeMappingForSObject:sObject];
+    
+    if( !mapping ) // merde.
+        return nil;
+    
+    // cache under the mapping we actually used, so the fallback is shared
+    NSString *key = ( [mapping recordTypeId] ? [mapping recordTypeId] : @"" );
+    NSMutableDictionary *picklists = [picklistsBySObject objectForKey:sObject];
+    NSDictionary *ret = [picklists objectForKey:key];
+    
+    if( ret )
+        return ret;
+    
+    NSMutableDictionary *values = [NSMutableDictionary dictionary];
+    
+    for( ZKPicklistForRecordType *picklist in [mapping picklistsForRecordType] )
+        [values setObject:[picklist picklistValues]
+                   forKey:[picklist picklistName]];
+    
+    if( !picklists ) {
+        picklists = [NSMutableDictionary dictionary];
+        [picklistsBySObject setObject:picklists forKey:sObject];
+    }
+    
+    ret = [[values copy] autorelease];
+    [picklists setObject:ret forKey:key];
+    
+    return ret;
+}
+
+@end
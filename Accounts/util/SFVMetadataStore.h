@@ -0,0 +1,69 @@
+/* 
+ * Copyright (c) 2011, salesforce.com, inc.
+ * Author: Jonathan Hersh jhersh@salesforce.com
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided 
+ * that the following conditions are met:
+ * 
+ *    Redistributions of source code must retain the above copyright notice, this list of conditions and the 
+ *    following disclaimer.
+ *  
+ *    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and 
+ *    the following disclaimer in the documentation and/or other materials provided with the distribution. 
+ *    
+ *    Neither the name of salesforce.com, inc. nor the names of its contributors may be used to endorse or 
+ *    promote products derived from this software without specific prior written permission.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED 
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR 
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED 
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Keeps org metadata (global describe, object describes, tab sets, layouts) on disk between
+// launches, so the app can draw its UI from the last session's metadata while fresh copies
+// are fetched. Metadata is kept separately for each org, user and API version.
+
+#import <Foundation/Foundation.h>
+
+// Bump this whenever the shape of anything we archive changes. Stores written by
+// any other version are ignored and deleted.
+#define kMetadataStoreVersion       1
+
+#define kMetadataStoreKey           @"metadataStoreKey"
+
+@interface SFVMetadataStore : NSObject {
+    NSString *storeKey;
+    NSMutableDictionary *pendingWrites;
+    dispatch_queue_t writeQueue;
+}
+
++ (SFVMetadataStore *) sharedSFVMetadataStore;
+
+// The org/user/API version we're reading and writing, nil if none.
+@property (nonatomic, readonly) NSString *storeKey;
+
+// Point the store at the metadata for this org, user and API version. Returns YES if
+// this is a different store than the one we were pointing at.
+- (BOOL) useStoreForOrgId:(NSString *)orgId userId:(NSString *)userId apiVersion:(NSString *)apiVersion;
+
+// Point the store at whichever org and user were last logged in, for use at launch before
+// we've logged in again. Returns NO if there's no such store.
+- (BOOL) useLastStore;
+
+// Synchronously read a section of the current store, nil if it isn't there.
+- (id) objectForSection:(NSString *)section;
+
+// Save a section of the current store. The object is copied now, and the write happens
+// on a background queue a moment later, so that several updates in a row only cost one write.
+- (void) setObject:(id<NSCoding, NSCopying>)object forSection:(NSString *)section;
+
+// Delete every store, for every org and user.
+- (void) removeAllStores;
+
+@end
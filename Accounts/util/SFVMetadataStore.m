@@ -0,0 +1,243 @@
+/* 
+ * Copyright (c) 2011, salesforce.com, inc.
+ * Author: Jonathan Hersh jhersh@salesforce.com
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided 
+ * that the following conditions are met:
+ * 
+ *    Redistributions of source code must retain the above copyright notice, this list of conditions and the 
+ *    following disclaimer.
+ *  
+ *    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and 
+ *    the following disclaimer in the documentation and/or other materials provided with the distribution. 
+ *    
+ *    Neither the name of salesforce.com, inc. nor the names of its contributors may be used to endorse or 
+ *    promote products derived from this software without specific prior written permission.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED 
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR 
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED 
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#import "SFVMetadataStore.h"
+#import "SFVUtil.h"
+#import "SynthesizeSingleton.h"
+
+@interface SFVMetadataStore (Private)
+- (NSString *) rootPath;
+- (NSString *) pathForSection:(NSString *)section storeKey:(NSString *)key;
+- (void) flushPendingWrites;
+@end
+
+@implementation SFVMetadataStore
+
+static NSString *kVersionKey = @"version";
+static NSString *kObjectKey = @"object";
+
+// How long to wait for more updates before writing to disk
+static double const kWriteDelay = 2.0;
+
+SYNTHESIZE_SINGLETON_FOR_CLASS(SFVMetadataStore);
+
+@synthesize storeKey;
+
+- (id) init {
+    if(( self = [super init] )) {
+        pendingWrites = [[NSMutableDictionary alloc] init];
+        writeQueue = dispatch_queue_create("com.salesforce.metadatastore", NULL);
+    }
+    
+    return self;
+}
+
+- (void) dealloc {
+    SFRelease(storeKey);
+    SFRelease(pendingWrites);
+    dispatch_release(writeQueue);
+    [super dealloc];
+}
+
+#pragma mark - choosing a store
+
+- (BOOL) useStoreForOrgId:(NSString *)orgId userId:(NSString *)userId apiVersion:(NSString *)apiVersion {
+    if( !orgId || !userId || !apiVersion )
+        return NO;
+    
+    NSString *key = [NSString stringWithFormat:@"%@_%@_%@", orgId, userId, apiVersion];
+    
+    [[NSUserDefaults standardUserDefaults] setObject:key forKey:kMetadataStoreKey];
+    [[NSUserDefaults standardUserDefaults] synchronize];
+    
+    @synchronized( self ) {
+        if( [key isEqualToString:storeKey] )
+            return NO;
+        
+        // anything still waiting to be written belongs to the old store
+        [pendingWrites removeAllObjects];
+        
+        [storeKey release];
+        storeKey = [key copy];
+    }
+    
+    return YES;
+}
+
+- (BOOL) useLastStore {
+    NSString *key = [[NSUserDefaults standardUserDefaults] objectForKey:kMetadataStoreKey];
+    
+    if( !key || ![[NSFileManager defaultManager] fileExistsAtPath:[[self rootPath] stringByAppendingPathComponent:key]] )
+        return NO;
+    
+    @synchronized( self ) {
+        [storeKey release];
+        storeKey = [key copy];
+    }
+    
+    return YES;
+}
+
+#pragma mark - reading and writing
+
+- (NSString *) rootPath {
+    NSString *caches = [NSSearchPathForDirectoriesInDomains(NSCachesDirectory, NSUserDomainMask, YES) objectAtIndex:0];
+    
+    return [[caches stringByAppendingPathComponent:@"Metadata"] 
+            stringByAppendingPathComponent:[NSString stringWithFormat:@"v%i", kMetadataStoreVersion]];
+}
+
+- (NSString *) pathForSection:(NSString *)section storeKey:(NSString *)key {
+    return [[[self rootPath] stringByAppendingPathComponent:key] 
+            stringByAppendingPathComponent:[section stringByAppendingPathExtension:@"archive"]];
+}
+
+- (id) objectForSection:(NSString *)section {
+    NSString *key = nil;
+    id pending = nil;
+    
+    @synchronized( self ) {
+        key = [[storeKey retain] autorelease];
+        pending = [[[pendingWrites objectForKey:section] retain] autorelease];
+    }
+    
+    if( pending )
+        return pending;
+    
+    if( !key )
+        return nil;
+    
+    NSString *path = [self pathForSection:section storeKey:key];
+    NSData *data = [NSData dataWithContentsOfFile:path];
+    
+    if( !data )
+        return nil;
+    
+    NSDictionary *archive = nil;
+    
+    @try {
+        archive = [NSKeyedUnarchiver unarchiveObjectWithData:data];
+    } @catch( NSException *e ) {
+        NSLog(@"Failed to read metadata section %@: %@", section, e);
+    }
+    
+    if( ![archive isKindOfClass:[NSDictionary class]] 
+        || [[archive objectForKey:kVersionKey] intValue] != kMetadataStoreVersion ) {
+        [[NSFileManager defaultManager] removeItemAtPath:path error:nil];
+        return nil;
+    }
+    
+    return [archive objectForKey:kObjectKey];
+}
+
+- (void) setObject:(id<NSCoding, NSCopying>)object forSection:(NSString *)section {
+    if( !object || !section )
+        return;
+    
+    id copy = [object copyWithZone:nil];
+    BOOL scheduleWrite = NO;
+    
+    @synchronized( self ) {
+        if( !storeKey ) {
+            [copy release];
+            return;
+        }
+        
+        scheduleWrite = [pendingWrites count] == 0;
+        [pendingWrites setObject:copy forKey:section];
+    }
+    
+    [copy release];
+    
+    if( scheduleWrite )
+        dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(kWriteDelay * NSEC_PER_SEC)), writeQueue, ^{
+            [self flushPendingWrites];
+        });
+}
+
+// runs on writeQueue
+- (void) flushPendingWrites {
+    NSDictionary *writes = nil;
+    NSString *key = nil;
+    
+    @synchronized( self ) {
+        writes = [[pendingWrites copy] autorelease];
+        key = [[storeKey retain] autorelease];
+        [pendingWrites removeAllObjects];
+    }
+    
+    if( !key || [writes count] == 0 )
+        return;
+    
+    NSFileManager *fm = [[[NSFileManager alloc] init] autorelease];
+    NSString *dir = [[self rootPath] stringByAppendingPathComponent:key];
+    
+    [fm createDirectoryAtPath:dir withIntermediateDirectories:YES attributes:nil error:nil];
+    
+    for( NSString *section in writes ) {
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        NSData *data = nil;
+        
+        @try {
+            data = [NSKeyedArchiver archivedDataWithRootObject:[NSDictionary dictionaryWithObjectsAndKeys:
+                                                                 [NSNumber numberWithInt:kMetadataStoreVersion], kVersionKey,
+                                                                 [writes objectForKey:section], kObjectKey,
+                                                                 nil]];
+        } @catch( NSException *e ) {
+            NSLog(@"Failed to archive metadata section %@: %@", section, e);
+        }
+        
+        NSError *error = nil;
+        
+        if( data && ![data writeToFile:[self pathForSection:section storeKey:key]
+                               options:NSDataWritingAtomic | NSDataWritingFileProtectionComplete
+                                 error:&error] )
+            NSLog(@"Failed to write metadata section %@: %@", section, error);
+        
+        [pool drain];
+    }
+}
+
+- (void) removeAllStores {
+    @synchronized( self ) {
+        [pendingWrites removeAllObjects];
+        SFRelease(storeKey);
+    }
+    
+    [[NSUserDefaults standardUserDefaults] removeObjectForKey:kMetadataStoreKey];
+    [[NSUserDefaults standardUserDefaults] synchronize];
+    
+    // queue behind any write that's in progress
+    NSString *root = [[self rootPath] stringByDeletingLastPathComponent];
+    
+    dispatch_async(writeQueue, ^{
+        NSFileManager *fm = [[[NSFileManager alloc] init] autorelease];
+        [fm removeItemAtPath:root error:nil];
+    });
+}
+
+@end
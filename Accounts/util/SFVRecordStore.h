@@ -0,0 +1,61 @@
+/* 
+ * Copyright (c) 2011, salesforce.com, inc.
+ * Author: Jonathan Hersh jhersh@salesforce.com
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided 
+ * that the following conditions are met:
+ * 
+ *    Redistributions of source code must retain the above copyright notice, this list of conditions and the 
+ *    following disclaimer.
+ *  
+ *    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and 
+ *    the following disclaimer in the documentation and/or other materials provided with the distribution. 
+ *    
+ *    Neither the name of salesforce.com, inc. nor the names of its contributors may be used to endorse or 
+ *    promote products derived from this software without specific prior written permission.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED 
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR 
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED 
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+// Keeps the last copy of each record we've fetched, so a record can be shown right away
+// while a fresh copy is fetched in the background. Records are kept in the metadata store,
+// so they belong to the current org and user and go away at logout.
+
+#import <Foundation/Foundation.h>
+
+@interface SFVRecordStore : NSObject {
+    // key: record Id, value: dictionary of record, field list, fetch and use dates
+    NSMutableDictionary *entries;
+}
+
++ (SFVRecordStore *) sharedSFVRecordStore;
+
+// The stored copy of this record, or nil if we don't have one, it's older than kRecordMaxAge, 
+// or it's missing any of these fields.
+- (NSDictionary *) recordWithId:(NSString *)recordId fieldList:(NSArray *)fieldList;
+
+// YES if the stored copy was fetched within kRecordFreshAge, and isn't worth fetching again yet
+- (BOOL) isRecordFresh:(NSString *)recordId;
+
+// Store a freshly fetched record, returns the fields whose values differ from the stored copy,
+// or nil if there wasn't one. Fields the stored copy had and this one doesn't map to NSNull.
+- (NSDictionary *) storeRecord:(NSDictionary *)record fieldList:(NSArray *)fieldList;
+
+// Update a few fields of a stored record, after we've saved them ourselves
+- (void) updateRecordWithId:(NSString *)recordId fields:(NSDictionary *)fields;
+
+- (void) removeRecordWithId:(NSString *)recordId;
+
+// Forget what we've read from the metadata store, it'll be read again when next needed
+- (void) unloadRecords;
+
+@end
@@ -0,0 +1,203 @@
+/* 
+ * Copyright (c) 2011, salesforce.com, inc.
+ * Author: Jonathan Hersh jhersh@salesforce.com
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided 
+ * that the following conditions are met:
+ * 
+ *    Redistributions of source code must retain the above copyright notice, this list of conditions and the 
+ *    following disclaimer.
+ *  
+ *    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and 
+ *    the following disclaimer in the documentation and/or other materials provided with the distribution. 
+ *    
+ *    Neither the name of salesforce.com, inc. nor the names of its contributors may be used to endorse or 
+ *    promote products derived from this software without specific prior written permission.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED 
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR 
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED 
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#import "SFVRecordStore.h"
+#import "SFVUtil.h"
+#import "SFVMetadataStore.h"
+#import "SynthesizeSingleton.h"
+
+// Metadata store section for stored records
+static NSString *kRecordSection = @"records";
+
+// A stored record fetched within this many seconds is shown without fetching it again
+static NSTimeInterval const kRecordFreshAge = 60;
+
+// A stored record older than this is never shown
+static NSTimeInterval const kRecordMaxAge = 60 * 60 * 24 * 3;
+
+// Most records to keep, the least recently used go first
+static NSUInteger const kMaxStoredRecords = 100;
+
+// Entry keys
+static NSString *kEntryRecord = @"record";
+static NSString *kEntryFieldList = @"fieldList";
+static NSString *kEntryFetchDate = @"fetchDate";
+static NSString *kEntryUseDate = @"useDate";
+
+@interface SFVRecordStore (Private)
+- (NSMutableDictionary *) entries;
+- (void) saveEntries;
+@end
+
+@implementation SFVRecordStore
+
+SYNTHESIZE_SINGLETON_FOR_CLASS(SFVRecordStore);
+
+- (void) dealloc {
+    SFRelease(entries);
+    [super dealloc];
+}
+
+- (NSMutableDictionary *) entries {
+    if( !entries ) {
+        entries = [[NSMutableDictionary alloc] init];
+        
+        NSDictionary *stored = [[SFVMetadataStore sharedSFVMetadataStore] objectForSection:kRecordSection];
+        
+        if( [stored isKindOfClass:[NSDictionary class]] )
+            for( NSString *recordId in stored )
+                [entries setObject:[NSMutableDictionary dictionaryWithDictionary:[stored objectForKey:recordId]]
+                            forKey:recordId];
+    }
+    
+    return entries;
+}
+
+// The entries are copied one level down, since we keep changing their use dates
+- (void) saveEntries {
+    NSMutableDictionary *copy = [NSMutableDictionary dictionaryWithCapacity:[entries count]];
+    
+    for( NSString *recordId in entries )
+        [copy setObject:[[[entries objectForKey:recordId] copy] autorelease] forKey:recordId];
+    
+    [[SFVMetadataStore sharedSFVMetadataStore] setObject:copy forSection:kRecordSection];
+}
+
+- (void) unloadRecords {
+    SFRelease(entries);
+}
+
+#pragma mark - reading
+
+- (NSDictionary *) recordWithId:(NSString *)recordId fieldList:(NSArray *)fieldList {
+    if( !recordId )
+        return nil;
+    
+    NSMutableDictionary *entry = [[self entries] objectForKey:recordId];
+    
+    if( !entry )
+        return nil;
+    
+    if( -[[entry objectForKey:kEntryFetchDate] timeIntervalSinceNow] > kRecordMaxAge ) {
+        [self removeRecordWithId:recordId];
+        return nil;
+    }
+    
+    if( fieldList && ![[NSSet setWithArray:fieldList] isSubsetOfSet:[NSSet setWithArray:[entry objectForKey:kEntryFieldList]]] )
+        return nil;
+    
+    [entry setObject:[NSDate date] forKey:kEntryUseDate];
+    
+    return [entry objectForKey:kEntryRecord];
+}
+
+- (BOOL) isRecordFresh:(NSString *)recordId {
+    NSDate *fetched = [[[self entries] objectForKey:recordId] objectForKey:kEntryFetchDate];
+    
+    return fetched && -[fetched timeIntervalSinceNow] < kRecordFreshAge;
+}
+
+#pragma mark - writing
+
+- (NSDictionary *) storeRecord:(NSDictionary *)record fieldList:(NSArray *)fieldList {
+    NSString *recordId = [record objectForKey:@"Id"];
+    
+    if( !recordId )
+        return nil;
+    
+    NSDictionary *previous = [[[self entries] objectForKey:recordId] objectForKey:kEntryRecord];
+    NSMutableDictionary *changes = nil;
+    
+    if( previous ) {
+        changes = [NSMutableDictionary dictionary];
+        
+        for( NSString *field in record ) {
+            id value = [record objectForKey:field];
+            
+            if( ![value isEqual:[previous objectForKey:field]] )
+                [changes setObject:value forKey:field];
+        }
+        
+        for( NSString *field in previous )
+            if( ![record objectForKey:field] )
+                [changes setObject:[NSNull null] forKey:field];
+    }
+    
+    NSMutableDictionary *entry = [NSMutableDictionary dictionaryWithObjectsAndKeys:
+                                  [[record copy] autorelease], kEntryRecord,
+                                  [[( fieldList ? fieldList : [record allKeys] ) copy] autorelease], kEntryFieldList,
+                                  [NSDate date], kEntryFetchDate,
+                                  [NSDate date], kEntryUseDate,
+                                  nil];
+    
+    [entries setObject:entry forKey:recordId];
+    
+    // Over the cap, drop the least recently used
+    while( [entries count] > kMaxStoredRecords ) {
+        NSString *oldestId = nil;
+        NSDate *oldest = nil;
+        
+        for( NSString *key in entries ) {
+            NSDate *used = [[entries objectForKey:key] objectForKey:kEntryUseDate];
+            
+            if( !oldest || [used compare:oldest] == NSOrderedAscending ) {
+                oldest = used;
+                oldestId = key;
+            }
+        }
+        
+        [entries removeObjectForKey:oldestId];
+    }
+    
+    [self saveEntries];
+    
+    return changes;
+}
+
+- (void) updateRecordWithId:(NSString *)recordId fields:(NSDictionary *)fields {
+    NSMutableDictionary *entry = [[self entries] objectForKey:recordId];
+    
+    if( !entry || [fields count] == 0 )
+        return;
+    
+    NSMutableDictionary *record = [NSMutableDictionary dictionaryWithDictionary:[entry objectForKey:kEntryRecord]];
+    [record addEntriesFromDictionary:fields];
+    [entry setObject:[[record copy] autorelease] forKey:kEntryRecord];
+    
+    [self saveEntries];
+}
+
+- (void) removeRecordWithId:(NSString *)recordId {
+    if( !recordId || ![[self entries] objectForKey:recordId] )
+        return;
+    
+    [entries removeObjectForKey:recordId];
+    [self saveEntries];
+}
+
+@end
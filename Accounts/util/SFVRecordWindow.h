@@ -0,0 +1,81 @@
+/* 
+ * Copyright (c) 2011, salesforce.com, inc.
+ * Author: Jonathan Hersh jhersh@salesforce.com
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided 
+ * that the following conditions are met:
+ * 
+ *    Redistributions of source code must retain the above copyright notice, this list of conditions and the 
+ *    following disclaimer.
+ *  
+ *    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and 
+ *    the following disclaimer in the documentation and/or other materials provided with the distribution. 
+ *    
+ *    Neither the name of salesforce.com, inc. nor the names of its contributors may be used to endorse or 
+ *    promote products derived from this software without specific prior written permission.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED 
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR 
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED 
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+// A memory-bounded store behind a long record list. Every row keeps a compact summary for as
+// long as it's in the list: its Id, type, record type, name and sort key, plus the strings its cell shows.
+// Full records are only kept for the rows nearest the viewport, and after those the rows wanted
+// most recently. Anything else is evicted. Its summary still has the Id, which is all it takes
+// to open the record.
+
+#import <Foundation/Foundation.h>
+
+@class SFVFormattedRow;
+
+@interface SFVRecordWindow : NSObject {
+    NSString *sObject;
+    NSUInteger capacity;
+    
+    // key: record Id, value: SFVFormattedRow whose record is only a summary
+    NSMutableDictionary *rows;
+    
+    // key: record Id, value: full record dictionary. Never much more than capacity.
+    NSMutableDictionary *records;
+    
+    // key: record Id, value: NSNumber of the tick it was last wanted at, one per full record
+    NSMutableDictionary *lastWanted;
+    NSUInteger tick;
+    
+    // key: record Id, value: NSNumber of how far the row is from the viewport, 0 being on screen
+    NSMutableDictionary *viewportRanks;
+}
+
+- (id) initWithObject:(NSString *)sObject capacity:(NSUInteger)capacity;
+
+// Keeps a summary of each SFVFormattedRow and puts its full record in the window. Earlier rows
+// are kept ahead of later ones, so the top of a page that's bigger than the window survives.
+// Returns the summary rows, in the same order, for the list to hold on to.
+- (NSArray *) addRows:(NSArray *)formattedRows;
+
+// The Ids of the rows on screen and around it, nearest first. These are the last records to go,
+// the furthest first. Call again whenever the list or the viewport moves.
+- (void) setViewportIds:(NSArray *)recordIds;
+
+- (SFVFormattedRow *) rowWithId:(NSString *)recordId;
+
+// The full record, or nil if it's been evicted. Marks it as wanted, so it's the last to be evicted
+// of the records away from the viewport.
+- (NSDictionary *) recordWithId:(NSString *)recordId;
+
+- (void) removeRowWithId:(NSString *)recordId;
+- (void) removeAllRows;
+
+// Rows in the list, and how many of them have their full record right now
+- (NSUInteger) rowCount;
+- (NSUInteger) recordCount;
+
+@end
@@ -0,0 +1,198 @@
+/* 
+ * Copyright (c) 2011, salesforce.com, inc.
+ * Author: Jonathan Hersh jhersh@salesforce.com
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided 
+ * that the following conditions are met:
+ * 
+ *    Redistributions of source code must retain the above copyright notice, this list of conditions and the 
+ *    following disclaimer.
+ *  
+ *    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and 
+ *    the following disclaimer in the documentation and/or other materials provided with the distribution. 
+ *    
+ *    Neither the name of salesforce.com, inc. nor the names of its contributors may be used to endorse or 
+ *    promote products derived from this software without specific prior written permission.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED 
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR 
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED 
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#import "SFVRecordWindow.h"
+#import "SFVRowFormatter.h"
+#import "SFVAppCache.h"
+#import "SFVUtil.h"
+
+@interface SFVRecordWindow (Private)
+- (NSDictionary *) summaryForRecord:(NSDictionary *)record describes:(SFVDescribeSnapshot *)describes;
+- (void) evictRecords;
+@end
+
+// Evict once we're this far over capacity, so eviction isn't done for every record added
+static float const kEvictionSlack           = 0.25f;
+
+@implementation SFVRecordWindow
+
+- (id) initWithObject:(NSString *)anObject capacity:(NSUInteger)aCapacity {
+    if(( self = [super init] )) {
+        sObject = [anObject copy];
+        capacity = MAX( aCapacity, 1 );
+        
+        rows = [[NSMutableDictionary alloc] init];
+        records = [[NSMutableDictionary alloc] initWithCapacity:capacity];
+        lastWanted = [[NSMutableDictionary alloc] initWithCapacity:capacity];
+        viewportRanks = [[NSMutableDictionary alloc] initWithCapacity:capacity];
+    }
+    
+    return self;
+}
+
+- (void) dealloc {
+    SFRelease(sObject);
+    SFRelease(rows);
+    SFRelease(records);
+    SFRelease(lastWanted);
+    SFRelease(viewportRanks);
+    [super dealloc];
+}
+
+#pragma mark - rows
+
+// Just enough of a record to name it, sort it and open it with the right layout
+- (NSDictionary *) summaryForRecord:(NSDictionary *)record describes:(SFVDescribeSnapshot *)describes {
+    NSMutableDictionary *summary = [NSMutableDictionary dictionaryWithCapacity:5];
+    NSString *type = [record objectForKey:kObjectTypeKey];
+    
+    if( !type )
+        type = sObject;
+    
+    for( NSString *field in [NSArray arrayWithObjects:@"Id", kRecordTypeIdField, @"LastName", [describes nameFieldForsObject:type], nil] ) {
+        id value = [record objectForKey:field];
+        
+        if( value )
+            [summary setObject:value forKey:field];
+    }
+    
+    if( type )
+        [summary setObject:type forKey:kObjectTypeKey];
+    
+    return summary;
+}
+
+- (NSArray *) addRows:(NSArray *)formattedRows {
+    NSMutableArray *summaries = [NSMutableArray arrayWithCapacity:[formattedRows count]];
+    SFVDescribeSnapshot *describes = [[SFVAppCache sharedSFVAppCache] describeSnapshot];
+    
+    // Rows are wanted in the order they're listed, so the first row of the page gets the latest tick
+    tick += [formattedRows count];
+    NSUInteger rowTick = tick;
+    
+    for( SFVFormattedRow *row in formattedRows ) {
+        NSString *recordId = [row recordId];
+        SFVFormattedRow *summary = [row rowWithRecord:[self summaryForRecord:[row record] describes:describes]];
+        
+        [summaries addObject:summary];
+        
+        if( !recordId )
+            continue;
+        
+        [rows setObject:summary forKey:recordId];
+        [records setObject:[row record] forKey:recordId];
+        [lastWanted setObject:[NSNumber numberWithUnsignedInteger:rowTick--] forKey:recordId];
+    }
+    
+    [self evictRecords];
+    
+    return summaries;
+}
+
+- (void) setViewportIds:(NSArray *)recordIds {
+    NSUInteger rank = 0;
+    
+    [viewportRanks removeAllObjects];
+    
+    for( NSString *recordId in recordIds )
+        if( ![viewportRanks objectForKey:recordId] )
+            [viewportRanks setObject:[NSNumber numberWithUnsignedInteger:rank++] forKey:recordId];
+    
+    [self evictRecords];
+}
+
+- (SFVFormattedRow *) rowWithId:(NSString *)recordId {
+    return ( recordId ? [rows objectForKey:recordId] : nil );
+}
+
+- (NSDictionary *) recordWithId:(NSString *)recordId {
+    if( !recordId || ![rows objectForKey:recordId] )
+        return nil;
+    
+    NSDictionary *record = [records objectForKey:recordId];
+    
+    if( record )
+        [lastWanted setObject:[NSNumber numberWithUnsignedInteger:++tick] forKey:recordId];
+    
+    return record;
+}
+
+- (void) removeRowWithId:(NSString *)recordId {
+    if( !recordId )
+        return;
+    
+    [rows removeObjectForKey:recordId];
+    [records removeObjectForKey:recordId];
+    [lastWanted removeObjectForKey:recordId];
+}
+
+- (void) removeAllRows {
+    [rows removeAllObjects];
+    [records removeAllObjects];
+    [lastWanted removeAllObjects];
+    [viewportRanks removeAllObjects];
+}
+
+- (NSUInteger) rowCount {
+    return [rows count];
+}
+
+- (NSUInteger) recordCount {
+    return [records count];
+}
+
+#pragma mark - the window
+
+// Drops records until we're back to capacity: first those away from the viewport, least recently
+// wanted first, then those around it, furthest first
+- (void) evictRecords {
+    if( [records count] <= capacity + (NSUInteger)( capacity * kEvictionSlack ) )
+        return;
+    
+    NSArray *evictFirst = [[records allKeys] sortedArrayUsingComparator:^NSComparisonResult(id a, id b) {
+        NSNumber *rankA = [viewportRanks objectForKey:a], *rankB = [viewportRanks objectForKey:b];
+        
+        if( rankA && rankB )
+            return [rankB compare:rankA];
+        
+        if( rankA || rankB )
+            return ( rankA ? NSOrderedDescending : NSOrderedAscending );
+        
+        return [[lastWanted objectForKey:a] compare:[lastWanted objectForKey:b]];
+    }];
+    NSUInteger evict = [records count] - capacity;
+    
+    for( NSUInteger i = 0; i < evict && i < [evictFirst count]; i++ ) {
+        NSString *recordId = [evictFirst objectAtIndex:i];
+        
+        [records removeObjectForKey:recordId];
+        [lastWanted removeObjectForKey:recordId];
+    }
+}
+
+@end
@@ -0,0 +1,84 @@
+/* 
+ * Copyright (c) 2011, salesforce.com, inc.
+ * Author: Jonathan Hersh jhersh@salesforce.com
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided 
+ * that the following conditions are met:
+ * 
+ *    Redistributions of source code must retain the above copyright notice, this list of conditions and the 
+ *    following disclaimer.
+ *  
+ *    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and 
+ *    the following disclaimer in the documentation and/or other materials provided with the distribution. 
+ *    
+ *    Neither the name of salesforce.com, inc. nor the names of its contributors may be used to endorse or 
+ *    promote products derived from this software without specific prior written permission.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED 
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR 
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED 
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+// The view-model stage between a query and a list. Raw results go in, and come back on the main
+// queue as rows that are ready to draw: each record converted to a dictionary, with its name, sort
+// name, display strings and date worked out on a background queue. All of that is done against a
+// describe snapshot taken when the formatter is made, so metadata can keep changing meanwhile.
+
+#import <Foundation/Foundation.h>
+
+@class SFVDescribeSnapshot;
+
+@interface SFVFormattedRow : NSObject {
+    NSDictionary *record;
+    NSString *name, *sortName;
+    NSArray *values;
+    NSTimeInterval date;
+}
+
+// The record as a dictionary, with its type under kObjectTypeKey
+@property (nonatomic, readonly) NSDictionary *record;
+
+// As nameForSObject: and +[SFVSectionedList sortNameForRecord:]
+@property (nonatomic, readonly) NSString *name;
+@property (nonatomic, readonly) NSString *sortName;
+
+// One display string per field the formatter was made with, never nil
+@property (nonatomic, readonly) NSArray *values;
+
+// Seconds since 1970 of the formatter's dateField, 0 if it doesn't have one
+@property (nonatomic, readonly) NSTimeInterval date;
+
+- (NSString *) recordId;
+
+// The same row around a different record, e.g. a smaller summary of this one
+- (SFVFormattedRow *) rowWithRecord:(NSDictionary *)aRecord;
+
+@end
+
+typedef void (^RowFormatCompletionBlock) (NSArray *rows);
+
+@interface SFVRowFormatter : NSObject {
+    NSArray *fields;
+    NSString *dateField;
+    SFVDescribeSnapshot *describes;
+}
+
+// Each field is anything textValueForField:withDictionary: takes. dateField may be nil.
+- (id) initWithFields:(NSArray *)fields dateField:(NSString *)dateField;
+
+// ZKSObjects or dictionaries in, SFVFormattedRows out in the same order, on the main queue
+- (void) formatRecords:(NSArray *)records completeBlock:(RowFormatCompletionBlock)completeBlock;
+
+// The same, right now, on whatever thread this is
+- (NSArray *) rowsForRecords:(NSArray *)records;
+
+@property (nonatomic, readonly) NSArray *fields;
+
+@end
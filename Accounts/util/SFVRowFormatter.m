@@ -0,0 +1,159 @@
+/* 
+ * Copyright (c) 2011, salesforce.com, inc.
+ * Author: Jonathan Hersh jhersh@salesforce.com
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided 
+ * that the following conditions are met:
+ * 
+ *    Redistributions of source code must retain the above copyright notice, this list of conditions and the 
+ *    following disclaimer.
+ *  
+ *    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and 
+ *    the following disclaimer in the documentation and/or other materials provided with the distribution. 
+ *    
+ *    Neither the name of salesforce.com, inc. nor the names of its contributors may be used to endorse or 
+ *    promote products derived from this software without specific prior written permission.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED 
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR 
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED 
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#import "SFVRowFormatter.h"
+#import "SFVUtil.h"
+#import "SFVAsync.h"
+#import "SFVAppCache.h"
+#import "SFVSectionedList.h"
+
+@interface SFVFormattedRow (Private)
+- (id) initWithRecord:(NSDictionary *)aRecord name:(NSString *)aName sortName:(NSString *)aSortName 
+               values:(NSArray *)someValues date:(NSTimeInterval)aDate;
+@end
+
+@implementation SFVFormattedRow
+
+@synthesize record, name, sortName, values, date;
+
+- (id) initWithRecord:(NSDictionary *)aRecord name:(NSString *)aName sortName:(NSString *)aSortName 
+               values:(NSArray *)someValues date:(NSTimeInterval)aDate {
+    if(( self = [super init] )) {
+        record = [aRecord retain];
+        name = [aName copy];
+        sortName = [aSortName copy];
+        values = [someValues copy];
+        date = aDate;
+    }
+    
+    return self;
+}
+
+- (void) dealloc {
+    SFRelease(record);
+    SFRelease(name);
+    SFRelease(sortName);
+    SFRelease(values);
+    [super dealloc];
+}
+
+- (NSString *) recordId {
+    return [record objectForKey:@"Id"];
+}
+
+- (SFVFormattedRow *) rowWithRecord:(NSDictionary *)aRecord {
+    return [[[SFVFormattedRow alloc] initWithRecord:aRecord
+                                               name:name
+                                           sortName:sortName
+                                             values:values
+                                               date:date] autorelease];
+}
+
+@end
+
+@implementation SFVRowFormatter
+
+@synthesize fields;
+
+// Formatting is mostly string work, so one page at a time, in order, is plenty
+static dispatch_queue_t formatQueue = NULL;
+
++ (void) initialize {
+    if( self == [SFVRowFormatter class] )
+        formatQueue = dispatch_queue_create("com.salesforce.rowformatter", NULL);
+}
+
+- (id) initWithFields:(NSArray *)someFields dateField:(NSString *)aDateField {
+    if(( self = [super init] )) {
+        fields = [( someFields ? someFields : [NSArray array] ) copy];
+        dateField = [aDateField copy];
+        describes = [[[SFVAppCache sharedSFVAppCache] describeSnapshot] retain];
+    }
+    
+    return self;
+}
+
+- (void) dealloc {
+    SFRelease(fields);
+    SFRelease(dateField);
+    SFRelease(describes);
+    [super dealloc];
+}
+
+- (NSArray *) rowsForRecords:(NSArray *)records {
+    NSArray *dicts = [SFVAsync ZKSObjectArrayToDictionaryArray:records];
+    NSMutableArray *rows = [NSMutableArray arrayWithCapacity:[dicts count]];
+    SFVUtil *util = [SFVUtil sharedSFVUtil];
+    
+    for( NSDictionary *record in dicts ) {
+        NSMutableArray *values = [NSMutableArray arrayWithCapacity:[fields count]];
+        NSTimeInterval date = 0;
+        
+        for( NSString *field in fields ) {
+            NSString *value = [util textValueForField:field withDictionary:record describes:describes];
+            
+            [values addObject:( value ? value : @"" )];
+        }
+        
+        if( dateField )
+            date = [SFVUtil timeIntervalFromSOQLDatetime:[record objectForKey:dateField]];
+        
+        SFVFormattedRow *row = [[SFVFormattedRow alloc] initWithRecord:record
+                                                                  name:[describes nameForSObject:record]
+                                                              sortName:[SFVSectionedList sortNameForRecord:record describes:describes]
+                                                                values:values
+                                                                  date:date];
+        [rows addObject:row];
+        [row release];
+    }
+    
+    return rows;
+}
+
+- (void) formatRecords:(NSArray *)records completeBlock:(RowFormatCompletionBlock)completeBlock {
+    RowFormatCompletionBlock block = [[completeBlock copy] autorelease];
+    
+    [self retain];
+    [records retain];
+    
+    dispatch_async(formatQueue, ^{
+        NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+        NSArray *rows = [[self rowsForRecords:records] retain];
+        [pool drain];
+        
+        dispatch_async(dispatch_get_main_queue(), ^{
+            block( rows );
+            
+            [rows release];
+            [records release];
+            [self release];
+        });
+    });
+}
+
+@end
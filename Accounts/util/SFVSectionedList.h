@@ -0,0 +1,82 @@
+/* 
+ * Copyright (c) 2011, salesforce.com, inc.
+ * Author: Jonathan Hersh jhersh@salesforce.com
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided 
+ * that the following conditions are met:
+ * 
+ *    Redistributions of source code must retain the above copyright notice, this list of conditions and the 
+ *    following disclaimer.
+ *  
+ *    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and 
+ *    the following disclaimer in the documentation and/or other materials provided with the distribution. 
+ *    
+ *    Neither the name of salesforce.com, inc. nor the names of its contributors may be used to endorse or 
+ *    promote products derived from this software without specific prior written permission.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED 
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR 
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED 
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+// Records grouped into sections by the first letter of their name, each section in name order.
+// Each record's name is worked out once, when it's added, and kept alongside it so pages of
+// records can be merged in by binary search.
+
+#import <Foundation/Foundation.h>
+
+@class SFVDescribeSnapshot;
+
+@interface SFVSectionedList : NSObject {
+    // key: section title, value: NSMutableArray of record dictionaries in name order
+    NSMutableDictionary *sections;
+    
+    // key: section title, value: NSMutableArray of names, parallel to the section's records
+    NSMutableDictionary *sectionNames;
+    
+    // Section titles in display order, kept up to date as sections come and go
+    NSMutableArray *sectionTitles;
+    
+    NSUInteger recordCount;
+}
+
+// The name a record is sorted by. Leads and Contacts always use their last name.
++ (NSString *) sortNameForRecord:(NSDictionary *)record;
++ (NSString *) sortNameForRecord:(NSDictionary *)record describes:(SFVDescribeSnapshot *)describes;
+
+// First letter of the name, uppercase, or # for anything that isn't a letter
++ (NSString *) sectionTitleForSortName:(NSString *)name;
+
+// A list with these sections already in it, as returned by -sections
+- (id) initWithSections:(NSDictionary *)sections;
+
+// Add dictionaries or ZKSObjects, in any order
+- (void) addRecords:(NSArray *)records;
+
+// Add dictionaries whose sort names are already known, e.g. from an SFVRowFormatter
+- (void) addRecords:(NSArray *)records sortNames:(NSArray *)names;
+
+// Returns YES if a record with this Id was found and removed. Empty sections are removed too.
+- (BOOL) removeRecordWithId:(NSString *)recordId;
+
+- (void) removeAllRecords;
+
+// key: section title, value: array of records in name order. Changes as records are added and removed.
+@property (nonatomic, readonly) NSMutableDictionary *sections;
+
+// Section titles, sorted the same way as +[SFVUtil sortArray:]. Changes as sections are added and removed.
+@property (nonatomic, readonly) NSArray *sectionTitles;
+
+@property (nonatomic, readonly) NSUInteger recordCount;
+
+- (NSArray *) recordsInSection:(NSUInteger)section;
+- (NSDictionary *) recordAtIndexPath:(NSIndexPath *)indexPath;
+
+@end
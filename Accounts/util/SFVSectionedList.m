@@ -0,0 +1,279 @@
+/* 
+ * Copyright (c) 2011, salesforce.com, inc.
+ * Author: Jonathan Hersh jhersh@salesforce.com
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided 
+ * that the following conditions are met:
+ * 
+ *    Redistributions of source code must retain the above copyright notice, this list of conditions and the 
+ *    following disclaimer.
+ *  
+ *    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and 
+ *    the following disclaimer in the documentation and/or other materials provided with the distribution. 
+ *    
+ *    Neither the name of salesforce.com, inc. nor the names of its contributors may be used to endorse or 
+ *    promote products derived from this software without specific prior written permission.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED 
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR 
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED 
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#import "SFVSectionedList.h"
+#import "SFVUtil.h"
+#import "SFVAsync.h"
+#import "SFVAppCache.h"
+
+@interface SFVSectionedList (Private)
+- (void) insertRecords:(NSArray *)records names:(NSArray *)names intoSection:(NSString *)title;
+- (void) addSectionTitle:(NSString *)title;
+@end
+
+// Index of the first name that sorts at or after this one
+static NSUInteger lowerBound( NSArray *names, NSString *name, NSUInteger low ) {
+    NSUInteger high = [names count];
+    
+    while( low < high ) {
+        NSUInteger mid = low + ( high - low ) / 2;
+        
+        if( [name compare:[names objectAtIndex:mid] options:NSCaseInsensitiveSearch] == NSOrderedDescending )
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    
+    return low;
+}
+
+@implementation SFVSectionedList
+
+@synthesize sections, sectionTitles, recordCount;
+
++ (NSString *) sortNameForRecord:(NSDictionary *)record {
+    return [self sortNameForRecord:record describes:[[SFVAppCache sharedSFVAppCache] describeSnapshot]];
+}
+
++ (NSString *) sortNameForRecord:(NSDictionary *)record describes:(SFVDescribeSnapshot *)describes {
+    NSString *name = nil;
+    NSString *type = [record objectForKey:kObjectTypeKey];
+    
+    if( [type isEqualToString:@"Lead"] || [type isEqualToString:@"Contact"] )
+        name = [record objectForKey:@"LastName"];
+    else
+        name = [describes nameForSObject:record];
+    
+    return ( [SFVUtil isEmpty:name] ? @"" : name );
+}
+
++ (NSString *) sectionTitleForSortName:(NSString *)name {
+    if( [name length] == 0 || ![[NSCharacterSet letterCharacterSet] characterIsMember:[name characterAtIndex:0]] )
+        return @"#";
+    
+    return [[name substringToIndex:1] uppercaseString];
+}
+
+- (id) init {
+    if(( self = [super init] )) {
+        sections = [[NSMutableDictionary alloc] init];
+        sectionNames = [[NSMutableDictionary alloc] init];
+        sectionTitles = [[NSMutableArray alloc] init];
+    }
+    
+    return self;
+}
+
+- (id) initWithSections:(NSDictionary *)existing {
+    if(( self = [self init] )) {
+        for( NSString *title in existing ) {
+            NSArray *records = [existing objectForKey:title];
+            NSMutableArray *names = [NSMutableArray arrayWithCapacity:[records count]];
+            SFVDescribeSnapshot *describes = [[SFVAppCache sharedSFVAppCache] describeSnapshot];
+            
+            for( NSDictionary *record in records )
+                [names addObject:[[self class] sortNameForRecord:record describes:describes]];
+            
+            [sections setObject:[NSMutableArray arrayWithArray:records] forKey:title];
+            [sectionNames setObject:names forKey:title];
+            recordCount += [records count];
+        }
+        
+        [sectionTitles setArray:[SFVUtil sortArray:[sections allKeys]]];
+    }
+    
+    return self;
+}
+
+- (void) dealloc {
+    SFRelease(sections);
+    SFRelease(sectionNames);
+    SFRelease(sectionTitles);
+    [super dealloc];
+}
+
+#pragma mark - adding and removing
+
+- (void) addRecords:(NSArray *)records {
+    if( [records count] == 0 )
+        return;
+    
+    NSArray *dicts = [SFVAsync ZKSObjectArrayToDictionaryArray:records];
+    NSMutableArray *names = [NSMutableArray arrayWithCapacity:[dicts count]];
+    SFVDescribeSnapshot *describes = [[SFVAppCache sharedSFVAppCache] describeSnapshot];
+    
+    for( NSDictionary *record in dicts )
+        [names addObject:[[self class] sortNameForRecord:record describes:describes]];
+    
+    [self addRecords:dicts sortNames:names];
+}
+
+- (void) addRecords:(NSArray *)dicts sortNames:(NSArray *)names {
+    NSUInteger count = [dicts count];
+    
+    if( count == 0 || [names count] != count )
+        return;
+    
+    NSMutableArray *order = [NSMutableArray arrayWithCapacity:count];
+    
+    for( NSUInteger i = 0; i < count; i++ )
+        [order addObject:[NSNumber numberWithUnsignedInteger:i]];
+    
+    // Pages usually arrive in name order already, so a stable sort is cheap
+    [order sortWithOptions:NSSortStable usingComparator:^NSComparisonResult(id a, id b) {
+        return [[names objectAtIndex:[a unsignedIntegerValue]] compare:[names objectAtIndex:[b unsignedIntegerValue]]
+                                                                options:NSCaseInsensitiveSearch];
+    }];
+    
+    // Split the page into sections, then merge each into the matching section
+    NSMutableDictionary *pageRecords = [NSMutableDictionary dictionary];
+    NSMutableDictionary *pageNames = [NSMutableDictionary dictionary];
+    
+    for( NSNumber *i in order ) {
+        NSString *name = [names objectAtIndex:[i unsignedIntegerValue]];
+        NSString *title = [[self class] sectionTitleForSortName:name];
+        
+        if( ![pageRecords objectForKey:title] ) {
+            [pageRecords setObject:[NSMutableArray array] forKey:title];
+            [pageNames setObject:[NSMutableArray array] forKey:title];
+        }
+        
+        [[pageRecords objectForKey:title] addObject:[dicts objectAtIndex:[i unsignedIntegerValue]]];
+        [[pageNames objectForKey:title] addObject:name];
+    }
+    
+    for( NSString *title in pageRecords )
+        [self insertRecords:[pageRecords objectForKey:title] 
+                      names:[pageNames objectForKey:title] 
+                intoSection:title];
+    
+    recordCount += count;
+}
+
+// records and names are sorted by name
+- (void) insertRecords:(NSArray *)records names:(NSArray *)names intoSection:(NSString *)title {
+    NSMutableArray *sectionRecords = [sections objectForKey:title];
+    NSMutableArray *existingNames = [sectionNames objectForKey:title];
+    
+    if( !sectionRecords ) {
+        [sections setObject:[NSMutableArray arrayWithArray:records] forKey:title];
+        [sectionNames setObject:[NSMutableArray arrayWithArray:names] forKey:title];
+        [self addSectionTitle:title];
+        return;
+    }
+    
+    // Everything goes after what we already have
+    if( [[names objectAtIndex:0] compare:[existingNames lastObject] options:NSCaseInsensitiveSearch] == NSOrderedDescending ) {
+        [sectionRecords addObjectsFromArray:records];
+        [existingNames addObjectsFromArray:names];
+        return;
+    }
+    
+    // Each name sorts at or after the one before it, so each search starts where the last one left off
+    NSUInteger position = 0;
+    
+    for( NSUInteger i = 0; i < [records count]; i++ ) {
+        NSString *name = [names objectAtIndex:i];
+        
+        position = lowerBound( existingNames, name, position );
+        
+        [sectionRecords insertObject:[records objectAtIndex:i] atIndex:position];
+        [existingNames insertObject:name atIndex:position];
+        position++;
+    }
+}
+
+- (BOOL) removeRecordWithId:(NSString *)recordId {
+    if( !recordId )
+        return NO;
+    
+    for( NSString *title in [sections allKeys] ) {
+        NSMutableArray *sectionRecords = [sections objectForKey:title];
+        
+        for( NSUInteger i = 0; i < [sectionRecords count]; i++ ) {
+            if( ![[[sectionRecords objectAtIndex:i] objectForKey:@"Id"] isEqualToString:recordId] )
+                continue;
+            
+            [sectionRecords removeObjectAtIndex:i];
+            [[sectionNames objectForKey:title] removeObjectAtIndex:i];
+            recordCount--;
+            
+            if( [sectionRecords count] == 0 ) {
+                [sections removeObjectForKey:title];
+                [sectionNames removeObjectForKey:title];
+                [sectionTitles removeObject:title];
+            }
+            
+            return YES;
+        }
+    }
+    
+    return NO;
+}
+
+- (void) removeAllRecords {
+    [sections removeAllObjects];
+    [sectionNames removeAllObjects];
+    [sectionTitles removeAllObjects];
+    recordCount = 0;
+}
+
+- (void) addSectionTitle:(NSString *)title {
+    NSUInteger low = 0, high = [sectionTitles count];
+    
+    while( low < high ) {
+        NSUInteger mid = low + ( high - low ) / 2;
+        
+        if( [title localizedCaseInsensitiveCompare:[sectionTitles objectAtIndex:mid]] == NSOrderedDescending )
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    
+    [sectionTitles insertObject:title atIndex:low];
+}
+
+#pragma mark - index paths
+
+- (NSArray *) recordsInSection:(NSUInteger)section {
+    if( section >= [sectionTitles count] )
+        return nil;
+    
+    return [sections objectForKey:[sectionTitles objectAtIndex:section]];
+}
+
+- (NSDictionary *) recordAtIndexPath:(NSIndexPath *)indexPath {
+    NSArray *records = [self recordsInSection:indexPath.section];
+    
+    if( indexPath.row < 0 || indexPath.row >= [records count] )
+        return nil;
+    
+    return [records objectAtIndex:indexPath.row];
+}
+
+@end
@@ -30,10 +30,14 @@
 #import <EventKit/EventKit.h>
 #import <MapKit/MapKit.h>
 
+@class SFVLayoutStore, SFVDescribeSnapshot;
+
 @interface SFVUtil : NSObject {
-    NSMutableDictionary *layoutCache;
+    SFVLayoutStore *layoutStore;
     NSMutableDictionary *geoLocationCache;
-    NSMutableDictionary *userPhotoCache;
+    
+    // Images being loaded from disk or the network. key: image cache key, value: array of ImageCompletionBlock
+    NSMutableDictionary *imageLoadBlocks;
     NSUInteger *activityCount;
 }
 
@@ -123,6 +127,7 @@ enum dateGroups {
 + (BOOL) isConnected;
 
 - (void) emptyCaches:(BOOL)emptyAll;
+- (void) loadLayoutsFromMetadataStore;
 - (NSArray *) coordinatesFromCache:(NSString *)accountId;
 - (void) addCoordinatesToCache:(CLLocationCoordinate2D)coordinates accountId:(NSString *)accountId;
 - (UIImage *) userPhotoFromCache:(NSString *)photoURL;
@@ -130,6 +135,9 @@ enum dateGroups {
 
 // Creating a page layout for a record
 - (NSString *)textValueForField:(NSString *)fieldName withDictionary:(NSDictionary *)sObject;
+
+// Same, against a describe snapshot instead of the live app cache, so it's safe on any thread
+- (NSString *)textValueForField:(NSString *)fieldName withDictionary:(NSDictionary *)sObject describes:(SFVDescribeSnapshot *)describes;
 + (UIView *) createViewForSection:(NSString *)section maxWidth:(float)maxWidth;
 - (UIView *) createViewForLayoutItem:(ZKDescribeLayoutItem *)item withRecord:(NSDictionary *)dict withTarget:(id)target;
 - (UIView *) layoutViewForsObject:(NSDictionary *)sObject withTarget:(id)target singleColumn:(BOOL)singleColumn;
@@ -145,11 +153,20 @@ enum dateGroups {
 
 // Describe sObject layouts  
 - (void) describeLayoutForsObject:(NSString *)sObject completeBlock:(DescribeLayoutCompletionBlock)completeBlock;
+
+// With refresh set, always asks the server, and replaces the stored layouts for sObject with the result
+- (void) describeLayoutForsObject:(NSString *)sObject refresh:(BOOL)refresh completeBlock:(DescribeLayoutCompletionBlock)completeBlock;
+
+// Objects whose layouts we have, described this session or loaded from the metadata store
+- (NSArray *) sObjectsWithLayouts;
 - (ZKDescribeLayout *) layoutForRecord:(NSDictionary *)record;
 - (NSString *) layoutIDForRecord:(NSDictionary *)record;
 - (ZKDescribeLayout *) layoutWithLayoutId:(NSString *)layoutId;
 - (NSString *) sObjectFromLayoutId:(NSString *)layoutId;
 - (NSArray *) fieldListForLayoutId:(NSString *)layoutId;
+
+// Goes up every time layouts are added or removed
+- (NSUInteger) layoutGeneration;
 - (NSString *) sObjectFromRecordTypeId:(NSString *)recordTypeId;
 
 // key: id, value: name
@@ -181,17 +198,39 @@ enum dateGroups {
          maxDimension:(CGFloat)maxDimension
         completeBlock:(ImageCompletionBlock)completeBlock;
 
+// Rounds the corners of the image too. Images are decoded, resized and rounded off the main thread.
+- (void) loadImageFromURL:(NSString *)url 
+                    cache:(BOOL)cache 
+             maxDimension:(CGFloat)maxDimension
+             cornerRadius:(CGFloat)cornerRadius
+            completeBlock:(ImageCompletionBlock)completeBlock;
+
 + (NSString *) truncateURL:(NSString *)url;
 + (NSString *) trimWhiteSpaceFromString:(NSString *)source;
 + (BOOL) isEmpty:(id) thing;
 + (NSArray *) randomSubsetFromArray:(NSArray *)original ofSize:(int) size;
 + (NSDictionary *) dictionaryFromRecordsGroupedByDate:(NSArray *)records dateField:(NSString *)dateField;
+
+// Seconds since 1970 of each record's dateField, one NSTimeInterval per record in the same order.
+// Parse the dates once with this, then group and compare the column instead of the strings.
++ (NSData *) dateColumnForRecords:(NSArray *)records dateField:(NSString *)dateField;
++ (NSDictionary *) dictionaryFromRecords:(NSArray *)records groupedByDateColumn:(NSData *)column;
++ (enum dateGroups) dateGroupForTimeAgo:(NSTimeInterval)timeAgo;
+
 + (NSDictionary *) dictionaryFromAccountArray:(NSArray *)results;
 + (NSDictionary *) accountFromIndexPath:(NSIndexPath *)ip accountDictionary:(NSDictionary *)allAccounts;
 + (NSIndexPath *) indexPathForAccountDictionary:(NSDictionary *)account allAccountDictionary:(NSDictionary *)allAccounts;
+
+// As above, with the dictionary's keys already sorted by sortArray:, so callers that keep them don't re-sort
++ (NSDictionary *) accountFromIndexPath:(NSIndexPath *)ip accountDictionary:(NSDictionary *)allAccounts sortedKeys:(NSArray *)sortedKeys;
++ (NSIndexPath *) indexPathForAccountDictionary:(NSDictionary *)account allAccountDictionary:(NSDictionary *)allAccounts sortedKeys:(NSArray *)sortedKeys;
 + (NSDictionary *) dictionaryByAddingAccounts:(NSArray *)accounts toDictionary:(NSDictionary *)allAccounts;
 + (NSString *) SOQLDatetimeFromDate:(NSDate *)date isDateTime:(BOOL)isDateTime;
 + (NSDate *) dateFromSOQLDatetime:(NSString *)datetime;
+
+// Seconds since 1970 for a SOQL date or datetime. Missing and unreadable values count as now,
+// so lists, date groups and cells all put them in the same place.
++ (NSTimeInterval) timeIntervalFromSOQLDatetime:(id)datetime;
 + (NSArray *) filterRecords:(NSArray *)records dateField:(NSString *)dateField withDate:(NSDate *)date createdAfter:(BOOL)createdAfter;
 + (NSString *) relativeTime:(NSDate *)sinceDate;
 + (NSArray *) sortArray:(NSArray *) toSort;
@@ -37,10 +37,18 @@
 #import "RootViewController.h"
 #import <QuartzCore/QuartzCore.h>
 #import "SFVAsync.h"
+#import "SFVFormatterPool.h"
 #import "SFVAppCache.h"
-#import <objc/runtime.h>
 #import "NSData+Base64.h"
 #import "UIImage+ImageUtils.h"
+#import "SFVMetadataStore.h"
+#import "SFVLayoutStore.h"
+#import "SFVFieldDescribe.h"
+#import "SFVFieldListPlanner.h"
+#import "SFVImageCache.h"
+#import "SFVImageDecoder.h"
+#import "SFVRecordStore.h"
+#import "SFVSectionedList.h"
 
 @implementation SFVUtil
 
@@ -52,11 +60,12 @@ SYNTHESIZE_SINGLETON_FOR_CLASS(SFVUtil);
 // Maximum number of recent records to store
 static int const kMaxRecentRecords = 250;
 
+// Metadata store section for layoutStore
+static NSString *kLayoutSection = @"layouts";
+
 // Size of a userphoto for field layouts
 static CGFloat const kUserPhotoSize = 26.0f;
-
-// Character used to save completion blocks in an array on each image load request
-static char imageLoadCompleteBlockArray;
+static CGFloat const kUserPhotoCornerRadius = 5.0f;
 
 BOOL chatterEnabled = NO;
 
@@ -77,14 +86,28 @@ BOOL chatterEnabled = NO;
     
     activityCount = 0;
     [geoLocationCache removeAllObjects];
-    [userPhotoCache removeAllObjects];
+    [[SFVImageCache sharedSFVImageCache] removeAllMemoryImages];
+    [[SFVRecordStore sharedSFVRecordStore] unloadRecords];
     self.eventStore = nil;
     
     if( emptyAll ) {
-        [layoutCache removeAllObjects];
+        [layoutStore removeAllLayouts];
+        [[SFVFieldListPlanner sharedSFVFieldListPlanner] removeAllPlans];
     }
 }
 
+- (void) loadLayoutsFromMetadataStore {
+    NSDictionary *layouts = [[SFVMetadataStore sharedSFVMetadataStore] objectForSection:kLayoutSection];
+    
+    if( !layoutStore )
+        layoutStore = [[SFVLayoutStore alloc] init];
+    
+    [layoutStore removeAllLayouts];
+    
+    for( NSString *sObject in layouts )
+        [layoutStore addLayoutResult:[layouts objectForKey:sObject] forSObject:sObject];
+}
+
 - (EKEventStore *)sharedEventStore {
     if( !self.eventStore )
         self.eventStore = [[[EKEventStore alloc] init] autorelease];
@@ -109,25 +132,19 @@ BOOL chatterEnabled = NO;
 }
 
 - (void) addUserPhotoToCache:(UIImage *)photo forURL:(NSString *)photoURL {
-    if( !userPhotoCache )
-        userPhotoCache = [[NSMutableDictionary dictionary] retain];
-    
-    if( !photo )
+    if( !photo || !photoURL )
         return;
         
-    [userPhotoCache setObject:photo forKey:photoURL];
+    [[SFVImageCache sharedSFVImageCache] setImage:[photo imageAtScale] 
+                                           forKey:[SFVImageCache cacheKeyForURL:photoURL] 
+                                     maxDimension:0];
 }
 
 - (UIImage *) userPhotoFromCache:(NSString *)photoURL {
-    if( !userPhotoCache )
-        userPhotoCache = [[NSMutableDictionary dictionary] retain];
-    
-    id cached = [userPhotoCache objectForKey:photoURL];
-    
-    if( cached && [cached isKindOfClass:[UIImage class]] )
-        return [(UIImage *)cached imageAtScale];
+    if( !photoURL )
+        return nil;
     
-    return nil;
+    return [[SFVImageCache sharedSFVImageCache] imageForKey:[SFVImageCache cacheKeyForURL:photoURL] maxDimension:0];
 }
 
 #pragma mark - rendering an account layout
@@ -298,13 +315,12 @@ BOOL chatterEnabled = NO;
                              [[SFVUtil sharedSFVUtil] loadImageFromURL:imageURL
                                                                  cache:YES
                                                           maxDimension:kUserPhotoSize
+                                                          cornerRadius:kUserPhotoCornerRadius
                                                          completeBlock:^(UIImage *img, BOOL wasLoadedFromCache) {          
                                                              UIImageView *photoView = [[UIImageView alloc] initWithImage:img];
                                                              [photoView setFrame:CGRectMake( CGRectGetMaxX(fieldLabel.frame) + 10, 
                                                                                      0 + ( img.size.height > 22 ? -2 : 2 ), 
                                                                                      img.size.width, img.size.height)];
-                                                             photoView.layer.cornerRadius = 5.0f;
-                                                             photoView.layer.masksToBounds = YES;
                                                              
                                                              [fieldView addSubview:photoView];
                                                              [photoView release];
@@ -553,11 +569,11 @@ BOOL chatterEnabled = NO;
     return addressStr;
 }
 
-+ (NSString *)wildAssedGuessAtStringifyingObject:(id)result {    
++ (NSString *)wildAssedGuessAtStringifyingObject:(id)result describes:(SFVDescribeSnapshot *)describes {    
     if( !result || [result isKindOfClass:[NSNull class]] )
         return @"";
     else if( [result isKindOfClass:[NSDictionary class]] )
-        return [[SFVAppCache sharedSFVAppCache] nameForSObject:result];
+        return [describes nameForSObject:result];
     else if( [result isKindOfClass:[NSString class]] )
         return (NSString *)result;
     else if( [result respondsToSelector:@selector(stringValue)] )
@@ -569,6 +585,12 @@ BOOL chatterEnabled = NO;
 }
 
 - (NSString *)textValueForField:(NSString *)fieldName withDictionary:(NSDictionary *)sObject {
+    return [self textValueForField:fieldName 
+                    withDictionary:sObject 
+                         describes:[[SFVAppCache sharedSFVAppCache] describeSnapshot]];
+}
+
+- (NSString *)textValueForField:(NSString *)fieldName withDictionary:(NSDictionary *)sObject describes:(SFVDescribeSnapshot *)describes {
     NSString *sObjectName = nil;
     
     if( !fieldName )
@@ -579,7 +601,7 @@ BOOL chatterEnabled = NO;
     else if( ![SFVUtil isEmpty:[sObject objectForKey:kObjectTypeKey]] )
         sObjectName = [sObject objectForKey:kObjectTypeKey];
     else
-        sObjectName = [[SFVAppCache sharedSFVAppCache] sObjectFromRecordId:[sObject objectForKey:@"Id"]];
+        sObjectName = [describes sObjectFromRecordId:[sObject objectForKey:@"Id"]];
     
     // JANKY HACK ALERT
     if( [sObjectName isEqualToString:@"ActivityHistory"] || [sObjectName isEqualToString:@"OpenActivity"] ) {
@@ -615,12 +637,12 @@ BOOL chatterEnabled = NO;
             return related;
         
         return [self textValueForField:field 
-                        withDictionary:(NSDictionary *)related];
+                        withDictionary:(NSDictionary *)related
+                             describes:describes];
     }
     
-    NSString *fieldType = [[SFVAppCache sharedSFVAppCache] field:fieldName
-                                                        onObject:sObjectName
-                                                  stringProperty:FieldType];
+    SFVFieldDescribe *fieldDescribe = [describes compiledDescribeForField:fieldName onObject:sObjectName];
+    NSString *fieldType = ( fieldDescribe ? [fieldDescribe stringProperty:FieldType] : nil );
     
     if( !fieldType ) { // some knucklehead forgot to describe this object
         id result = [sObject objectForKey:fieldName];
@@ -634,14 +656,12 @@ BOOL chatterEnabled = NO;
             return NSLocalizedString(@"No", @"No");
         }
         
-        return [[self class] wildAssedGuessAtStringifyingObject:result];
+        return [[self class] wildAssedGuessAtStringifyingObject:result describes:describes];
     }
             
     // if it's a related object's name (as opposed to above, a field on related object)
     if( [fieldType isEqualToString:@"reference"] ) {   
-        NSString *relationshipName = [[SFVAppCache sharedSFVAppCache] field:fieldName
-                                                                   onObject:sObjectName
-                                                             stringProperty:FieldRelationshipName];
+        NSString *relationshipName = [fieldDescribe stringProperty:FieldRelationshipName];
         
         id related = [sObject objectForKey:relationshipName];
         
@@ -650,29 +670,25 @@ BOOL chatterEnabled = NO;
         if( [SFVUtil isEmpty:related] )
             return @"";
         else if( [related isKindOfClass:[ZKSObject class]] )
-            return [[SFVAppCache sharedSFVAppCache] nameForSObject:[related fields]];
+            return [describes nameForSObject:[related fields]];
         else if( [related isKindOfClass:[NSDictionary class]] )
-            return [[SFVAppCache sharedSFVAppCache] nameForSObject:related];
+            return [describes nameForSObject:related];
         
         return @"";
     }
     
     // We should now have just a field from a regular dictionary. Extract the field value and format properly
-    NSString *value = [[self class] wildAssedGuessAtStringifyingObject:[sObject objectForKey:fieldName]];
-    NSNumberFormatter *nformatter = [[NSNumberFormatter alloc] init];  
-    NSDateFormatter *dformatter = [[NSDateFormatter alloc] init];
+    NSString *value = [[self class] wildAssedGuessAtStringifyingObject:[sObject objectForKey:fieldName] describes:describes];
+    NSNumberFormatter *nformatter = nil;
     NSNumber *num;
-    
-    [dformatter setLocale:[NSLocale currentLocale]];
-    [nformatter setLocale:[NSLocale currentLocale]];
         
     if( [SFVUtil isEmpty:value] || [value isEqualToString:@"null"] )
         value = @"";
     else if( [fieldType isEqualToString:@"currency"] ) {
-        [nformatter setNumberStyle:NSNumberFormatterCurrencyStyle];
-        
         if( ![SFVUtil isEmpty:[sObject objectForKey:@"CurrencyIsoCode"]] )
-              [nformatter setCurrencyCode:[sObject objectForKey:@"CurrencyIsoCode"]];
+            nformatter = [SFVFormatterPool currencyFormatterWithCode:[sObject objectForKey:@"CurrencyIsoCode"]];
+        else
+            nformatter = [SFVFormatterPool currencyFormatterWithCode:nil];
               
         num = [NSNumber numberWithDouble:[value doubleValue]];
         value = [nformatter stringFromNumber:num];
@@ -682,38 +698,30 @@ BOOL chatterEnabled = NO;
         else
             value = @"No";
     } else if( [fieldType isEqualToString:@"date"] || [fieldType isEqualToString:@"datetime"] ) {
-        [dformatter setDateStyle:NSDateFormatterShortStyle];
+        NSDateFormatterStyle timeStyle;
                 
         if( [fieldType isEqualToString:@"date"] 
             || ( [sObjectName isEqualToString:@"Event"] 
                  && [[sObject objectForKey:@"IsAllDayEvent"] boolValue]
-                 && [[NSArray arrayWithObjects:@"StartDateTime", @"EndDateTime", nil] containsObject:fieldName] ) )
-            [dformatter setTimeStyle:NSDateFormatterNoStyle];
+                 && ( [fieldName isEqualToString:@"StartDateTime"] || [fieldName isEqualToString:@"EndDateTime"] ) ) )
+            timeStyle = NSDateFormatterNoStyle;
         else
-            [dformatter setTimeStyle:NSDateFormatterShortStyle];
+            timeStyle = NSDateFormatterShortStyle;
         
-        value = [dformatter stringFromDate:[[self class] dateFromSOQLDatetime:value]];
+        value = [[SFVFormatterPool dateFormatterWithDateStyle:NSDateFormatterShortStyle timeStyle:timeStyle]
+                 stringFromDate:[[self class] dateFromSOQLDatetime:value]];
     } else if( [fieldType isEqualToString:@"percent"] ) {
-        [nformatter setNumberStyle:NSNumberFormatterPercentStyle];
+        nformatter = [SFVFormatterPool numberFormatterWithStyle:NSNumberFormatterPercentStyle];
         
         num = [NSNumber numberWithDouble:( [value doubleValue] / 100 )];
         value = [nformatter stringFromNumber:num];
     } else if( [fieldType isEqualToString:@"double"] ) {
         // 'Precision' is the total number of decimal digits (left and right of the decimal)
         // 'Scale' is the number of digits to the right of the decimal
-        // No direct means of getting the number of digits to the left of the decimal, so we just subtract them
-        [nformatter setNumberStyle:NSNumberFormatterDecimalStyle];
-        
-        NSInteger precision = [[SFVAppCache sharedSFVAppCache] field:fieldName
-                                                            onObject:sObjectName
-                                                      numberProperty:FieldPrecision];
-        NSInteger scale = [[SFVAppCache sharedSFVAppCache] field:fieldName
-                                                        onObject:sObjectName
-                                                  numberProperty:FieldScale];
+        NSInteger precision = [fieldDescribe numberProperty:FieldPrecision];
+        NSInteger scale = [fieldDescribe numberProperty:FieldScale];
         
-        [nformatter setMinimumFractionDigits:scale];
-        [nformatter setMaximumFractionDigits:scale];
-        [nformatter setMaximumIntegerDigits:( precision - scale )];
+        nformatter = [SFVFormatterPool decimalFormatterWithPrecision:precision scale:scale];
         
         num = [NSNumber numberWithDouble:[value doubleValue]];
         value = [nformatter stringFromNumber:num];
@@ -725,9 +733,6 @@ BOOL chatterEnabled = NO;
             value = [NSString stringWithFormat:@"http://%@", value];
     } else if( [fieldType isEqualToString:@"textarea"] )
         value = [[self class] trimWhiteSpaceFromString:value];
-
-    [nformatter release];
-    [dformatter release];
     
     return value;
 }
@@ -795,14 +800,18 @@ BOOL chatterEnabled = NO;
 }
 
 - (void) describeLayoutForsObject:(NSString *)sObject completeBlock:(void (^)(ZKDescribeLayoutResult * layoutDescribe))completeBlock {
-    if( !layoutCache )
-        layoutCache = [[NSMutableDictionary alloc] init];
+    [self describeLayoutForsObject:sObject refresh:NO completeBlock:completeBlock];
+}
+
+- (void) describeLayoutForsObject:(NSString *)sObject refresh:(BOOL)refresh completeBlock:(void (^)(ZKDescribeLayoutResult * layoutDescribe))completeBlock {
+    if( !layoutStore )
+        layoutStore = [[SFVLayoutStore alloc] init];
     
     if( !sObject )
         return;
     
-    if( [layoutCache objectForKey:sObject] ) {
-        completeBlock([layoutCache objectForKey:sObject]);
+    if( !refresh && [layoutStore layoutResultForSObject:sObject] ) {
+        completeBlock([layoutStore layoutResultForSObject:sObject]);
         return;
     }
         
@@ -816,32 +825,29 @@ BOOL chatterEnabled = NO;
                            }
                        completeBlock:^(id result) {
                            if( result ) {
-                               [layoutCache setObject:result forKey:sObject];
-                               completeBlock( result );
+                               [layoutStore addLayoutResult:result forSObject:sObject];
+                               [[SFVMetadataStore sharedSFVMetadataStore] setObject:[layoutStore allLayoutResults] forSection:kLayoutSection];
+                               
+                               if( completeBlock )
+                                   completeBlock( result );
                            }
                        }];
 }
 
-- (NSString *) sObjectFromLayoutId:(NSString *)layoutId {
-    for( NSString *sObject in [layoutCache allKeys] )
-        for( ZKDescribeLayout *layout in [[layoutCache objectForKey:sObject] layouts] )
-            if( [[layout Id] isEqualToString:layoutId] )
-                return sObject;
+- (NSArray *) sObjectsWithLayouts {
+    return [[layoutStore allLayoutResults] allKeys];
+}
 
-    return nil;
+- (NSString *) sObjectFromLayoutId:(NSString *)layoutId {
+    return [layoutStore sObjectForLayoutId:layoutId];
 }
 
 - (NSString *) sObjectFromRecordTypeId:(NSString *)recordTypeId {
-    for( NSString *sObject in [layoutCache allKeys] )
-        for( ZKRecordTypeMapping *mapping in [[layoutCache objectForKey:sObject] recordTypeMappings] )
-            if( [[mapping recordTypeId] isEqualToString:recordTypeId] )
-                return sObject;
-    
-    return nil;
+    return [layoutStore sObjectForRecordTypeId:recordTypeId];
 }
 
 - (NSString *)layoutIDForRecord:(NSDictionary *)record {
-    if( !layoutCache || !record )
+    if( !layoutStore || !record )
         return nil;
     
     NSString *type = [record objectForKey:kObjectTypeKey];
@@ -849,27 +855,18 @@ BOOL chatterEnabled = NO;
     if( !type )
         type = [[SFVAppCache sharedSFVAppCache] sObjectFromRecordId:[record objectForKey:@"Id"]];
     
-    if( !type || [SFVUtil isEmpty:[layoutCache objectForKey:type]] )
-        return nil;
-    
-    ZKDescribeLayoutResult *result = [layoutCache objectForKey:type];
+    ZKDescribeLayoutResult *result = [layoutStore layoutResultForSObject:type];
     NSString *layoutId = nil;
     
     if( result ) {
         // First attempt to pick the proper layout for this record type, if there is a record type
-        if( ![SFVUtil isEmpty:[record objectForKey:kRecordTypeIdField]] ) {
-            for( ZKRecordTypeMapping *rt in [result recordTypeMappings] )
-                if( [[rt recordTypeId] isEqualToString:[record objectForKey:kRecordTypeIdField]] )
-                    layoutId = [rt layoutId];
-        }
+        if( ![SFVUtil isEmpty:[record objectForKey:kRecordTypeIdField]] )
+            layoutId = [[layoutStore recordTypeMappingForSObject:type 
+                                                    recordTypeId:[record objectForKey:kRecordTypeIdField]] layoutId];
         
         // Next attempt to pick the default layout for this object
         if( !layoutId )
-            for( ZKRecordTypeMapping *rt in [result recordTypeMappings] )
-                if( [rt defaultRecordTypeMapping] ) {
-                    layoutId = [rt layoutId];
-                    break;
-                }
+            layoutId = [[layoutStore defaultRecordTypeMappingForSObject:type] layoutId];
         
         // If all else fails, just choose the first available layout
         if( !layoutId && [[result layouts] count] > 0 )
@@ -880,13 +877,11 @@ BOOL chatterEnabled = NO;
 }
 
 - (NSDictionary *)availableRecordTypesForObject:(NSString *)object {
-    if( !layoutCache || !object )
-        return nil;
-
-    if( [SFVUtil isEmpty:[layoutCache objectForKey:object]] )
+    ZKDescribeLayoutResult *result = [layoutStore layoutResultForSObject:object];
+    
+    if( !result )
         return nil;
     
-    ZKDescribeLayoutResult *result = [layoutCache objectForKey:object];
     NSMutableDictionary *ret = [NSMutableDictionary dictionary];
     
     for( ZKRecordTypeMapping *mapping in [result recordTypeMappings] )
@@ -898,152 +893,86 @@ BOOL chatterEnabled = NO;
 }
 
 - (NSDictionary *)defaultRecordTypeForObject:(NSString *)object {
-    if( !layoutCache || !object )
-        return nil;
-        
-    if( [SFVUtil isEmpty:[layoutCache objectForKey:object]] )
-        return nil;
-    
-    ZKDescribeLayoutResult *result = [layoutCache objectForKey:object];
-    
-    for( ZKRecordTypeMapping *mapping in [result recordTypeMappings] )
-        if( [mapping defaultRecordTypeMapping] )
-            return [NSDictionary dictionaryWithObject:[mapping name]
-                                               forKey:[mapping recordTypeId]];
-    
-    return nil;
-}
-
-- (NSDictionary *)picklistValuesForObject:(NSString *)object recordTypeId:(NSString *)recordTypeId {
-    if( !layoutCache || !object )
-        return nil;
-        
-    if( [SFVUtil isEmpty:[layoutCache objectForKey:object]] )
-        return nil;
-    
-    ZKDescribeLayoutResult *result = [layoutCache objectForKey:object];
-    NSArray *arr = nil;
-    
-    // First try to find this exact recordtypeId
-    for( ZKRecordTypeMapping *mapping in [result recordTypeMappings] )
-        if( recordTypeId && [[mapping recordTypeId] isEqualToString:recordTypeId] ) {
-            arr = [mapping picklistsForRecordType];
-            break;
-        }
+    ZKRecordTypeMapping *mapping = [layoutStore defaultRecordTypeMappingForSObject:object];
     
-    // Fallback on the default mapping
-    if( !arr )
-        for( ZKRecordTypeMapping *mapping in [result recordTypeMappings] )
-            if( [mapping defaultRecordTypeMapping] ) {
-                arr = [mapping picklistsForRecordType];
-                break;
-            }
-    
-    if( !arr ) // merde.
+    if( !mapping )
         return nil;
     
-    NSMutableDictionary *ret = [NSMutableDictionary dictionary];
-    
-    for( ZKPicklistForRecordType *picklist in arr )
-        [ret setObject:[picklist picklistValues]
-                forKey:[picklist picklistName]];
-    
-    return ret;
+    return [NSDictionary dictionaryWithObject:[mapping name]
+                                       forKey:[mapping recordTypeId]];
 }
 
-+ (BOOL)testBitAtIndex:(int)index byteData:(Byte *)byteData {
-    if( !byteData )
-        return NO;
-    
-    return ( byteData[index >> 3] & (0x80 >> index % 8)) != 0;
+- (NSDictionary *)picklistValuesForObject:(NSString *)object recordTypeId:(NSString *)recordTypeId {
+    return [layoutStore picklistsForSObject:object recordTypeId:recordTypeId];
 }
 
 - (NSArray *)picklistValuesForField:(NSString *)field onObject:(NSDictionary *)object filterByRecordType:(BOOL)filterByRecordType {
-    NSString *sObjectType = [object objectForKey:kObjectTypeKey];    
-        
+    NSString *sObjectType = [object objectForKey:kObjectTypeKey];
+    SFVFieldDescribe *fieldDesc = [[SFVAppCache sharedSFVAppCache] compiledDescribeForField:field onObject:sObjectType];
+    
     // All picklist options for this field, across all record types
-    NSArray *picklistOptions = [[SFVAppCache sharedSFVAppCache] field:field
-                                                             onObject:sObjectType
-                                                        arrayProperty:FieldPicklistValues];
+    NSArray *picklistOptions = [fieldDesc arrayProperty:FieldPicklistValues];
+    
+    if( [picklistOptions count] == 0 )
+        return [NSArray array];
         
     // All picklist options for this field, for this particular record type
-    NSArray *recordTypePicklistOptions = [[self picklistValuesForObject:sObjectType
-                                                           recordTypeId:[object objectForKey:kRecordTypeIdField]] 
-                                          objectForKey:field];
+    NSArray *recordTypePicklistOptions = ( filterByRecordType 
+                                          ? [[self picklistValuesForObject:sObjectType
+                                                              recordTypeId:[object objectForKey:kRecordTypeIdField]] 
+                                             objectForKey:field]
+                                          : nil );
             
-    NSMutableArray *rtOptions = [NSMutableArray array];
+    NSMutableSet *rtOptions = [NSMutableSet setWithCapacity:[recordTypePicklistOptions count]];
     
     for( ZKPicklistEntry *entry in recordTypePicklistOptions )
         [rtOptions addObject:[entry value]];
-        
-    // The controlling field for this picklist
-    NSString *controllingField = nil;
-    NSInteger indexOfSelectedControllingValue = -1;
     
-    if( [[SFVAppCache sharedSFVAppCache] doesField:field
-                                          onObject:sObjectType
-                                      haveProperty:FieldIsDependentPicklist] ) {
-        controllingField = [[SFVAppCache sharedSFVAppCache] field:field
-                                                         onObject:sObjectType
-                                                   stringProperty:FieldControllingFieldName];
+    // For a dependent picklist, the row of values that are valid for the controlling field's current value
+    const uint32_t *validForControllingValue = NULL;
+    
+    if( [fieldDesc hasProperty:FieldIsDependentPicklist] ) {
+        NSString *controllingField = [fieldDesc stringProperty:FieldControllingFieldName];
+        SFVFieldDescribe *controllingDesc = [[SFVAppCache sharedSFVAppCache] compiledDescribeForField:controllingField
+                                                                                             onObject:sObjectType];
+        NSInteger indexOfSelectedControllingValue = -1;
         
         // If the controlling field is a boolean, the index is 0 or 1
-        if( [[[SFVAppCache sharedSFVAppCache] field:controllingField
-                                           onObject:sObjectType
-                                     stringProperty:FieldType] isEqualToString:@"boolean"] )
+        if( [controllingDesc dataType] == FieldDataTypeBoolean )
             indexOfSelectedControllingValue = [[object objectForKey:controllingField] boolValue];
-        else {
-            NSArray *controllingOptions = [self picklistValuesForField:controllingField
-                                                              onObject:object 
-                                                    filterByRecordType:NO];
-                        
-            for( int i = 0; i < [controllingOptions count]; i++ ) {
-                if( [[[controllingOptions objectAtIndex:i] objectForKey:@"value"] isEqualToString:[object objectForKey:controllingField]] ) {
-                    indexOfSelectedControllingValue = i;
-                    break;
-                }
-            }
-        }
+        else
+            indexOfSelectedControllingValue = [controllingDesc indexOfPicklistValue:[object objectForKey:controllingField]];
+        
+        validForControllingValue = [fieldDesc validPicklistValuesForControllingIndex:indexOfSelectedControllingValue];
+        
+        if( !validForControllingValue )
+            return [NSArray array];
     }
-            
+    
+    const uint32_t *active = [fieldDesc activePicklistValues];
+    NSUInteger words = [fieldDesc picklistWordCount];
     NSMutableArray *ret = [NSMutableArray array];
     
-    for( int i = 0; i < [picklistOptions count]; i++ ) {
-        NSDictionary *entry = [picklistOptions objectAtIndex:i];
-        
-        // skip if not an active value
-        if( ![[entry objectForKey:@"active"] boolValue] )
-            continue;
-        
-        // skip if not valid for this RT
-        if( [rtOptions count] > 0
-            && filterByRecordType
-            && ![rtOptions containsObject:[entry objectForKey:@"value"]] )
-            continue;
+    for( NSUInteger w = 0; w < words; w++ ) {
+        // active, and valid for the controlling value if there is one
+        uint32_t bits = active[w] & ( validForControllingValue ? validForControllingValue[w] : ~0u );
         
-        if( controllingField ) {
-            if( [SFVUtil isEmpty:[entry objectForKey:@"validFor"]] )       
-                continue;
+        while( bits ) {
+            NSUInteger i = w * 32 + __builtin_ctz( bits );
+            bits &= bits - 1;
             
-            NSData *data = [NSData dataFromBase64String:[entry objectForKey:@"validFor"]];
-            NSUInteger len = [data length];
-            Byte *byteData = (Byte*)malloc(len);
-            memcpy(byteData, [data bytes], len);
-
-            if( ![[self class] testBitAtIndex:indexOfSelectedControllingValue 
-                                     byteData:byteData] ) {
-                free(byteData);
-                continue;     
-            }
+            NSDictionary *entry = [picklistOptions objectAtIndex:i];
             
-            free(byteData);
+            // skip if not valid for this RT
+            if( [rtOptions count] > 0 && ![rtOptions containsObject:[entry objectForKey:@"value"]] )
+                continue;
+            
+            // valid.
+            [ret addObject:[NSDictionary dictionaryWithObjectsAndKeys:
+                            [entry objectForKey:@"value"], @"value",
+                            [entry objectForKey:@"label"], @"label",
+                            nil]];
         }
-        
-        // valid.
-        [ret addObject:[NSDictionary dictionaryWithObjectsAndKeys:
-                        [entry objectForKey:@"value"], @"value",
-                        [entry objectForKey:@"label"], @"label",
-                        nil]];
     }
     
     return ret;
@@ -1068,130 +997,21 @@ BOOL chatterEnabled = NO;
 }
 
 - (ZKDescribeLayout *) layoutWithLayoutId:(NSString *)layoutId {
-    if( !layoutCache || [layoutCache count] == 0 || !layoutId )
-        return nil;
-    
-    for( ZKDescribeLayoutResult *result in [layoutCache allValues] )
-        for( ZKDescribeLayout *layout in [result layouts] )
-            if( [[layout Id] isEqualToString:layoutId] )
-                return layout;
-    
-    return nil;
+    return [layoutStore layoutWithId:layoutId];
+}
+
+- (NSUInteger) layoutGeneration {
+    return [layoutStore generation];
 }
 
 // Returns a list of field names that appear in a given record layout, for use in constructing a query
 - (NSArray *)fieldListForLayoutId:(NSString *)layoutId {
-    NSMutableArray *ret = [NSMutableArray arrayWithObject:@"Id"];
+    SFVFieldListPlan *plan = [[SFVFieldListPlanner sharedSFVFieldListPlanner] planForLayoutId:layoutId];
     
-    ZKDescribeLayout *layout = [self layoutWithLayoutId:layoutId];
-    NSString *sObject = [self sObjectFromLayoutId:layoutId];
+    if( !plan )
+        return [NSArray arrayWithObject:@"Id"];
     
-    if( !layout ) 
-        return ret;
-        
-    // 1. Loop through all sections in this page layout
-    for( ZKDescribeLayoutSection *section in [layout detailLayoutSections] ) {
-        
-        // 2. Loop through all rows within this section
-        for( ZKDescribeLayoutRow *dlr in [section layoutRows]) {
-            
-            // 3. Each individual item on this row
-            for ( ZKDescribeLayoutItem *item in [dlr layoutItems] ) {
-                
-                // If this item is blank or a placeholder, we ignore it
-                if( [item placeholder] || [[item layoutComponents] count] == 0 )
-                    continue;
-                
-                for( ZKDescribeLayoutComponent *dlc in [item layoutComponents] ) {                    
-                    if( ![[dlc typeName] isEqualToString:@"Field"] )
-                        continue;
-                    
-                    NSString *fname = [dlc value];
-                    NSString *fieldType = [[SFVAppCache sharedSFVAppCache] field:fname
-                                                                        onObject:sObject
-                                                                  stringProperty:FieldType];
-                    
-                    if( !fieldType )
-                        continue;
-                    
-                    if( [fieldType isEqualToString:@"reference"] ) {        
-                        NSString *relationshipName = [[SFVAppCache sharedSFVAppCache] field:fname
-                                                                                   onObject:sObject 
-                                                                             stringProperty:FieldRelationshipName];
-                        NSArray *referenceTo = [[SFVAppCache sharedSFVAppCache] field:fname
-                                                                             onObject:sObject
-                                                                        arrayProperty:FieldReferenceTo];
-                        
-                        // Special handling for the 'What' and 'Who' fields on Task, which can refer to just about anything                        
-                        if( [relationshipName isEqualToString:@"What"] )
-                            [ret addObject:@"What.Name"];
-                        else if( [relationshipName isEqualToString:@"Who"] )
-                            [ret addObject:@"Who.Name"];
-                        else if( [referenceTo count] == 1 && [referenceTo containsObject:@"User"] ) {
-                            // Special handling for Task/Event, as they use the Name field for owner (sigh)
-                            if( ( [sObject isEqualToString:@"Task"] || [sObject isEqualToString:@"Event"] ) && [relationshipName isEqualToString:@"Owner"] )
-                                [ret addObject:[NSString stringWithFormat:@"%@.%@", relationshipName, @"Name"]];
-                            else if( ![SFVUtil isEmpty:relationshipName] ) {
-                                NSArray *newFields = [NSArray arrayWithObjects:@"Name", @"email", @"title", @"phone", 
-                                                                @"mobilephone", @"city", @"state", @"department", nil];
-                                
-                                if( [[SFVAppCache sharedSFVAppCache] isChatterEnabled] )
-                                    newFields = [newFields arrayByAddingObjectsFromArray:[NSArray arrayWithObjects:@"smallphotourl", @"fullphotourl", @"aboutme", nil]];
-                                
-                                for( NSString *s in newFields ) 
-                                    [ret addObject:[NSString stringWithFormat:@"%@.%@", relationshipName, s]];
-                            }
-                        } else if( ![SFVUtil isEmpty:relationshipName] ) {
-                            [ret addObject:[NSString stringWithFormat:@"%@.Id", relationshipName]];
-                            
-                            for( NSString *refTo in referenceTo ) {
-                                [ret addObject:[NSString stringWithFormat:@"%@.%@",
-                                                                relationshipName,
-                                                                [[SFVAppCache sharedSFVAppCache] nameFieldForsObject:refTo]]];
-                                
-                                if( [[SFVAppCache sharedSFVAppCache] doesObject:refTo haveProperty:ObjectIsRecordTypeEnabled] )
-                                    [ret addObject:[NSString stringWithFormat:@"%@.%@",
-                                                    relationshipName,
-                                                    kRecordTypeIdField]];
-                            }
-                        }
-                    } else if( [fieldType isEqualToString:@"currency"] && [[SFVAppCache sharedSFVAppCache] isMultiCurrencyEnabled] )
-                        [ret addObject:@"CurrencyIsoCode"];                        
-                    
-                    [ret addObject:fname];
-                }     
-            }
-        }
-    }
-    
-    // Ensure that header fields are included in the query for accounts
-    if( [sObject isEqualToString:@"Account"] ) 
-        for( NSString *headerField in [NSArray arrayWithObjects:@"Name", @"Phone", @"Industry", @"Website", nil] ) {
-            NSDictionary *desc = [[SFVAppCache sharedSFVAppCache] describeForField:headerField onObject:@"Account"];
-            
-            // access check for this field. even though it's a standard field, some users may not have access
-            if( desc )
-                [ret addObject:headerField];
-        }
-    
-    if( [sObject isEqualToString:@"Lead"] ) {
-        [ret addObject:@"IsUnreadByOwner"];
-        [ret addObject:@"IsConverted"];
-    }
-    
-    if( [[SFVAppCache sharedSFVAppCache] doesObject:sObject haveProperty:ObjectIsRecordTypeEnabled] ) {
-        [ret addObject:kRecordTypeIdField];
-        [ret addObject:@"RecordType.Name"];
-    }
-    
-    // Handle person accounts
-    if( [[SFVAppCache sharedSFVAppCache] isPersonAccountEnabled] && [sObject isEqualToString:@"Account"] )
-        [ret addObjectsFromArray:[NSArray arrayWithObjects:@"PersonContactId", @"IsPersonAccount", nil]];
-    
-    // Also, some page layouts don't include the record name so we must be sure to include it
-    [ret addObject:[[SFVAppCache sharedSFVAppCache] nameFieldForsObject:sObject]];
-    
-    return [[NSSet setWithArray:ret] allObjects];
+    return [plan fields];
 }
 
 #pragma mark - network activity indicator management
@@ -1303,145 +1123,108 @@ BOOL chatterEnabled = NO;
     if( !records )
         return nil;
     
+    return [self dictionaryFromRecords:records 
+                   groupedByDateColumn:[self dateColumnForRecords:records dateField:dateField]];
+}
+
++ (NSData *) dateColumnForRecords:(NSArray *)records dateField:(NSString *)dateField {
+    NSMutableData *column = [NSMutableData dataWithLength:[records count] * sizeof(NSTimeInterval)];
+    NSTimeInterval *seconds = (NSTimeInterval *)[column mutableBytes];
+    NSUInteger i = 0;
+    
+    for( id ob in records ) {
+        NSDictionary *record;
+        
+        // Live query?
+        if( [ob isMemberOfClass:[ZKSObject class]] )
+            record = [ob fields];
+        else
+            record = ob;
+        
+        seconds[i++] = [SFVUtil timeIntervalFromSOQLDatetime:[record objectForKey:dateField]];
+    }
+    
+    return column;
+}
+
++ (NSDictionary *) dictionaryFromRecords:(NSArray *)records groupedByDateColumn:(NSData *)column {
+    if( !records || [column length] < [records count] * sizeof(NSTimeInterval) )
+        return nil;
+    
     NSMutableArray *arrays = [NSMutableArray arrayWithCapacity:GroupNumDateGroups];
     NSMutableDictionary *ret = [NSMutableDictionary dictionary];
+    const NSTimeInterval *seconds = (const NSTimeInterval *)[column bytes];
+    NSTimeInterval now = [[NSDate date] timeIntervalSince1970];
+    NSUInteger i = 0;
     
-    for( int i = 0; i < GroupNumDateGroups; i++ )
+    for( int g = 0; g < GroupNumDateGroups; g++ )
         [arrays addObject:[NSMutableArray array]];
     
     for( id ob in records ) {
         NSDictionary *record;
         
-        // Live query?
         if( [ob isMemberOfClass:[ZKSObject class]] )
             record = [ob fields];
         else
             record = ob;
         
-        double timeAgo = fabs( [[SFVUtil dateFromSOQLDatetime:[record objectForKey:dateField]] timeIntervalSinceNow] );
-                
-        if( timeAgo < 60 * 60 * 24 )
-            [[arrays objectAtIndex:GroupOneDay] addObject:record];
-        else if( timeAgo < 60 * 60 * 24 * 7 )
-            [[arrays objectAtIndex:GroupOneWeek] addObject:record];
-        else if( timeAgo < 60 * 60 * 24 * 7 * 4 )
-            [[arrays objectAtIndex:GroupOneMonth] addObject:record];
-        else if( timeAgo < 60 * 60 * 24 * 7 * 4 * 3 )
-            [[arrays objectAtIndex:GroupThreeMonths] addObject:record];
-        else if( timeAgo < 60 * 60 * 24 * 7 * 4 * 6 )
-            [[arrays objectAtIndex:GroupSixMonths] addObject:record];
-        else
-            [[arrays objectAtIndex:GroupSixMonthsPlus] addObject:record];
+        [[arrays objectAtIndex:[self dateGroupForTimeAgo:fabs( now - seconds[i++] )]] addObject:record];
     }
     
-    for( int i = 0; i < [arrays count]; i++ )
-        [ret setObject:[arrays objectAtIndex:i] forKey:[NSNumber numberWithInt:i]];
+    for( int g = 0; g < [arrays count]; g++ )
+        [ret setObject:[arrays objectAtIndex:g] forKey:[NSNumber numberWithInt:g]];
     
     return ret;
 }
 
++ (enum dateGroups) dateGroupForTimeAgo:(NSTimeInterval)timeAgo {
+    if( timeAgo < 60 * 60 * 24 )
+        return GroupOneDay;
+    else if( timeAgo < 60 * 60 * 24 * 7 )
+        return GroupOneWeek;
+    else if( timeAgo < 60 * 60 * 24 * 7 * 4 )
+        return GroupOneMonth;
+    else if( timeAgo < 60 * 60 * 24 * 7 * 4 * 3 )
+        return GroupThreeMonths;
+    else if( timeAgo < 60 * 60 * 24 * 7 * 4 * 6 )
+        return GroupSixMonths;
+    
+    return GroupSixMonthsPlus;
+}
+
 // Takes an array of dictionaries or sobjects and alphabetizes them into a dictionary
 // key is the first letter of the account name, value is an array of accounts starting with that letter
-// in alphabetical order ascending - assumes results were passed to us in alphabetical order
+// in alphabetical order ascending
 + (NSDictionary *) dictionaryFromAccountArray:(NSArray *)results {
     if( !results )
         return nil;
     
-    NSMutableDictionary *ret = [NSMutableDictionary dictionary];
-    NSString *name = nil;
-    
-    for( id ob in results ) {
-        NSDictionary *accountDict = [SFVAsync ZKSObjectToDictionary:ob];
-        
-        // Leads, Contacts always use lastname
-        if( [[NSArray arrayWithObjects:@"Lead", @"Contact", nil] containsObject:[accountDict objectForKey:kObjectTypeKey]] )
-            name = [accountDict objectForKey:@"LastName"];
-        else
-            name = [[SFVAppCache sharedSFVAppCache] nameForSObject:accountDict];
-        
-        // first char of this account's name
-        NSString *index = ( name && [name length] > 0 
-                            ? [[name substringToIndex:1] uppercaseString]
-                            : @"#" );
-        
-        if( ![[NSCharacterSet letterCharacterSet] characterIsMember:[index characterAtIndex:0]] )
-            index = @"#";
-        
-        // Add this account to the list of accounts at this position
-        if( ![ret objectForKey:index] )
-            [ret setObject:[NSArray arrayWithObject:accountDict] forKey:index];
-        else {
-            NSArray *records = [[ret objectForKey:index] arrayByAddingObject:accountDict];
-            
-            [ret setObject:records forKey:index];
-        }
-    }
+    SFVSectionedList *list = [[[SFVSectionedList alloc] init] autorelease];
+    [list addRecords:results];
     
-    return ret;
+    return [list sections];
 }
 
 // Given a dictionary defined as in dictionaryFromAccountArray, add some new accounts to it
 // while maintaining alphabetical order by name
 + (NSDictionary *) dictionaryByAddingAccounts:(NSArray *)accounts toDictionary:(NSDictionary *)allAccounts {
-    NSMutableDictionary *newDictionary = [NSMutableDictionary dictionaryWithDictionary:allAccounts];
+    SFVSectionedList *list = [[[SFVSectionedList alloc] initWithSections:allAccounts] autorelease];
+    [list addRecords:accounts];
     
-    if( !accounts || [accounts count] == 0 )
-        return newDictionary;
-    
-    for( id a in accounts ) {
-        NSDictionary *newAccount = [SFVAsync ZKSObjectToDictionary:a];
-        NSString *name = nil;
-        
-        // Leads, Contacts always use lastname
-        if( [[NSArray arrayWithObjects:@"Lead", @"Contact", nil] containsObject:[newAccount objectForKey:kObjectTypeKey]] )
-            name = [newAccount objectForKey:@"LastName"];
-        else
-            name = [[SFVAppCache sharedSFVAppCache] nameForSObject:newAccount];
-        
-        if( [SFVUtil isEmpty:name] )
-            continue;
-        
-        NSString *index = [[name substringToIndex:1] uppercaseString];
-        
-        if( ![[NSCharacterSet letterCharacterSet] characterIsMember:[index characterAtIndex:0]] )
-            index = @"#";
-        
-        if( ![newDictionary objectForKey:index] )
-            [newDictionary setObject:[NSArray array] forKey:index];
-        
-        NSMutableArray *indexAccounts = [NSMutableArray arrayWithArray:[newDictionary objectForKey:index]];
-        
-        if( [indexAccounts count] == 0 )
-            [indexAccounts addObject:newAccount];
-        else {
-            BOOL added = NO;
-            
-            for( int x = 0; x < [indexAccounts count]; x++ ) {
-                NSString *otherName = [[SFVAppCache sharedSFVAppCache] nameForSObject:[indexAccounts objectAtIndex:x]];
-                
-                if( [name compare:otherName options:NSCaseInsensitiveSearch] != NSOrderedDescending ) {
-                    [indexAccounts insertObject:newAccount atIndex:x];
-                    added = YES;
-                    break;
-                }
-            }
-            
-            if( !added )
-                [indexAccounts addObject:newAccount];
-        }
-        
-        [newDictionary setObject:indexAccounts forKey:index];
-    }
-    
-    return newDictionary;
+    return [list sections];
 }
 
 // Given an index path, get an account from a dictionary defined as in dictionaryFromAccountArray
 + (NSDictionary *) accountFromIndexPath:(NSIndexPath *)ip accountDictionary:(NSDictionary *)allAccounts {
-    if( !ip || !allAccounts )
+    return [self accountFromIndexPath:ip 
+                    accountDictionary:allAccounts 
+                           sortedKeys:[self sortArray:[allAccounts allKeys]]];
+}
+
++ (NSDictionary *) accountFromIndexPath:(NSIndexPath *)ip accountDictionary:(NSDictionary *)allAccounts sortedKeys:(NSArray *)sortedKeys {
+    if( !ip || !allAccounts || (NSUInteger)[ip section] >= [sortedKeys count] )
         return nil;
     
-    NSArray *sortedKeys = [[self class] sortArray:[allAccounts allKeys]];
     NSString *index = [sortedKeys objectAtIndex:[ip section]];
     NSArray *indexedAccounts = [allAccounts objectForKey:index];
     
@@ -1450,6 +1233,12 @@ BOOL chatterEnabled = NO;
 
 // Given an account, get an index path for it from a dictionary defined as in dictionaryFromAccountArray
 + (NSIndexPath *) indexPathForAccountDictionary:(NSDictionary *)account allAccountDictionary:(NSDictionary *)allAccounts {
+    return [self indexPathForAccountDictionary:account 
+                          allAccountDictionary:allAccounts 
+                                    sortedKeys:[self sortArray:[allAccounts allKeys]]];
+}
+
++ (NSIndexPath *) indexPathForAccountDictionary:(NSDictionary *)account allAccountDictionary:(NSDictionary *)allAccounts sortedKeys:(NSArray *)keys {
     int section = 0, row = 0;
     
     if( !account || !allAccounts )
@@ -1465,8 +1254,6 @@ BOOL chatterEnabled = NO;
     else
         index = [[name substringToIndex:1] uppercaseString];
         
-    NSArray *keys = [self sortArray:[allAccounts allKeys]];
-        
     if( !index ) {
         for( NSString *key in keys ) {
             for( NSDictionary *a in [allAccounts objectForKey:key] ) {                
@@ -1529,62 +1316,34 @@ BOOL chatterEnabled = NO;
         date = [NSDate dateWithTimeIntervalSinceNow:0];
     
     // 2011-01-24T17:34:14.000Z
-    
-    NSDateFormatter *dformatter = [[NSDateFormatter alloc] init];
-    [dformatter setLocale:[NSLocale currentLocale]];
-    
-    if( isDateTime ) {
-        [dformatter setDateFormat:@"yyyy'-'MM'-'dd'T'HH':'mm':'ss'.000Z'"];
-        NSTimeZone *tz = [NSTimeZone defaultTimeZone];
-        NSInteger seconds = -[tz secondsFromGMTForDate:date];
-        date = [NSDate dateWithTimeInterval:seconds sinceDate:date];
-    } else
-        [dformatter setDateFormat:@"yyyy'-'MM'-'dd"];
-    
-    NSString *format = [dformatter stringFromDate:date];
-    [dformatter release];
-        
-    return format;
+    return ZKStringFromDateTime( [date timeIntervalSince1970], isDateTime );
 }
 
 + (NSDate *) dateFromSOQLDatetime:(NSString *)datetime {
     // datetime 2011-01-24T17:34:14.000Z
     // date 2011-01-24
     // also date: 4/30/12 ?
-    NSDate *date;
-    BOOL isDateTime = NO;
+    NSTimeInterval seconds;
         
     if( [SFVUtil isEmpty:datetime] )
         return [NSDate dateWithTimeIntervalSinceNow:0];
-        
-    datetime = [datetime stringByReplacingOccurrencesOfString:@".000Z" withString:@""];
-    datetime = [datetime stringByReplacingOccurrencesOfString:@".000+0000" withString:@""]; // REST
-    datetime = [datetime stringByReplacingOccurrencesOfString:@"T" withString:@" "];
-    datetime = [self trimWhiteSpaceFromString:datetime];
-        
-    NSDateFormatter *dformatter = [[NSDateFormatter alloc] init];
-    [dformatter setLocale:[NSLocale currentLocale]];
     
-    if( [datetime rangeOfString:@"/"].location != NSNotFound )
-        [dformatter setDateFormat:@"M/dd/yy"];
-    else if( [datetime rangeOfString:@" "].location == NSNotFound )
-        [dformatter setDateFormat:@"yyyy-MM-dd"];
-    else {
-        [dformatter setDateFormat:@"yyyy-MM-dd HH:mm:ss"];
-        isDateTime = YES;
-    }
+    if( ZKParseDateTime( datetime, &seconds, NULL ) )
+        return [NSDate dateWithTimeIntervalSince1970:seconds];
     
-    date = [dformatter dateFromString:datetime];
-    [dformatter release];
+    // Anything else is a short local date, midnight local time
+    return [[SFVFormatterPool dateFormatterWithFormat:@"M/dd/yy"] dateFromString:[self trimWhiteSpaceFromString:datetime]];
+}
 
-    // only do time zone adjustments for datetimes
-    if( isDateTime ) {
-        NSTimeZone *tz = [NSTimeZone defaultTimeZone];
-        NSInteger seconds = [tz secondsFromGMTForDate:date];
-        return [NSDate dateWithTimeInterval:seconds sinceDate:date];
-    }
++ (NSTimeInterval) timeIntervalFromSOQLDatetime:(id)datetime {
+    NSTimeInterval seconds;
+    
+    if( [datetime isKindOfClass:[NSString class]] && ZKParseDateTime( datetime, &seconds, NULL ) )
+        return seconds;
     
-    return date;
+    NSDate *date = ( [datetime isKindOfClass:[NSString class]] ? [self dateFromSOQLDatetime:datetime] : nil );
+    
+    return ( date ? [date timeIntervalSince1970] : [[NSDate date] timeIntervalSince1970] );
 }
 
 + (NSArray *) filterRecords:(NSArray *)records dateField:(NSString *)dateField withDate:(NSDate *)date createdAfter:(BOOL)createdAfter {
@@ -1595,13 +1354,16 @@ BOOL chatterEnabled = NO;
         return records;
     
     NSMutableArray *ret = [NSMutableArray arrayWithCapacity:[records count]];
+    const NSTimeInterval *seconds = (const NSTimeInterval *)[[self dateColumnForRecords:records dateField:dateField] bytes];
+    NSTimeInterval cutoff = [date timeIntervalSince1970];
+    NSUInteger i = 0;
     
     for( NSDictionary *record in records ) {
-        NSComparisonResult result = [date compare:[SFVUtil dateFromSOQLDatetime:[record objectForKey:dateField]]];
+        NSTimeInterval recordDate = seconds[i++];
         
-        if( createdAfter && result == NSOrderedAscending )
+        if( createdAfter && cutoff < recordDate )
             [ret addObject:record];
-        else if( !createdAfter && result == NSOrderedDescending )
+        else if( !createdAfter && cutoff > recordDate )
             [ret addObject:record];
     }
     
@@ -1952,121 +1714,132 @@ finish:
     [[NSUserDefaults standardUserDefaults] synchronize];
 }
 
+// Cache key for copies of an image with rounded corners
+static NSString *roundedImageKey( NSString *key, CGFloat cornerRadius ) {
+    if( cornerRadius <= 0 )
+        return key;
+    
+    return [key stringByAppendingFormat:@"~r%.0f", cornerRadius];
+}
+
 - (void) loadImageFromURL:(NSString *)url cache:(BOOL)cache maxDimension:(CGFloat)maxDimension completeBlock:(ImageCompletionBlock)completeBlock {
+    [self loadImageFromURL:url cache:cache maxDimension:maxDimension cornerRadius:0 completeBlock:completeBlock];
+}
+
+- (void) loadImageFromURL:(NSString *)url cache:(BOOL)cache maxDimension:(CGFloat)maxDimension cornerRadius:(CGFloat)cornerRadius completeBlock:(ImageCompletionBlock)completeBlock {
     if( !url || [url length] == 0 )
         return;
     
-    id cached = [userPhotoCache objectForKey:url];
+    SFVImageCache *imageCache = [SFVImageCache sharedSFVImageCache];
+    NSString *key = [SFVImageCache cacheKeyForURL:url];
+    NSString *sizedKey = roundedImageKey( key, cornerRadius );
+    UIImage *cached = [imageCache imageForKey:sizedKey maxDimension:maxDimension];
+    
+    // The original will do if it's already small enough and we don't need to round it
+    if( !cached && cornerRadius <= 0 ) {
+        UIImage *original = [imageCache imageForKey:key maxDimension:0];
+        
+        if( original && ( maxDimension <= 0 || MAX( original.size.width, original.size.height ) <= maxDimension ) )
+            cached = original;
+    }
         
     if( cached ) {
-        if( [cached isKindOfClass:[UIImage class]] ) {
-            //NSLog(@"IMG FROM CACHE: %@", url );
-            UIImage *img = [(UIImage *)cached imageAtScale];
-            
-            if( maxDimension > 0 ) {
-                float imgMaxDim = MAX( img.size.width, img.size.height );
-                float scale = 1.0;
-                CGSize targetSize = CGSizeZero;
-                
-                if( imgMaxDim > maxDimension ) {
-                    scale = maxDimension / imgMaxDim;
-                    targetSize = CGSizeMake( scale * img.size.width, scale * img.size.height );
-                }
-                
-                if( !CGSizeEqualToSize( targetSize, CGSizeZero ) )
-                    img = [img imageResizedToSize:targetSize];
-            }
-            
-            if( completeBlock )
-                completeBlock( img, YES );
-        } else if( [cached isKindOfClass:[PRPConnection class]] ) {
-            NSLog(@"DUPE IMG LOAD: %@", url );
-            
-            NSArray *savedBlocks = (NSArray *)objc_getAssociatedObject(cached, &imageLoadCompleteBlockArray);
-            
-            if( savedBlocks ) {
-                NSMutableArray *completionBlocks = [NSMutableArray arrayWithArray:savedBlocks];
-                [completionBlocks addObject:[[completeBlock copy] autorelease]];
-                
-                // Clear out the existing array
-                objc_setAssociatedObject( cached, &imageLoadCompleteBlockArray, nil, OBJC_ASSOCIATION_ASSIGN);
-                                
-                // Save the new array
-                objc_setAssociatedObject( cached, &imageLoadCompleteBlockArray, completionBlocks, OBJC_ASSOCIATION_COPY);
-            }
-        }
+        if( completeBlock )
+            completeBlock( cached, YES );
         
         return;
     }
     
-    PRPConnectionCompletionBlock connCompleteBlock = ^(PRPConnection *connection, NSError *error) {
-        [self endNetworkAction];
-        
-        // Load our complete block(s) for this request
-        NSArray *completionBlocks = (NSArray *)objc_getAssociatedObject(connection, &imageLoadCompleteBlockArray);
-        
-        if( error ) {
-            [self receivedAPIError:error];
-            
-            if( completionBlocks && [completionBlocks count] > 0 )
-                for( ImageCompletionBlock block in completionBlocks )
-                    if( block )
-                        block( nil, NO );
-            
-            return;
-        }
-        
-        UIImage *img = [[UIImage imageWithData:[connection downloadData]] imageAtScale];
+    if( !imageLoadBlocks )
+        imageLoadBlocks = [[NSMutableDictionary alloc] init];
+    
+    // Loads are shared between requests for the same image at the same size
+    NSString *loadKey = [NSString stringWithFormat:@"%@#%.0f", sizedKey, maxDimension];
+    NSMutableArray *completionBlocks = [imageLoadBlocks objectForKey:loadKey];
+    
+    if( completionBlocks ) {
+        NSLog(@"DUPE IMG LOAD: %@", url );
         
-        // Remove the blocks stored on this request
-        objc_setAssociatedObject( connection, &imageLoadCompleteBlockArray, nil, OBJC_ASSOCIATION_ASSIGN);
+        if( completeBlock )
+            [completionBlocks addObject:[[completeBlock copy] autorelease]];
         
-        // remove this request from the cache
-        [userPhotoCache removeObjectForKey:url];
+        return;
+    }
+    
+    completionBlocks = [NSMutableArray array];
+    
+    if( completeBlock )
+        [completionBlocks addObject:[[completeBlock copy] autorelease]];
+    
+    [imageLoadBlocks setObject:completionBlocks forKey:loadKey];
+    
+    // Decoding and resizing happen in the background, we only get the finished images back here
+    ImageDecodeCompletionBlock decodeCompleteBlock = ^(UIImage *original, UIImage *sized) {
+        NSArray *blocks = [[[imageLoadBlocks objectForKey:loadKey] retain] autorelease];
+        [imageLoadBlocks removeObjectForKey:loadKey];
         
         // Cache the image result
-        if( img && cache )
-            [self addUserPhotoToCache:img forURL:url];
-        
-        if( maxDimension > 0 ) {
-            float imgMaxDim = MAX( img.size.width, img.size.height );
-            float scale = 1.0;
-            CGSize targetSize = CGSizeZero;
+        if( cache ) {
+            if( original )
+                [imageCache setImage:original forKey:key maxDimension:0];
             
-            if( imgMaxDim > maxDimension ) {
-                scale = maxDimension / imgMaxDim;
-                targetSize = CGSizeMake( scale * img.size.width, scale * img.size.height );
-            }
-                        
-            if( !CGSizeEqualToSize( targetSize, CGSizeZero ) )
-                img = [img imageResizedToSize:targetSize];
+            if( sized && sized != original )
+                [imageCache setImage:sized forKey:sizedKey maxDimension:maxDimension];
         }
         
         // Fire all completion blocks for this image
-        if( completionBlocks && [completionBlocks count] > 0 )
-            for( ImageCompletionBlock block in completionBlocks )
-                if( block )
-                    block( img, NO );
+        for( ImageCompletionBlock block in blocks )
+            block( sized, NO );
     };
     
-    PRPConnection *imgDownload = [PRPConnection connectionWithURL:[NSURL URLWithString:url]
-                                                    progressBlock:nil
-                                                  completionBlock:connCompleteBlock];
-        
-    NSLog(@"IMAGE LOAD: %@", url);
+    UIImage *original = [imageCache imageForKey:key maxDimension:0];
     
-    // Add our complete block to this request
-    if( completeBlock ) {
-        NSArray *blockArray = [NSArray arrayWithObject:[[completeBlock copy] autorelease]];
-        objc_setAssociatedObject( imgDownload, &imageLoadCompleteBlockArray, blockArray, OBJC_ASSOCIATION_COPY);
+    if( original ) {
+        [[SFVImageDecoder sharedSFVImageDecoder] decodeImage:original
+                                                maxDimension:maxDimension
+                                                cornerRadius:cornerRadius
+                                               completeBlock:decodeCompleteBlock];
+        return;
     }
     
-    // Add the request to the cache
-    [userPhotoCache setObject:imgDownload forKey:url];
+    PRPConnectionCompletionBlock connCompleteBlock = ^(PRPConnection *connection, NSError *error) {
+        [self endNetworkAction];
+        
+        if( error ) {
+            [self receivedAPIError:error];
+            decodeCompleteBlock( nil, nil );
+            return;
+        }
+        
+        if( cache )
+            [imageCache storeData:[connection downloadData] forKey:key];
+        
+        [[SFVImageDecoder sharedSFVImageDecoder] decodeImageData:[connection downloadData]
+                                                    maxDimension:maxDimension
+                                                    cornerRadius:cornerRadius
+                                                   completeBlock:decodeCompleteBlock];
+    };
     
-    // Begin the download
-    [self startNetworkAction];
-    [imgDownload start];
+    // Try the disk before the network
+    [imageCache loadDataForKey:key completeBlock:^(NSData *data) {
+        if( data ) {
+            [[SFVImageDecoder sharedSFVImageDecoder] decodeImageData:data
+                                                        maxDimension:maxDimension
+                                                        cornerRadius:cornerRadius
+                                                       completeBlock:decodeCompleteBlock];
+            return;
+        }
+        
+        PRPConnection *imgDownload = [PRPConnection connectionWithURL:[NSURL URLWithString:url]
+                                                        progressBlock:nil
+                                                      completionBlock:connCompleteBlock];
+        
+        NSLog(@"IMAGE LOAD: %@", url);
+        
+        // Begin the download
+        [self startNetworkAction];
+        [imgDownload start];
+    }];
 }
 
 @end
@@ -36,4 +36,10 @@
 
 - (UIImage *) roundCornersOfImageWithRadius:(NSInteger)roundRadius;
 
+// Draws this image into a new bitmap at the given scale, so it's decoded now instead of the
+// first time it's drawn on screen. Shrinks it to fit maxDimension points if maxDimension > 0, 
+// and rounds its corners if cornerRadius > 0. Only uses Core Graphics, so it's safe to call 
+// from a background thread.
+- (UIImage *) decodedImageWithMaxDimension:(CGFloat)maxDimension cornerRadius:(CGFloat)cornerRadius scale:(CGFloat)scale;
+
 @end
@@ -153,4 +153,50 @@ FIX_CATEGORY_BUG(ImageUtils);
     return img;
 }
 
+- (UIImage *) decodedImageWithMaxDimension:(CGFloat)maxDimension cornerRadius:(CGFloat)cornerRadius scale:(CGFloat)scale {
+    CGImageRef source = [self CGImage];
+    
+    if( !source || scale <= 0 )
+        return nil;
+    
+    // Size in points, once shown at this scale
+    CGSize size = CGSizeMake( CGImageGetWidth( source ) / scale, CGImageGetHeight( source ) / scale );
+    CGFloat imgMaxDim = MAX( size.width, size.height );
+    
+    if( maxDimension > 0 && imgMaxDim > maxDimension )
+        size = CGSizeMake( size.width * maxDimension / imgMaxDim, size.height * maxDimension / imgMaxDim );
+    
+    size_t w = MAX( 1, (size_t)roundf( size.width * scale ) );
+    size_t h = MAX( 1, (size_t)roundf( size.height * scale ) );
+    
+    CGColorSpaceRef colorSpace = CGColorSpaceCreateDeviceRGB();
+    CGContextRef context = CGBitmapContextCreate(NULL, w, h, 8, 0, colorSpace, 
+                                                 kCGImageAlphaPremultipliedFirst | kCGBitmapByteOrder32Little);
+    CGColorSpaceRelease(colorSpace);
+    
+    if( !context )
+        return nil;
+    
+    CGRect rect = CGRectMake(0, 0, w, h);
+    
+    CGContextSetInterpolationQuality(context, kCGInterpolationHigh);
+    
+    if( cornerRadius > 0 ) {
+        CGContextBeginPath(context);
+        addRoundedRectToPath(context, rect, cornerRadius * scale, cornerRadius * scale);
+        CGContextClosePath(context);
+        CGContextClip(context);
+    }
+    
+    CGContextDrawImage(context, rect, source);
+    
+    CGImageRef decoded = CGBitmapContextCreateImage(context);
+    CGContextRelease(context);
+    
+    UIImage *img = [UIImage imageWithCGImage:decoded scale:scale orientation:UIImageOrientationUp];
+    CGImageRelease(decoded);
+    
+    return img;
+}
+
 @end
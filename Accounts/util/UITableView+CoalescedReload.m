@@ -0,0 +1,76 @@
+/* 
+ * Copyright (c) 2011, salesforce.com, inc.
+ * Author: Jonathan Hersh jhersh@salesforce.com
+ * All rights reserved.
+ * 
+ * Redistribution and use in source and binary forms, with or without modification, are permitted provided 
+ * that the following conditions are met:
+ * 
+ *    Redistributions of source code must retain the above copyright notice, this list of conditions and the 
+ *    following disclaimer.
+ *  
+ *    Redistributions in binary form must reproduce the above copyright notice, this list of conditions and 
+ *    the following disclaimer in the documentation and/or other materials provided with the distribution. 
+ *    
+ *    Neither the name of salesforce.com, inc. nor the names of its contributors may be used to endorse or 
+ *    promote products derived from this software without specific prior written permission.
+ *  
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED 
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A 
+ * PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR 
+ * ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED 
+ * TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) 
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING 
+ * NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE 
+ * POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#import "UITableView+CoalescedReload.h"
+#import "SFVUtil.h"
+#import <objc/runtime.h>
+
+FIX_CATEGORY_BUG(CoalescedReload);
+
+// Keys for the rows waiting to be reloaded and the animation to use
+static char pendingReloadRows;
+static char pendingReloadAnimation;
+
+@implementation UITableView (CoalescedReload)
+
+- (void) setNeedsReloadRowAtIndexPath:(NSIndexPath *)indexPath withRowAnimation:(UITableViewRowAnimation)animation {
+    if( !indexPath )
+        return;
+    
+    NSMutableSet *rows = objc_getAssociatedObject(self, &pendingReloadRows);
+    
+    if( !rows ) {
+        rows = [NSMutableSet set];
+        objc_setAssociatedObject(self, &pendingReloadRows, rows, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+        objc_setAssociatedObject(self, &pendingReloadAnimation, [NSNumber numberWithInt:animation], OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+        
+        [self performSelector:@selector(reloadPendingRows) withObject:nil afterDelay:0];
+    }
+    
+    [rows addObject:indexPath];
+}
+
+- (void) reloadPendingRows {
+    NSSet *rows = [[objc_getAssociatedObject(self, &pendingReloadRows) retain] autorelease];
+    UITableViewRowAnimation animation = [objc_getAssociatedObject(self, &pendingReloadAnimation) intValue];
+    
+    objc_setAssociatedObject(self, &pendingReloadRows, nil, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    objc_setAssociatedObject(self, &pendingReloadAnimation, nil, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    
+    NSMutableArray *reload = [NSMutableArray arrayWithCapacity:[rows count]];
+    NSInteger sections = [self numberOfSections];
+    
+    for( NSIndexPath *indexPath in rows )
+        if( indexPath.section < sections && indexPath.row < [self numberOfRowsInSection:indexPath.section] )
+            [reload addObject:indexPath];
+    
+    if( [reload count] > 0 )
+        [self reloadRowsAtIndexPaths:reload withRowAnimation:animation];
+}
+
+@end
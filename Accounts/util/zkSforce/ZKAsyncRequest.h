@@ -0,0 +1,57 @@
+// Copyright (c) 2012 Simon Fell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+@class ZKCancellationToken;
+
+typedef void (^ZKAsyncRequestDataBlock)(NSData *chunk);
+typedef void (^ZKAsyncRequestCompleteBlock)(NSData *body, NSHTTPURLResponse *response, NSError *error);
+
+// Runs a single HTTP request without blocking the calling thread. All requests
+// share one network thread whose run loop drives their NSURLConnections, so any
+// number of requests can be in flight without tying up a thread each.
+//
+// dataBlock (optional) is called with each chunk of the response body as it
+// arrives, completeBlock is called exactly once with the entire body, both on
+// the network thread, so they should hand off any real work. If the token is
+// cancelled, the connection is torn down and completeBlock gets an
+// NSURLErrorCancelled error.
+@interface ZKAsyncRequest : NSObject {
+	NSURLRequest		*request;
+	NSURLConnection		*connection;
+	NSHTTPURLResponse	*response;
+	NSMutableData		*body;
+	ZKCancellationToken	*token;
+	id					cancelHandler;
+	ZKAsyncRequestDataBlock		dataBlock;
+	ZKAsyncRequestCompleteBlock	completeBlock;
+	BOOL				finished;
+}
+
+- (id)initWithRequest:(NSURLRequest *)request
+	cancellationToken:(ZKCancellationToken *)token
+			dataBlock:(ZKAsyncRequestDataBlock)dataBlock
+		completeBlock:(ZKAsyncRequestCompleteBlock)completeBlock;
+
+- (void)start;
+- (void)cancel;
+
+@end
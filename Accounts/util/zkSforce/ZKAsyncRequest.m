@@ -0,0 +1,157 @@
+// Copyright (c) 2012 Simon Fell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#import "ZKAsyncRequest.h"
+#import "ZKCancellationToken.h"
+
+@interface ZKAsyncRequest (NetworkThread)
+- (void)startOnNetworkThread;
+- (void)cancelOnNetworkThread;
+- (void)finishWithError:(NSError *)err;
+@end
+
+@implementation ZKAsyncRequest
+
+static NSThread *networkThread = nil;
+
++ (void)networkThreadMain {
+	NSAutoreleasePool *pool = [[NSAutoreleasePool alloc] init];
+	NSRunLoop *runLoop = [NSRunLoop currentRunLoop];
+	// the port keeps the run loop from returning straight away when there are no connections.
+	[runLoop addPort:[NSMachPort port] forMode:NSDefaultRunLoopMode];
+	[pool release];
+	while (YES) {
+		pool = [[NSAutoreleasePool alloc] init];
+		[runLoop runMode:NSDefaultRunLoopMode beforeDate:[NSDate distantFuture]];
+		[pool release];
+	}
+}
+
++ (NSThread *)networkThread {
+	static dispatch_once_t once;
+	dispatch_once(&once, ^{
+		networkThread = [[NSThread alloc] initWithTarget:self selector:@selector(networkThreadMain) object:nil];
+		[networkThread setName:@"ZKAsyncRequest"];
+		[networkThread start];
+	});
+	return networkThread;
+}
+
+- (id)initWithRequest:(NSURLRequest *)req cancellationToken:(ZKCancellationToken *)tkn dataBlock:(ZKAsyncRequestDataBlock)db completeBlock:(ZKAsyncRequestCompleteBlock)cb {
+	self = [super init];
+	request = [req copy];
+	token = [tkn retain];
+	dataBlock = [db copy];
+	completeBlock = [cb copy];
+	return self;
+}
+
+- (void)dealloc {
+	[request release];
+	[connection release];
+	[response release];
+	[body release];
+	[token release];
+	[cancelHandler release];
+	[dataBlock release];
+	[completeBlock release];
+	[super dealloc];
+}
+
+- (void)start {
+	// balanced in finishWithError:, we need to stay around until the request is done
+	// regardless of whether the caller holds on to us.
+	[self retain];
+	[self performSelector:@selector(startOnNetworkThread) onThread:[ZKAsyncRequest networkThread] withObject:nil waitUntilDone:NO];
+}
+
+- (void)cancel {
+	[self performSelector:@selector(cancelOnNetworkThread) onThread:[ZKAsyncRequest networkThread] withObject:nil waitUntilDone:NO];
+}
+
+@end
+
+@implementation ZKAsyncRequest (NetworkThread)
+
+- (void)startOnNetworkThread {
+	if ([token isCancelled]) {
+		[self cancelOnNetworkThread];
+		return;
+	}
+	cancelHandler = [[token addCancelHandler:^{
+		[self cancel];
+	}] retain];
+	connection = [[NSURLConnection alloc] initWithRequest:request delegate:self startImmediately:NO];
+	[connection scheduleInRunLoop:[NSRunLoop currentRunLoop] forMode:NSDefaultRunLoopMode];
+	[connection start];
+}
+
+- (void)cancelOnNetworkThread {
+	if (finished) return;
+	[connection cancel];
+	[self finishWithError:[NSError errorWithDomain:NSURLErrorDomain code:NSURLErrorCancelled userInfo:nil]];
+}
+
+- (void)finishWithError:(NSError *)err {
+	if (finished) return;
+	finished = YES;
+	// the handler retains us, so it has to go now rather than in dealloc.
+	[token removeCancelHandler:cancelHandler];
+	[cancelHandler release];
+	cancelHandler = nil;
+	completeBlock(err == nil ? body : nil, response, err);
+	// the connection retains us as its delegate, so break that cycle here.
+	[connection release];
+	connection = nil;
+	[self release];
+}
+
+- (void)connection:(NSURLConnection *)c didReceiveResponse:(NSURLResponse *)r {
+	if ([r isKindOfClass:[NSHTTPURLResponse class]]) {
+		[response release];
+		response = (NSHTTPURLResponse *)[r retain];
+	}
+	long long len = [r expectedContentLength];
+	[body release];
+	body = [[NSMutableData alloc] initWithCapacity:len > 0 ? (NSUInteger)len : 4096];
+}
+
+- (void)connection:(NSURLConnection *)c didReceiveData:(NSData *)data {
+	if (finished) return;
+	[body appendData:data];
+	if (dataBlock != nil)
+		dataBlock(data);
+}
+
+- (void)connection:(NSURLConnection *)c didFailWithError:(NSError *)err {
+	[self finishWithError:err];
+}
+
+- (void)connectionDidFinishLoading:(NSURLConnection *)c {
+	[self finishWithError:nil];
+}
+
+- (NSCachedURLResponse *)connection:(NSURLConnection *)c willCacheResponse:(NSCachedURLResponse *)cachedResponse {
+	return nil;
+}
+
+@end
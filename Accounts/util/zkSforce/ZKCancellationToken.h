@@ -0,0 +1,53 @@
+// Copyright (c) 2012 Simon Fell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+// name of the exception thrown by a synchronous call whose token was cancelled.
+extern NSString *ZKCancelledException;
+
+// A cancellation token can be passed to the async calls on ZKBaseClient and
+// ZKSforceClient, calling cancel on the token cancels any requests still in
+// flight that were started with it, and their completion blocks won't be called.
+// One token can be shared by as many requests as you like, e.g. everything a
+// particular view is waiting on.
+@interface ZKCancellationToken : NSObject {
+	NSMutableArray	*handlers;
+	BOOL			cancelled;
+}
+
++ (ZKCancellationToken *)token;
+
+- (void)cancel;
+@property (readonly, getter=isCancelled) BOOL cancelled;
+
+// handler is called on the thread that calls cancel, or right away if the token
+// has already been cancelled. The returned object can be passed to removeCancelHandler:
+// once whatever the handler would cancel has finished.
+- (id)addCancelHandler:(void (^)(void))handler;
+- (void)removeCancelHandler:(id)handler;
+
+// Synchronous calls made on a thread pick up that thread's current token, so
+// that code running the existing blocking API can still be cancelled, in which
+// case the call throws a ZKCancelledException.
++ (ZKCancellationToken *)currentToken;
++ (void)setCurrentToken:(ZKCancellationToken *)token;
+
+@end
@@ -0,0 +1,95 @@
+// Copyright (c) 2012 Simon Fell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#import "ZKCancellationToken.h"
+
+NSString *ZKCancelledException = @"ZKCancelledException";
+
+static NSString *CURRENT_TOKEN_KEY = @"ZKCancellationToken.current";
+
+@implementation ZKCancellationToken
+
++ (ZKCancellationToken *)token {
+	return [[[ZKCancellationToken alloc] init] autorelease];
+}
+
++ (ZKCancellationToken *)currentToken {
+	return [[[NSThread currentThread] threadDictionary] objectForKey:CURRENT_TOKEN_KEY];
+}
+
++ (void)setCurrentToken:(ZKCancellationToken *)token {
+	if (token == nil)
+		[[[NSThread currentThread] threadDictionary] removeObjectForKey:CURRENT_TOKEN_KEY];
+	else
+		[[[NSThread currentThread] threadDictionary] setObject:token forKey:CURRENT_TOKEN_KEY];
+}
+
+- (id)init {
+	self = [super init];
+	handlers = [[NSMutableArray alloc] init];
+	return self;
+}
+
+- (void)dealloc {
+	[handlers release];
+	[super dealloc];
+}
+
+- (BOOL)isCancelled {
+	@synchronized(self) {
+		return cancelled;
+	}
+}
+
+- (id)addCancelHandler:(void (^)(void))handler {
+	id h = [[handler copy] autorelease];
+	@synchronized(self) {
+		if (!cancelled) {
+			[handlers addObject:h];
+			return h;
+		}
+	}
+	handler();
+	return h;
+}
+
+- (void)removeCancelHandler:(id)handler {
+	if (handler == nil) return;
+	@synchronized(self) {
+		[handlers removeObjectIdenticalTo:handler];
+	}
+}
+
+- (void)cancel {
+	NSArray *toRun = nil;
+	@synchronized(self) {
+		if (cancelled) return;
+		cancelled = YES;
+		toRun = [[handlers copy] autorelease];
+		[handlers removeAllObjects];
+	}
+	// run these outside the lock, they're free to call back into us.
+	for (void (^h)(void) in toRun)
+		h();
+}
+
+@end
@@ -0,0 +1,42 @@
+// Copyright (c) 2012 Simon Fell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#import <Foundation/Foundation.h>
+
+// Parses the xsd:dateTime and xsd:date values the API sends, straight from
+// their UTF-8 bytes, without allocating anything along the way.
+//   2011-01-24T17:34:14.000Z
+//   2011-01-24T17:34:14.000+0000	(REST)
+//   2011-01-24T17:34:14-08:00
+//   2011-01-24
+// A dateTime without a zone is taken to be UTC. For a dateTime, *seconds is
+// that instant, for a date it's midnight that day in the default time zone,
+// either way as seconds since 1970. isDateTime may be NULL. Returns NO if the
+// value isn't in one of these forms, in which case *seconds is left alone.
+BOOL ZKParseDateTimeBytes(const char *bytes, size_t length, NSTimeInterval *seconds, BOOL *isDateTime);
+
+// As above, for a string, ignoring any whitespace around the value.
+BOOL ZKParseDateTime(NSString *value, NSTimeInterval *seconds, BOOL *isDateTime);
+
+// Formats seconds since 1970 as an xsd:dateTime in UTC (2011-01-24T17:34:14.000Z),
+// or as an xsd:date for the day it falls on in the default time zone (2011-01-24).
+NSString *ZKStringFromDateTime(NSTimeInterval seconds, BOOL isDateTime);
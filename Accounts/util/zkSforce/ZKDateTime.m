@@ -0,0 +1,153 @@
+// Copyright (c) 2012 Simon Fell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#import "ZKDateTime.h"
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+
+// Days from 1970-01-01 to this day of the proleptic Gregorian calendar.
+static int64_t daysFromCivil(int year, int month, int day) {
+	year -= month <= 2;
+	int64_t era = (year >= 0 ? year : year - 399) / 400;
+	int yearOfEra = (int)(year - era * 400);
+	int dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+	int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+	return era * 146097 + dayOfEra - 719468;
+}
+
+// Seconds from GMT in the default time zone at this many seconds since 1970.
+static NSTimeInterval defaultZoneOffset(NSTimeInterval seconds) {
+	CFTimeZoneRef tz = CFTimeZoneCopyDefault();
+	NSTimeInterval offset = CFTimeZoneGetSecondsFromGMT(tz, seconds - kCFAbsoluteTimeIntervalSince1970);
+	CFRelease(tz);
+	return offset;
+}
+
+// Reads count digits at *p, advancing past them. returns -1 if they're not all digits.
+static int readDigits(const char **p, const char *end, int count) {
+	int value = 0;
+	if (end - *p < count) return -1;
+	for (int i = 0; i < count; i++) {
+		char c = (*p)[i];
+		if (c < '0' || c > '9') return -1;
+		value = value * 10 + (c - '0');
+	}
+	*p += count;
+	return value;
+}
+
+BOOL ZKParseDateTimeBytes(const char *bytes, size_t length, NSTimeInterval *seconds, BOOL *isDateTime) {
+	if (bytes == NULL || seconds == NULL) return NO;
+	const char *p = bytes, *end = bytes + length;
+
+	int year = readDigits(&p, end, 4);
+	if (year < 0 || p == end || *p++ != '-') return NO;
+	int month = readDigits(&p, end, 2);
+	if (month < 1 || month > 12 || p == end || *p++ != '-') return NO;
+	int day = readDigits(&p, end, 2);
+	if (day < 1 || day > 31) return NO;
+	int64_t days = daysFromCivil(year, month, day);
+
+	if (p == end) {
+		// a date, midnight local time. The offset at UTC midnight gets us close
+		// enough to look up the offset that actually applies on that day.
+		NSTimeInterval midnight = days * 86400.0;
+		NSTimeInterval offset = defaultZoneOffset(midnight);
+		*seconds = midnight - defaultZoneOffset(midnight - offset);
+		if (isDateTime) *isDateTime = NO;
+		return YES;
+	}
+
+	if (*p != 'T' && *p != ' ') return NO;
+	p++;
+	int hour = readDigits(&p, end, 2);
+	if (hour < 0 || hour > 23 || p == end || *p++ != ':') return NO;
+	int minute = readDigits(&p, end, 2);
+	if (minute < 0 || minute > 59 || p == end || *p++ != ':') return NO;
+	int second = readDigits(&p, end, 2);
+	if (second < 0 || second > 60) return NO;
+
+	double fraction = 0, scale = 0.1;
+	if (p < end && *p == '.') {
+		p++;
+		if (p == end || *p < '0' || *p > '9') return NO;
+		while (p < end && *p >= '0' && *p <= '9') {
+			fraction += (*p++ - '0') * scale;
+			scale /= 10;
+		}
+	}
+
+	int zoneOffset = 0;
+	if (p < end && *p == 'Z') {
+		p++;
+	} else if (p < end && (*p == '+' || *p == '-')) {
+		int sign = *p++ == '-' ? -1 : 1;
+		int zoneHours = readDigits(&p, end, 2), zoneMinutes = 0;
+		if (zoneHours < 0) return NO;
+		if (p < end && *p == ':') p++;
+		if (p < end) {
+			zoneMinutes = readDigits(&p, end, 2);
+			if (zoneMinutes < 0) return NO;
+		}
+		zoneOffset = sign * (zoneHours * 3600 + zoneMinutes * 60);
+	}
+	if (p != end) return NO;
+
+	*seconds = days * 86400.0 + hour * 3600 + minute * 60 + second + fraction - zoneOffset;
+	if (isDateTime) *isDateTime = YES;
+	return YES;
+}
+
+BOOL ZKParseDateTime(NSString *value, NSTimeInterval *seconds, BOOL *isDateTime) {
+	if (![value isKindOfClass:[NSString class]]) return NO;
+	char buffer[64];
+	const char *bytes = CFStringGetCStringPtr((CFStringRef)value, kCFStringEncodingUTF8);
+	if (bytes == NULL) {
+		if (!CFStringGetCString((CFStringRef)value, buffer, sizeof(buffer), kCFStringEncodingUTF8))
+			return NO;
+		bytes = buffer;
+	}
+	size_t length = strlen(bytes);
+	while (length > 0 && isspace((unsigned char)*bytes)) {
+		bytes++;
+		length--;
+	}
+	while (length > 0 && isspace((unsigned char)bytes[length - 1]))
+		length--;
+	return ZKParseDateTimeBytes(bytes, length, seconds, isDateTime);
+}
+
+NSString *ZKStringFromDateTime(NSTimeInterval seconds, BOOL isDateTime) {
+	struct tm parts;
+	char buffer[32];
+	if (!isDateTime)
+		seconds += defaultZoneOffset(seconds);
+	time_t t = (time_t)floor(seconds);
+	gmtime_r(&t, &parts);
+	if (isDateTime)
+		snprintf(buffer, sizeof(buffer), "%04d-%02d-%02dT%02d:%02d:%02d.000Z",
+			parts.tm_year + 1900, parts.tm_mon + 1, parts.tm_mday, parts.tm_hour, parts.tm_min, parts.tm_sec);
+	else
+		snprintf(buffer, sizeof(buffer), "%04d-%02d-%02d", parts.tm_year + 1900, parts.tm_mon + 1, parts.tm_mday);
+	return [NSString stringWithUTF8String:buffer];
+}
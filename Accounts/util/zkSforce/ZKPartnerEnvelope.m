@@ -27,6 +27,16 @@
 	return [self initWithSessionAndMruHeaders:sessionId mru:NO clientId:clientId];
 }
 
+- (id)initWithSessionHeader:(NSString *)sessionId clientId:(NSString *)clientId queryBatchSize:(int)batchSize {
+	self = [super init];
+	[self start:@"urn:partner.soap.sforce.com"];
+	[self writeSessionHeader:sessionId];
+	[self writeCallOptionsHeader:clientId];
+	[self writeQueryOptionsHeader:batchSize];
+	[self moveToBody];
+	return self;
+}
+
 - (id)initWithSessionAndMruHeaders:(NSString *)sessionId mru:(BOOL)mru clientId:(NSString *)clientId {
 	self = [super init];
 	[self start:@"urn:partner.soap.sforce.com"];
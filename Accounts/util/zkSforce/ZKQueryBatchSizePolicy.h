@@ -0,0 +1,60 @@
+// Copyright (c) 2012 Simon Fell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#import <Foundation/Foundation.h>
+
+@class ZKQueryResult;
+
+// Picks the QueryOptions batchSize for query / queryAll / queryMore calls.
+// Narrow queries get big pages so lists fill in with fewer round trips, wide
+// queries get small pages so the first page comes back quickly. Until there's
+// been a few decent sized pages, this works from a fixed budget of
+// records x fields per page, after that it sizes pages so that they should take
+// about targetResponseTime, based on how long recent pages took per field value.
+// This is safe to share across threads and across copies of the client.
+@interface ZKQueryBatchSizePolicy : NSObject {
+	NSTimeInterval		targetResponseTime;
+	double				secondsPerCell;
+	NSUInteger			samples;
+	NSMutableDictionary	*locatorFieldCounts;
+}
+
+// How many fields are in the select list of this soql query, a relationship
+// subquery counts as one field. returns 0 if soql doesn't look like a query.
++ (NSUInteger)fieldCountForSoql:(NSString *)soql;
+
+// The field count of the query that this locator came from, if its been
+// passed to queryResult:fieldCount:responseTime: already, 0 otherwise.
+- (NSUInteger)fieldCountForQueryLocator:(NSString *)queryLocator;
+
+// The batchSize to ask for, between 200 and 2000 (the range the API accepts),
+// or 0 if fieldCount is 0, in which case no QueryOptions header should be sent.
+- (int)batchSizeForFieldCount:(NSUInteger)fieldCount;
+
+// Tell the policy how long it took to get this page back, and remember its
+// queryLocator so that the following queryMore uses the same field count.
+- (void)queryResult:(ZKQueryResult *)qr fieldCount:(NSUInteger)fieldCount responseTime:(NSTimeInterval)elapsed;
+
+// How long a page should take to come back, defaults to 2 seconds.
+@property (assign) NSTimeInterval targetResponseTime;
+
+@end
@@ -0,0 +1,131 @@
+// Copyright (c) 2012 Simon Fell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#import "ZKQueryBatchSizePolicy.h"
+#import "zkQueryResult.h"
+
+static const int MIN_QUERY_BATCH_SIZE = 200;
+static const int MAX_QUERY_BATCH_SIZE = 2000;
+
+// records x fields per page until we've timed some pages.
+static const NSUInteger DEFAULT_CELL_BUDGET = 20000;
+
+// pages smaller than this are mostly latency, so don't tell us much about
+// the cost per field value.
+static const NSUInteger MIN_SAMPLE_CELLS = 2000;
+static const NSUInteger MIN_SAMPLES = 2;
+
+static const NSUInteger MAX_REMEMBERED_LOCATORS = 64;
+
+@implementation ZKQueryBatchSizePolicy
+
+@synthesize targetResponseTime;
+
+- (id)init {
+	self = [super init];
+	targetResponseTime = 2.0;
+	locatorFieldCounts = [[NSMutableDictionary alloc] init];
+	return self;
+}
+
+- (void)dealloc {
+	[locatorFieldCounts release];
+	[super dealloc];
+}
+
+static BOOL isSoqlSpace(unichar c) {
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
++ (NSUInteger)fieldCountForSoql:(NSString *)soql {
+	soql = [soql stringByTrimmingCharactersInSet:[NSCharacterSet whitespaceAndNewlineCharacterSet]];
+	NSUInteger len = [soql length];
+	if (![soql rangeOfString:@"select" options:NSCaseInsensitiveSearch | NSAnchoredSearch].length) return 0;
+	unichar *chars = malloc(len * sizeof(unichar));
+	[soql getCharacters:chars range:NSMakeRange(0, len)];
+	// count the top level commas up to the top level FROM, anything in parens is a subquery.
+	NSUInteger fields = 1, depth = 0, i;
+	BOOL sawFrom = NO;
+	for (i = 6; i + 5 < len; i++) {
+		unichar c = chars[i];
+		if (c == '(') depth++;
+		else if (c == ')' && depth > 0) depth--;
+		else if (c == ',' && depth == 0) fields++;
+		else if (depth == 0 && isSoqlSpace(c) && isSoqlSpace(chars[i+5])
+				 && (chars[i+1] | 0x20) == 'f' && (chars[i+2] | 0x20) == 'r'
+				 && (chars[i+3] | 0x20) == 'o' && (chars[i+4] | 0x20) == 'm') {
+			sawFrom = YES;
+			break;
+		}
+	}
+	free(chars);
+	return sawFrom ? fields : 0;
+}
+
+static NSString *cursorKey(NSString *queryLocator) {
+	// locators are <cursor id>-<offset>, the cursor id is the same for every page.
+	NSRange dash = [queryLocator rangeOfString:@"-" options:NSBackwardsSearch];
+	return dash.location == NSNotFound ? queryLocator : [queryLocator substringToIndex:dash.location];
+}
+
+- (NSUInteger)fieldCountForQueryLocator:(NSString *)queryLocator {
+	if ([queryLocator length] == 0) return 0;
+	@synchronized(self) {
+		return [[locatorFieldCounts objectForKey:cursorKey(queryLocator)] unsignedIntegerValue];
+	}
+}
+
+- (int)batchSizeForFieldCount:(NSUInteger)fieldCount {
+	if (fieldCount == 0) return 0;
+	double size;
+	@synchronized(self) {
+		if (samples >= MIN_SAMPLES && secondsPerCell > 0)
+			size = targetResponseTime / (secondsPerCell * fieldCount);
+		else
+			size = (double)DEFAULT_CELL_BUDGET / fieldCount;
+	}
+	if (size < MIN_QUERY_BATCH_SIZE) return MIN_QUERY_BATCH_SIZE;
+	if (size > MAX_QUERY_BATCH_SIZE) return MAX_QUERY_BATCH_SIZE;
+	// the server treats batchSize as a hint, no point being more exact than this.
+	return ((int)size / 100) * 100;
+}
+
+- (void)queryResult:(ZKQueryResult *)qr fieldCount:(NSUInteger)fieldCount responseTime:(NSTimeInterval)elapsed {
+	if (fieldCount == 0) return;
+	NSUInteger cells = [[qr records] count] * fieldCount;
+	NSString *key = [qr done] ? nil : cursorKey([qr queryLocator]);
+	@synchronized(self) {
+		if (cells >= MIN_SAMPLE_CELLS && elapsed > 0) {
+			double observed = elapsed / cells;
+			// exponentially weighted, so we follow changes in network conditions.
+			secondsPerCell = samples == 0 ? observed : secondsPerCell * 0.7 + observed * 0.3;
+			samples++;
+		}
+		if (key != nil) {
+			if ([locatorFieldCounts count] >= MAX_REMEMBERED_LOCATORS)
+				[locatorFieldCounts removeAllObjects];
+			[locatorFieldCounts setObject:[NSNumber numberWithUnsignedInteger:fieldCount] forKey:key];
+		}
+	}
+}
+
+@end
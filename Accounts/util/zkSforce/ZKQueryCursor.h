@@ -0,0 +1,74 @@
+// Copyright (c) 2012 Simon Fell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+@class ZKSforceClient;
+@class ZKQueryResult;
+@class ZKCancellationToken;
+
+typedef void (^ZKQueryCursorPageBlock)(NSArray *records, NSException *error);
+
+// Walks the pages of a query, fetching ahead with queryMore while the caller is
+// busy with the current page, so that asking for the next page is usually
+// answered straight from the buffer instead of a round trip to the server.
+// The cursor must only be used from the main thread, and calls its blocks there.
+@interface ZKQueryCursor : NSObject {
+	ZKSforceClient		*client;
+	ZKCancellationToken	*token, *parentToken;
+	id					parentHandler;
+	NSString			*soql;
+	NSString			*nextLocator;
+	NSMutableArray		*pages;
+	NSUInteger			bufferedRecords;
+	NSUInteger			lookAhead, maxBufferedRecords;
+	NSInteger			size;
+	BOOL				fetching, started;
+	NSException			*error;
+	ZKQueryCursorPageBlock	waiting;
+}
+
+// starts by running the query, its first page is the first one returned by nextPage:
+- (id)initWithClient:(ZKSforceClient *)client soql:(NSString *)soql;
+
+// for when you already have the first page, nextPage: will return the page after it.
+// If parentToken is cancelled, so is the cursor.
+- (id)initWithClient:(ZKSforceClient *)client queryResult:(ZKQueryResult *)first cancellationToken:(ZKCancellationToken *)parentToken;
+
+// how many pages to fetch ahead of the consumer (defaults to 1)
+@property (assign) NSUInteger lookAhead;
+
+// stop fetching ahead once this many records are waiting in the buffer (defaults to 2000)
+@property (assign) NSUInteger maxBufferedRecords;
+
+// true while there are pages left, either buffered or still on the server.
+@property (readonly) BOOL hasMore;
+
+// the total size of the query, as reported by the server.
+@property (readonly) NSInteger size;
+
+// calls block with the next page's records, immediately if it's already been fetched,
+// otherwise once it arrives. records is nil once there are no more pages.
+- (void)nextPage:(ZKQueryCursorPageBlock)block;
+
+// stops any fetching, blocks that are waiting on a page won't be called.
+- (void)cancel;
+
+@end
@@ -0,0 +1,180 @@
+// Copyright (c) 2012 Simon Fell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#import "ZKQueryCursor.h"
+#import "zkSforceClient.h"
+#import "zkQueryResult.h"
+#import "ZKCancellationToken.h"
+
+static const NSUInteger DEFAULT_LOOK_AHEAD = 1;
+static const NSUInteger DEFAULT_MAX_BUFFERED_RECORDS = 2000;
+
+@interface ZKQueryCursor (Private)
+- (void)fill;
+@end
+
+@implementation ZKQueryCursor
+
+@synthesize lookAhead, maxBufferedRecords, size;
+
+- (id)initWithClient:(ZKSforceClient *)c {
+	self = [super init];
+	client = [c retain];
+	token = [[ZKCancellationToken alloc] init];
+	pages = [[NSMutableArray alloc] init];
+	lookAhead = DEFAULT_LOOK_AHEAD;
+	maxBufferedRecords = DEFAULT_MAX_BUFFERED_RECORDS;
+	return self;
+}
+
+- (id)initWithClient:(ZKSforceClient *)c soql:(NSString *)q {
+	self = [self initWithClient:c];
+	soql = [q copy];
+	[self fill];
+	return self;
+}
+
+- (id)initWithClient:(ZKSforceClient *)c queryResult:(ZKQueryResult *)first cancellationToken:(ZKCancellationToken *)parent {
+	self = [self initWithClient:c];
+	started = YES;
+	size = [first size];
+	nextLocator = [first done] ? nil : [[first queryLocator] copy];
+	// only capture the child token, so the parent doesn't keep us alive.
+	ZKCancellationToken *child = token;
+	parentToken = [parent retain];
+	parentHandler = [[parent addCancelHandler:^{
+		[child cancel];
+	}] retain];
+	[self fill];
+	return self;
+}
+
+- (void)dealloc {
+	[self cancel];
+	[client release];
+	[token release];
+	[parentToken release];
+	[parentHandler release];
+	[soql release];
+	[nextLocator release];
+	[pages release];
+	[error release];
+	[waiting release];
+	[super dealloc];
+}
+
+- (BOOL)hasMore {
+	return [pages count] > 0 || nextLocator != nil || !started;
+}
+
+- (void)cancel {
+	[parentToken removeCancelHandler:parentHandler];
+	[token cancel];
+	[waiting release];
+	waiting = nil;
+}
+
+- (void)nextPage:(ZKQueryCursorPageBlock)block {
+	if ([token isCancelled]) return;
+	if ([pages count] > 0) {
+		NSArray *records = [[[pages objectAtIndex:0] retain] autorelease];
+		[pages removeObjectAtIndex:0];
+		bufferedRecords -= [records count];
+		[self fill];
+		block(records, nil);
+	} else if (error != nil) {
+		block(nil, error);
+	} else if (![self hasMore]) {
+		block(nil, nil);
+	} else {
+		[waiting release];
+		waiting = [block copy];
+		[self fill];
+	}
+}
+
+@end
+
+@implementation ZKQueryCursor (Private)
+
+- (void)receivedPage:(ZKQueryResult *)qr error:(NSException *)ex {
+	fetching = NO;
+	if ([token isCancelled]) return;
+	started = YES;
+	if (ex != nil) {
+		[error release];
+		error = [ex retain];
+		[nextLocator release];
+		nextLocator = nil;
+	} else {
+		if (soql != nil && size == 0)
+			size = [qr size];
+		[nextLocator release];
+		nextLocator = [qr done] ? nil : [[qr queryLocator] copy];
+		NSArray *records = [qr records] != nil ? [qr records] : [NSArray array];
+		[pages addObject:records];
+		bufferedRecords += [records count];
+	}
+	if (waiting != nil) {
+		ZKQueryCursorPageBlock block = [waiting autorelease];
+		waiting = nil;
+		[self nextPage:block];
+	} else {
+		[self fill];
+	}
+}
+
+// queryMore needs the locator from the previous page, so there's only ever one
+// fetch in flight, fill just keeps going until the buffer is deep enough.
+- (void)fill {
+	if (fetching || [token isCancelled] || error != nil) return;
+	if (started && nextLocator == nil) return;
+	// someone waiting always gets a fetch, regardless of the limits.
+	if (waiting == nil && ([pages count] >= lookAhead || bufferedRecords >= maxBufferedRecords)) return;
+	
+	fetching = YES;
+	void (^complete)(ZKQueryResult *) = ^(ZKQueryResult *qr) {
+		dispatch_async(dispatch_get_main_queue(), ^{
+			[self receivedPage:qr error:nil];
+		});
+	};
+	ZKFailBlock fail = ^(NSException *ex) {
+		dispatch_async(dispatch_get_main_queue(), ^{
+			[self receivedPage:nil error:ex];
+		});
+	};
+	// the client may need to refresh its session first, which blocks, so kick off from the background.
+	NSString *locator = [[nextLocator copy] autorelease];
+	// a failed session refresh throws from here rather than calling fail, so catch it, or fetching never clears.
+	dispatch_async(dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^{
+		@try {
+			if (!started)
+				[client query:soql cancellationToken:token completeBlock:complete failBlock:fail];
+			else
+				[client queryMore:locator cancellationToken:token completeBlock:complete failBlock:fail];
+		} @catch (NSException *ex) {
+			fail(ex);
+		}
+	});
+}
+
+@end
@@ -0,0 +1,65 @@
+// Copyright (c) 2012 Simon Fell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include <libxml/parser.h>
+
+// What the result element(s) of the response contain.
+typedef enum {
+	zkStreamResultQueryResult = 0,	// a single QueryResult, for query / queryAll / queryMore
+	zkStreamResultSObjects			// zero or more sObjects, for retrieve
+} ZKStreamResultType;
+
+// A SAX2 push parser for SOAP responses that builds ZKQueryResult / ZKSObject
+// instances directly as bytes are fed to it, without building a DOM first.
+// Data can be pushed in as many chunks as you like, call finish once all the
+// data has been pushed. If finish returns NO, the response wasn't something
+// this parser understands, and the caller should fall back to zkParser.
+@interface ZKStreamParser : NSObject {
+	xmlParserCtxtPtr	ctxt;
+	ZKStreamResultType	resultType;
+	void				*frames;
+	int					depth, capacity;
+	NSMutableData		*text;
+	CFMutableDictionaryRef names;
+	id					result;
+	NSString			*faultCode, *faultString;
+	BOOL				sawBody, failed;
+}
+
+- (id)initWithResultType:(ZKStreamResultType)type;
+
+// push the next chunk of the response body into the parser.
+- (void)parseBytes:(const void *)bytes length:(NSUInteger)length;
+- (void)parseData:(NSData *)data;
+
+// call once all the data has been pushed, returns YES if the response
+// was successfully parsed into either a result or a soap fault.
+- (BOOL)finish;
+
+// a ZKQueryResult for zkStreamResultQueryResult, an NSArray of ZKSObjects
+// for zkStreamResultSObjects.
+@property (readonly) id result;
+
+// set if the response was a soap:Fault
+@property (readonly) NSString *faultCode;
+@property (readonly) NSString *faultString;
+
+@end
@@ -0,0 +1,342 @@
+// Copyright (c) 2012 Simon Fell
+//
+// Permission is hereby granted, free of charge, to any person obtaining a
+// copy of this software and associated documentation files (the "Software"),
+// to deal in the Software without restriction, including without limitation
+// the rights to use, copy, modify, merge, publish, distribute, sublicense,
+// and/or sell copies of the Software, and to permit persons to whom the
+// Software is furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included
+// in all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+// OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#import "ZKStreamParser.h"
+#import "zkSObject.h"
+#import "zkQueryResult.h"
+
+static const char *SOAP_NS_C = "http://schemas.xmlsoap.org/soap/envelope/";
+static const char *XSI_NS_C  = "http://www.w3.org/2001/XMLSchema-instance";
+
+enum frameKind {
+	fkEnvelope = 1,
+	fkBody,
+	fkResponse,
+	fkFault,
+	fkQueryResult,
+	fkSObject,
+	fkValue,
+	fkIgnore
+};
+
+// one of these per open element, the stack only ever gets as deep as the
+// document, so for a query response with relationship queries that's ~10.
+typedef struct {
+	int				kind;
+	int				childIndex;
+	BOOL			isNil;
+	NSString		*name;			// interned in names, not retained
+	ZKSObject		*sobject;		// fkSObject
+	NSMutableArray	*records;		// fkQueryResult
+	NSString		*queryLocator;	// fkQueryResult
+	int				size;			// fkQueryResult
+	BOOL			done;			// fkQueryResult
+} zkStreamFrame;
+
+@interface ZKStreamParser (Private)
+- (void)startElement:(const xmlChar *)localname uri:(const xmlChar *)uri attrCount:(int)nb attributes:(const xmlChar **)attrs;
+- (void)endElement;
+- (void)characters:(const xmlChar *)ch length:(int)len;
+@end
+
+static void zkStartElementNs(void *ctx, const xmlChar *localname, const xmlChar *prefix, const xmlChar *URI,
+							 int nb_namespaces, const xmlChar **namespaces, int nb_attributes, int nb_defaulted, const xmlChar **attributes) {
+	[(ZKStreamParser *)ctx startElement:localname uri:URI attrCount:nb_attributes attributes:attributes];
+}
+
+static void zkEndElementNs(void *ctx, const xmlChar *localname, const xmlChar *prefix, const xmlChar *URI) {
+	[(ZKStreamParser *)ctx endElement];
+}
+
+static void zkCharacters(void *ctx, const xmlChar *ch, int len) {
+	[(ZKStreamParser *)ctx characters:ch length:len];
+}
+
+static xmlSAXHandler zkSaxHandler;
+
+static BOOL xmlStrEq(const xmlChar *a, const char *b) {
+	return a != NULL && strcmp((const char *)a, b) == 0;
+}
+
+static BOOL xmlStrHasSuffix(const xmlChar *s, int len, const char *suffix) {
+	int sl = (int)strlen(suffix);
+	return len >= sl && memcmp(s + len - sl, suffix, sl) == 0;
+}
+
+@implementation ZKStreamParser
+
+@synthesize result, faultCode, faultString;
+
++ (void)initialize {
+	if (self != [ZKStreamParser class]) return;
+	memset(&zkSaxHandler, 0, sizeof(zkSaxHandler));
+	zkSaxHandler.initialized = XML_SAX2_MAGIC;
+	zkSaxHandler.startElementNs = zkStartElementNs;
+	zkSaxHandler.endElementNs = zkEndElementNs;
+	zkSaxHandler.characters = zkCharacters;
+}
+
+- (id)initWithResultType:(ZKStreamResultType)type {
+	self = [super init];
+	resultType = type;
+	capacity = 16;
+	frames = calloc(capacity, sizeof(zkStreamFrame));
+	text = [[NSMutableData alloc] initWithCapacity:256];
+	// element local names from the SAX2 callbacks are interned in the parser's
+	// dictionary, so we can cache the matching NSString keyed by pointer.
+	names = CFDictionaryCreateMutable(NULL, 0, NULL, &kCFTypeDictionaryValueCallBacks);
+	ctxt = xmlCreatePushParserCtxt(&zkSaxHandler, self, NULL, 0, NULL);
+	xmlCtxtUseOptions(ctxt, XML_PARSE_NONET);
+	return self;
+}
+
+- (void)releaseFrame:(zkStreamFrame *)f {
+	[f->sobject release];
+	[f->records release];
+	[f->queryLocator release];
+	memset(f, 0, sizeof(zkStreamFrame));
+}
+
+- (void)dealloc {
+	zkStreamFrame *stack = (zkStreamFrame *)frames;
+	for (int i = 0; i < depth; i++)
+		[self releaseFrame:&stack[i]];
+	free(frames);
+	if (ctxt != NULL)
+		xmlFreeParserCtxt(ctxt);
+	CFRelease(names);
+	[text release];
+	[result release];
+	[faultCode release];
+	[faultString release];
+	[super dealloc];
+}
+
+- (void)parseBytes:(const void *)bytes length:(NSUInteger)length {
+	if (failed || length == 0) return;
+	if (xmlParseChunk(ctxt, (const char *)bytes, (int)length, 0) != 0)
+		failed = YES;
+}
+
+- (void)parseData:(NSData *)data {
+	[self parseBytes:[data bytes] length:[data length]];
+}
+
+- (BOOL)finish {
+	if (!failed && xmlParseChunk(ctxt, NULL, 0, 1) != 0)
+		failed = YES;
+	if (!ctxt->wellFormed)
+		failed = YES;
+	return !failed && sawBody && (faultCode != nil || result != nil);
+}
+
+- (NSString *)nameFor:(const xmlChar *)localname {
+	NSString *n = (NSString *)CFDictionaryGetValue(names, localname);
+	if (n == nil) {
+		n = [[NSString alloc] initWithUTF8String:(const char *)localname];
+		CFDictionarySetValue(names, localname, n);
+		[n release];
+	}
+	return n;
+}
+
+- (zkStreamFrame *)push:(int)kind name:(NSString *)name {
+	if (depth == capacity) {
+		capacity *= 2;
+		frames = realloc(frames, capacity * sizeof(zkStreamFrame));
+		memset((zkStreamFrame *)frames + depth, 0, (capacity - depth) * sizeof(zkStreamFrame));
+	}
+	zkStreamFrame *f = (zkStreamFrame *)frames + depth++;
+	f->kind = kind;
+	f->name = name;
+	if (kind == fkValue)
+		[text setLength:0];
+	return f;
+}
+
+- (void)startElement:(const xmlChar *)localname uri:(const xmlChar *)uri attrCount:(int)nb attributes:(const xmlChar **)attrs {
+	if (failed) return;
+	zkStreamFrame *parent = depth > 0 ? (zkStreamFrame *)frames + depth - 1 : NULL;
+	if (parent != NULL) parent->childIndex++;
+
+	if (parent == NULL) {
+		if (!xmlStrEq(localname, "Envelope") || !xmlStrEq(uri, SOAP_NS_C)) {
+			failed = YES;
+			xmlStopParser(ctxt);
+			return;
+		}
+		[self push:fkEnvelope name:nil];
+		return;
+	}
+
+	// pull out the xsi:nil and xsi:type attributes, if present.
+	BOOL isNil = NO;
+	const xmlChar *xsiType = NULL;
+	int xsiTypeLen = 0;
+	for (int i = 0; i < nb; i++) {
+		const xmlChar **a = attrs + (i * 5);
+		if (!xmlStrEq(a[2], XSI_NS_C)) continue;
+		int vlen = (int)(a[4] - a[3]);
+		if (xmlStrEq(a[0], "nil"))
+			isNil = vlen == 4 && memcmp(a[3], "true", 4) == 0;
+		else if (xmlStrEq(a[0], "type")) {
+			xsiType = a[3];
+			xsiTypeLen = vlen;
+		}
+	}
+
+	switch (parent->kind) {
+		case fkEnvelope:
+			if (xmlStrEq(localname, "Body") && xmlStrEq(uri, SOAP_NS_C)) {
+				sawBody = YES;
+				[self push:fkBody name:nil];
+			} else
+				[self push:fkIgnore name:nil];
+			break;
+		case fkBody:
+			if (xmlStrEq(localname, "Fault") && xmlStrEq(uri, SOAP_NS_C))
+				[self push:fkFault name:nil];
+			else {
+				[self push:fkResponse name:nil];
+				if (resultType == zkStreamResultSObjects && result == nil)
+					result = [[NSMutableArray alloc] init];
+			}
+			break;
+		case fkFault:
+			if (xmlStrEq(localname, "faultcode") || xmlStrEq(localname, "faultstring"))
+				[self push:fkValue name:[self nameFor:localname]];
+			else
+				[self push:fkIgnore name:nil];
+			break;
+		case fkResponse:
+			if (!xmlStrEq(localname, "result") || isNil)
+				[self push:fkIgnore name:nil];
+			else if (resultType == zkStreamResultQueryResult)
+				[self push:fkQueryResult name:nil]->records = [[NSMutableArray alloc] init];
+			else
+				[self push:fkSObject name:nil]->sobject = [[ZKSObject alloc] initWithType:nil];
+			break;
+		case fkQueryResult:
+			if (xmlStrEq(localname, "records")) {
+				if (isNil)
+					[self push:fkIgnore name:nil];
+				else
+					[self push:fkSObject name:nil]->sobject = [[ZKSObject alloc] initWithType:nil];
+			} else if (xmlStrEq(localname, "done") || xmlStrEq(localname, "size") || xmlStrEq(localname, "queryLocator"))
+				[self push:fkValue name:[self nameFor:localname]];
+			else
+				[self push:fkIgnore name:nil];
+			break;
+		case fkSObject: {
+			NSString *name = [self nameFor:localname];
+			if (isNil)
+				[self push:fkValue name:name]->isNil = YES;
+			else if (xsiType != NULL && xmlStrHasSuffix(xsiType, xsiTypeLen, "QueryResult"))
+				[self push:fkQueryResult name:name]->records = [[NSMutableArray alloc] init];
+			else if (xsiType != NULL && xmlStrHasSuffix(xsiType, xsiTypeLen, "sObject"))
+				[self push:fkSObject name:name]->sobject = [[ZKSObject alloc] initWithType:nil];
+			else
+				[self push:fkValue name:name];
+			break;
+		}
+		default:
+			[self push:fkIgnore name:nil];
+			break;
+	}
+}
+
+- (void)characters:(const xmlChar *)ch length:(int)len {
+	if (depth > 0 && ((zkStreamFrame *)frames)[depth - 1].kind == fkValue)
+		[text appendBytes:ch length:len];
+}
+
+// returns a +1 value for the frame that just closed.
+- (id)valueForFrame:(zkStreamFrame *)f {
+	switch (f->kind) {
+		case fkValue:
+			if (f->isNil) return [[NSNull null] retain];
+			if ([text length] == 0) return nil;
+			return [[NSString alloc] initWithBytes:[text bytes] length:[text length] encoding:NSUTF8StringEncoding];
+		case fkSObject:
+			return [f->sobject retain];
+		case fkQueryResult:
+			return [[ZKQueryResult alloc] initWithRecords:f->records size:f->size done:f->done queryLocator:(f->done ? nil : f->queryLocator)];
+		default:
+			return nil;
+	}
+}
+
+- (void)endElement {
+	if (failed || depth == 0) return;
+	zkStreamFrame *f = (zkStreamFrame *)frames + depth - 1;
+	zkStreamFrame *parent = depth > 1 ? f - 1 : NULL;
+	id value = [self valueForFrame:f];
+	NSString *name = f->name;
+
+	if (parent != NULL && f->kind != fkIgnore) {
+		switch (parent->kind) {
+			case fkFault:
+				if ([name isEqualToString:@"faultcode"]) {
+					[faultCode release];
+					faultCode = [value retain];
+				} else {
+					[faultString release];
+					faultString = [value retain];
+				}
+				break;
+			case fkResponse:
+				if (resultType == zkStreamResultQueryResult) {
+					[result release];
+					result = [value retain];
+				} else if ([value id] != nil)
+					[result addObject:value];
+				break;
+			case fkQueryResult:
+				if (f->kind == fkSObject)
+					[parent->records addObject:value];
+				else if ([name isEqualToString:@"done"])
+					parent->done = [value isEqualToString:@"true"];
+				else if ([name isEqualToString:@"size"])
+					parent->size = [value intValue];
+				else {
+					[parent->queryLocator release];
+					parent->queryLocator = [value retain];
+				}
+				break;
+			case fkSObject:
+				// same rules as -[ZKSObject initFromXmlNode:], first 2 are type & Id.
+				if (parent->childIndex <= 2) {
+					id v = value == [NSNull null] ? nil : value;
+					if ([name isEqualToString:@"Id"] && [parent->sobject id] == nil)
+						[parent->sobject setId:v];
+					else if ([name isEqualToString:@"type"])
+						[parent->sobject setType:v];
+				} else
+					[parent->sobject addParsedFieldValue:value field:name];
+				break;
+		}
+	}
+	[value release];
+	[self releaseFrame:f];
+	depth--;
+}
+
+@end
@@ -179,7 +179,7 @@ static const int DEFAULT_MAX_SESSION_AGE = 25 * 60; // 25 minutes
 	[env addElement:@"password" elemValue:password];
 	[env endElement:@"login"];
 	[env endElement:@"s:Body"];
-	NSString *xml = [env end];
+	NSData *xml = [env end];
 	[env release];
 	
 	zkElement *resp = [client sendRequest:xml];	
@@ -21,14 +21,59 @@
 
 
 @class zkElement;
+@class ZKStreamParser;
+@class ZKCancellationToken;
+
+typedef void (^ZKFailBlock)(NSException *e);
+typedef void (^ZKResponseBlock)(id result, zkElement *element);
 
 @interface ZKBaseClient : NSObject {
 	NSURL *endpointUrl;
+	BOOL streamingParse;
+	BOOL compressRequests;
+	BOOL compressResponses;
+	int64_t bytesSent, bytesSentUncompressed;
+	int64_t bytesReceived, bytesReceivedUncompressed;
 }
 
 @property (retain) NSURL *endpointUrl;
 
-- (zkElement *)sendRequest:(NSString *)payload;
-- (zkElement *)sendRequest:(NSString *)payload returnRoot:(BOOL)root;
+// Should responses that support it be parsed with ZKStreamParser rather than
+// a full DOM? (defaults true)
+@property (assign) BOOL streamingParse;
+
+// Should request envelopes be gzipped? (defaults true)
+@property (assign) BOOL compressRequests;
+
+// Should we ask for gzipped responses? (defaults true)
+@property (assign) BOOL compressResponses;
+
+// Running totals of bytes on the wire vs. the size of the XML they carried,
+// for all requests made by this client.
+@property (readonly) int64_t bytesSent;
+@property (readonly) int64_t bytesSentUncompressed;
+@property (readonly) int64_t bytesReceived;
+@property (readonly) int64_t bytesReceivedUncompressed;
+- (void)resetByteCounters;
+
+// These block the calling thread until the response has arrived. If the thread
+// has a current ZKCancellationToken and it gets cancelled, they throw a
+// ZKCancelledException instead.
+- (zkElement *)sendRequest:(NSData *)payload;
+- (zkElement *)sendRequest:(NSData *)payload returnRoot:(BOOL)root;
+
+// sends the request and feeds the response to the streaming parser, returning
+// the parsed result. If the streaming parser can't handle the response, or
+// streamingParse is off, returns nil and sets fallback to the element the DOM
+// based sendRequest: would of returned.
+- (id)sendRequest:(NSData *)payload streamingParser:(ZKStreamParser *)parser fallback:(zkElement **)fallback;
+
+// the async version of the above, this returns straight away, nothing waits on
+// the server. completeBlock gets either the streamed result, or the element to
+// fall back to, exceptions (soap faults, bad xml) go to failBlock instead. The
+// blocks are called on a private background queue, and not at all if token
+// gets cancelled first.
+- (void)sendRequest:(NSData *)payload streamingParser:(ZKStreamParser *)parser cancellationToken:(ZKCancellationToken *)token
+	  completeBlock:(ZKResponseBlock)completeBlock failBlock:(ZKFailBlock)failBlock;
 
 @end
@@ -22,37 +22,159 @@
 #import "zkBaseClient.h"
 #import "zkSoapException.h"
 #import "zkParser.h"
+#import "ZKStreamParser.h"
+#import "ZKCancellationToken.h"
+#import "ZKAsyncRequest.h"
+#include <zlib.h>
+#include <libkern/OSAtomic.h>
 
 @implementation ZKBaseClient
 
 static NSString *SOAP_NS = @"http://schemas.xmlsoap.org/soap/envelope/";
 
-@synthesize endpointUrl;
+@synthesize endpointUrl, streamingParse, compressRequests, compressResponses;
+@synthesize bytesSent, bytesSentUncompressed, bytesReceived, bytesReceivedUncompressed;
+
+// windowBits of 15 + 16 asks zlib for a gzip wrapper, 15 + 32 auto detects gzip or zlib
+static const int GZIP_WINDOW_BITS = 15 + 16;
+static const int INFLATE_WINDOW_BITS = 15 + 32;
+
+// below this, the gzip header costs more than it saves
+static const NSUInteger MIN_GZIP_REQUEST_SIZE = 1024;
+
+static NSData *gzipData(NSData *data) {
+	z_stream strm;
+	memset(&strm, 0, sizeof(strm));
+	if (deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, GZIP_WINDOW_BITS, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+		return nil;
+	NSMutableData *out = [NSMutableData dataWithLength:deflateBound(&strm, [data length])];
+	strm.next_in = (Bytef *)[data bytes];
+	strm.avail_in = (uInt)[data length];
+	strm.next_out = [out mutableBytes];
+	strm.avail_out = (uInt)[out length];
+	int ret = deflate(&strm, Z_FINISH);
+	[out setLength:strm.total_out];
+	deflateEnd(&strm);
+	return ret == Z_STREAM_END ? out : nil;
+}
+
+static NSData *gunzipData(NSData *data) {
+	z_stream strm;
+	memset(&strm, 0, sizeof(strm));
+	if (inflateInit2(&strm, INFLATE_WINDOW_BITS) != Z_OK)
+		return nil;
+	NSMutableData *out = [NSMutableData dataWithLength:[data length] * 4];
+	strm.next_in = (Bytef *)[data bytes];
+	strm.avail_in = (uInt)[data length];
+	int ret = Z_OK;
+	while (ret == Z_OK) {
+		if (strm.total_out >= [out length])
+			[out increaseLengthBy:[data length] * 2];
+		strm.next_out = (Bytef *)[out mutableBytes] + strm.total_out;
+		strm.avail_out = (uInt)([out length] - strm.total_out);
+		ret = inflate(&strm, Z_SYNC_FLUSH);
+	}
+	[out setLength:strm.total_out];
+	inflateEnd(&strm);
+	return ret == Z_STREAM_END ? out : nil;
+}
+
+static BOOL isGzipped(NSData *data) {
+	const unsigned char *b = [data bytes];
+	return [data length] > 2 && b[0] == 0x1f && b[1] == 0x8b;
+}
 
 - (void)dealloc {
 	[endpointUrl release];
 	[super dealloc];
 }
 
-- (zkElement *)sendRequest:(NSString *)payload {
+- (id)init {
+	self = [super init];
+	streamingParse = YES;
+	compressRequests = YES;
+	compressResponses = YES;
+	return self;
+}
+
+- (void)resetByteCounters {
+	bytesSent = bytesSentUncompressed = bytesReceived = bytesReceivedUncompressed = 0;
+}
+
+- (zkElement *)sendRequest:(NSData *)payload {
 	return [self sendRequest:payload returnRoot:NO];
 }
 
-- (zkElement *)sendRequest:(NSString *)payload returnRoot:(BOOL)returnRoot {
+- (NSURLRequest *)urlRequestForPayload:(NSData *)payload {
 	NSMutableURLRequest *request = [NSMutableURLRequest requestWithURL:endpointUrl];
 	[request setHTTPMethod:@"POST"];
 	[request addValue:@"text/xml; charset=UTF-8" forHTTPHeaderField:@"content-type"];	
 	[request addValue:@"\"\"" forHTTPHeaderField:@"SOAPAction"];
 	
-	NSData *data = [payload dataUsingEncoding:NSUTF8StringEncoding];
-	[request setHTTPBody:data];
-	
-	NSHTTPURLResponse *resp = nil;
-	NSError *err = nil;
-	// todo, support request compression
-	// todo, support response compression
-	NSData *respPayload = [NSURLConnection sendSynchronousRequest:request returningResponse:&resp error:&err];
+	// ZKEnvelope already gives us UTF-8 bytes, so there's no re-encoding to do here.
+	NSData *data = payload;
+	NSData *body = (compressRequests && [data length] > MIN_GZIP_REQUEST_SIZE) ? gzipData(data) : nil;
+	if (body != nil)
+		[request addValue:@"gzip" forHTTPHeaderField:@"Content-Encoding"];
+	else
+		body = data;
+	[request setHTTPBody:body];
+	if (compressResponses)
+		[request setValue:@"gzip" forHTTPHeaderField:@"Accept-Encoding"];
+	else
+		[request setValue:@"identity" forHTTPHeaderField:@"Accept-Encoding"];
+	OSAtomicAdd64([body length], &bytesSent);
+	OSAtomicAdd64([data length], &bytesSentUncompressed);
+	return request;
+}
+
+- (NSData *)inflatedResponse:(NSData *)respPayload response:(NSHTTPURLResponse *)resp {
 	//NSLog(@"response \r\n%@", [NSString stringWithCString:[respPayload bytes] length:[respPayload length]]);
+	// NSURLConnection normally inflates gzip responses for us, in which case the
+	// Content-Length header is the only record of how much came over the wire.
+	int64_t wireLength = [respPayload length];
+	if (isGzipped(respPayload)) {
+		NSData *inflated = gunzipData(respPayload);
+		if (inflated != nil)
+			respPayload = inflated;
+	} else if ([[[resp allHeaderFields] objectForKey:@"Content-Encoding"] isEqualToString:@"gzip"]) {
+		long long contentLength = [resp expectedContentLength];
+		if (contentLength > 0)
+			wireLength = contentLength;
+	}
+	OSAtomicAdd64(wireLength, &bytesReceived);
+	OSAtomicAdd64([respPayload length], &bytesReceivedUncompressed);
+	return respPayload;
+}
+
+// The blocking version runs on the same async transport, and just waits for it
+// to finish, which means the thread's current cancellation token can abort it.
+- (NSData *)postRequest:(NSData *)payload response:(NSHTTPURLResponse **)resp {
+	ZKCancellationToken *token = [ZKCancellationToken currentToken];
+	dispatch_semaphore_t done = dispatch_semaphore_create(0);
+	__block NSData *respPayload = nil;
+	__block NSHTTPURLResponse *response = nil;
+	ZKAsyncRequest *request = [[ZKAsyncRequest alloc] initWithRequest:[self urlRequestForPayload:payload]
+													cancellationToken:token
+															dataBlock:nil
+														completeBlock:^(NSData *b, NSHTTPURLResponse *r, NSError *err) {
+		respPayload = [b retain];
+		response = [r retain];
+		dispatch_semaphore_signal(done);
+	}];
+	[request start];
+	[request release];
+	dispatch_semaphore_wait(done, DISPATCH_TIME_FOREVER);
+	dispatch_release(done);
+	[respPayload autorelease];
+	[response autorelease];
+	if ([token isCancelled])
+		@throw [NSException exceptionWithName:ZKCancelledException reason:@"The request was cancelled" userInfo:nil];
+	*resp = response;
+	return [self inflatedResponse:respPayload response:response];
+}
+
+- (zkElement *)elementFromResponse:(NSData *)respPayload response:(NSHTTPURLResponse *)resp returnRoot:(BOOL)returnRoot {
 	zkElement *root = [zkParser parseData:respPayload];
 	if (root == nil)	
 		@throw [NSException exceptionWithName:@"Xml error" reason:@"Unable to parse XML returned by server" userInfo:nil];
@@ -72,4 +194,78 @@ static NSString *SOAP_NS = @"http://schemas.xmlsoap.org/soap/envelope/";
 	return returnRoot ? root : [[body childElements] objectAtIndex:0];
 }
 
+- (zkElement *)sendRequest:(NSData *)payload returnRoot:(BOOL)returnRoot {
+	NSHTTPURLResponse *resp = nil;
+	NSData *respPayload = [self postRequest:payload response:&resp];
+	return [self elementFromResponse:respPayload response:resp returnRoot:returnRoot];
+}
+
+- (id)sendRequest:(NSData *)payload streamingParser:(ZKStreamParser *)parser fallback:(zkElement **)fallback {
+	NSHTTPURLResponse *resp = nil;
+	NSData *respPayload = [self postRequest:payload response:&resp];
+	if (streamingParse) {
+		[parser parseData:respPayload];
+		if ([parser finish]) {
+			if ([parser faultCode] != nil)
+				@throw [ZKSoapException exceptionWithFaultCode:[parser faultCode] faultString:[parser faultString]];
+			return [parser result];
+		}
+	}
+	// streaming parser couldn't deal with it, the DOM path will either work, or throw the right error.
+	*fallback = [self elementFromResponse:respPayload response:resp returnRoot:NO];
+	return nil;
+}
+
+- (void)sendRequest:(NSData *)payload streamingParser:(ZKStreamParser *)parser cancellationToken:(ZKCancellationToken *)token
+	  completeBlock:(ZKResponseBlock)completeBlock failBlock:(ZKFailBlock)failBlock {
+	// chunks are parsed in order on this queue as they arrive, so neither the network
+	// thread nor a GCD worker is held up while we wait on the server.
+	dispatch_queue_t queue = dispatch_queue_create("com.pocketsoap.zksforce.response", NULL);
+	BOOL streaming = streamingParse && parser != nil;
+	__block BOOL sawData = NO, deferred = NO;
+	
+	ZKAsyncRequestDataBlock dataBlock = ^(NSData *chunk) {
+		dispatch_async(queue, ^{
+			// if NSURLConnection didn't inflate this for us, we can only parse it once its all here.
+			if (!sawData && isGzipped(chunk))
+				deferred = YES;
+			sawData = YES;
+			if (!deferred)
+				[parser parseData:chunk];
+		});
+	};
+	ZKAsyncRequestCompleteBlock done = ^(NSData *body, NSHTTPURLResponse *resp, NSError *err) {
+		dispatch_async(queue, ^{
+			if ([token isCancelled]) return;
+			id result = nil;
+			zkElement *element = nil;
+			@try {
+				NSData *respPayload = [self inflatedResponse:body response:resp];
+				if (streaming && deferred)
+					[parser parseData:respPayload];
+				if (streaming && [parser finish]) {
+					if ([parser faultCode] != nil)
+						@throw [ZKSoapException exceptionWithFaultCode:[parser faultCode] faultString:[parser faultString]];
+					result = [parser result];
+				} else {
+					element = [self elementFromResponse:respPayload response:resp returnRoot:NO];
+				}
+				// the completion parses the result, so a malformed response fails here, the same as it would synchronously.
+				if (completeBlock != nil)
+					completeBlock(result, element);
+			} @catch (NSException *ex) {
+				if (failBlock != nil)
+					failBlock(ex);
+			}
+		});
+		dispatch_release(queue);
+	};
+	ZKAsyncRequest *request = [[ZKAsyncRequest alloc] initWithRequest:[self urlRequestForPayload:payload]
+													cancellationToken:token
+															dataBlock:streaming ? dataBlock : nil
+														completeBlock:done];
+	[request start];
+	[request release];
+}
+
 @end
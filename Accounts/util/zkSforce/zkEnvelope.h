@@ -22,8 +22,12 @@
 
 #import "zkSObject.h"
 
+// Builds a SOAP envelope directly into a growable UTF-8 byte buffer, call end
+// to get the finished bytes as NSData. Once end has been called the envelope
+// can't be written to again.
 @interface ZKEnvelope : NSObject {
-	NSMutableString 	*env;
+	char				*buf;
+	NSUInteger			len, cap;
 	int					state;
 }
 
@@ -31,13 +35,15 @@
 - (void)writeSessionHeader:(NSString *)sessionId;
 - (void)writeCallOptionsHeader:(NSString *)callOptions;
 - (void)writeMruHeader:(BOOL)updateMru;
+// batchSize of 0 leaves the page size up to the server.
+- (void)writeQueryOptionsHeader:(int)batchSize;
 
 - (void) moveToBody;
 - (void) startElement:(NSString *)elemName;
 - (void) endElement:(NSString *)elemName;
 - (void) writeText:(NSString *)text;
 - (void) addElement:(NSString *)elemName elemValue:(id)elemValue;
-- (NSString *)end;
+- (NSData *)end;
 
 - (void) addElementArray:(NSString *)elemName   elemValue:(NSArray *)elemValues;
 - (void) addElementSObject:(NSString *)elemName elemValue:(ZKSObject *)sobject;
@@ -30,9 +30,57 @@ enum envState {
 	inBody = 3
 };
 
+static const NSUInteger INITIAL_CAPACITY = 4096;
+
+- (void)dealloc {
+	free(buf);
+	[super dealloc];
+}
+
+- (void)ensureCapacity:(NSUInteger)extra {
+	if (len + extra <= cap) return;
+	NSUInteger newCap = cap > 0 ? cap : INITIAL_CAPACITY;
+	while (newCap < len + extra)
+		newCap *= 2;
+	buf = reallocf(buf, newCap);
+	if (buf == NULL)
+		@throw [NSException exceptionWithName:NSMallocException reason:@"Unable to grow envelope buffer" userInfo:nil];
+	cap = newCap;
+}
+
+- (void)appendBytes:(const char *)bytes length:(NSUInteger)n {
+	[self ensureCapacity:n];
+	memcpy(buf + len, bytes, n);
+	len += n;
+}
+
+// copies the UTF-8 bytes of s onto the end of the buffer, but doesn't include
+// them in len yet, returns how many bytes were written. nil writes nothing.
+- (NSUInteger)stageString:(NSString *)s {
+	if (![s isKindOfClass:[NSString class]]) return 0;
+	const char *fast = CFStringGetCStringPtr((CFStringRef)s, kCFStringEncodingUTF8);
+	if (fast != NULL) {
+		size_t n = strlen(fast);
+		[self ensureCapacity:n];
+		memcpy(buf + len, fast, n);
+		return n;
+	}
+	NSUInteger max = [s maximumLengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+	NSUInteger used = 0;
+	[self ensureCapacity:max];
+	[s getBytes:buf + len maxLength:max usedLength:&used encoding:NSUTF8StringEncoding options:0 range:NSMakeRange(0, [s length]) remainingRange:NULL];
+	return used;
+}
+
+- (void)appendString:(NSString *)s {
+	len += [self stageString:s];
+}
+
 - (void)start:(NSString *)primaryNamespceUri {
-	[env release];
-	env = [NSMutableString stringWithFormat:@"<s:Envelope xmlns:s='http://schemas.xmlsoap.org/soap/envelope/' xmlns='%@'>", primaryNamespceUri];
+	len = 0;
+	[self appendString:@"<s:Envelope xmlns:s='http://schemas.xmlsoap.org/soap/envelope/' xmlns='"];
+	[self appendString:primaryNamespceUri];
+	[self appendBytes:"'>" length:2];
 	state = inEnvelope;
 }
 
@@ -68,6 +116,14 @@ enum envState {
 	[self endElement:@"MruHeader"];
 }
 
+- (void)writeQueryOptionsHeader:(int)batchSize {
+	if (batchSize <= 0) return;
+	[self moveToHeaders];
+	[self startElement:@"QueryOptions"];
+	[self addElement:@"batchSize" elemValue:[NSNumber numberWithInt:batchSize]];
+	[self endElement:@"QueryOptions"];
+}
+
 - (void) moveToBody {
 	if (state == inHeaders)
 		[self endElement:@"s:Header"];
@@ -110,32 +166,55 @@ enum envState {
 }
 
 - (void) writeText:(NSString *)text  {
-	unichar c;
-	NSUInteger i, len = [text length];
-	for (i = 0; i < len; i++)
-	{
-		c = [text characterAtIndex:i];
-		switch (c)
-		{
-			case '<' : [env appendString:@"&lt;"]; break;
-			case '>' : [env appendString:@"&gt;"]; break;
-			case '&' : [env appendString:@"&amp;"]; break;
-			default  : [env appendFormat:@"%C", c];
+	NSUInteger n = [self stageString:text];
+	// most values don't need escaping at all, in which case we're done.
+	NSUInteger extra = 0;
+	const char *p, *stop = buf + len + n;
+	for (p = buf + len; p < stop; p++) {
+		if (*p == '<' || *p == '>') extra += 3;
+		else if (*p == '&') extra += 4;
+	}
+	if (extra > 0) {
+		[self ensureCapacity:n + extra];
+		// expand in place, working back from the end, so each run of plain text
+		// is moved in one go, and nothing's overwritten before it's been moved.
+		char *start = buf + len, *src = start + n, *dst = src + extra;
+		while (src > start) {
+			char *runEnd = src;
+			while (src > start && src[-1] != '<' && src[-1] != '>' && src[-1] != '&')
+				src--;
+			dst -= runEnd - src;
+			memmove(dst, src, runEnd - src);
+			if (src == start) break;
+			char c = *--src;
+			const char *entity = c == '<' ? "&lt;" : (c == '>' ? "&gt;" : "&amp;");
+			size_t el = strlen(entity);
+			dst -= el;
+			memcpy(dst, entity, el);
 		}
 	}
+	len += n + extra;
 }
 
 - (void )startElement:(NSString *)elemName {
-	[env appendFormat:@"<%@>", elemName];
+	[self appendBytes:"<" length:1];
+	[self appendString:elemName];
+	[self appendBytes:">" length:1];
 }
 
 - (void )endElement:(NSString *)elemName {
-	[env appendFormat:@"</%@>", elemName];
+	[self appendBytes:"</" length:2];
+	[self appendString:elemName];
+	[self appendBytes:">" length:1];
 }
 
-- (NSString *)end {
-	[env appendString:@"</s:Envelope>"];
-	return env;
+- (NSData *)end {
+	[self appendBytes:"</s:Envelope>" length:13];
+	// the buffer now belongs to the NSData, so there's no copy.
+	NSData *d = [NSData dataWithBytesNoCopy:buf length:len freeWhenDone:YES];
+	buf = NULL;
+	len = cap = 0;
+	return d;
 }
 
 @end
@@ -22,7 +22,9 @@
 #include <libxml/parser.h>
 
 
-@interface zkElement : NSObject <NSCopying> {
+// zkElement archives as the XML of the element and its children, so things built
+// on it, e.g. describe results, can be saved to disk.
+@interface zkElement : NSObject <NSCopying, NSCoding> {
 	xmlDocPtr	doc;
 	xmlNodePtr	node;
 	zkElement	*parent;
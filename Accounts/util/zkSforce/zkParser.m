@@ -43,6 +43,29 @@
 	return [[zkElement allocWithZone:z] initWithDocument:doc node:node parent:parent == nil ? self : parent];
 }
 
+- (void)encodeWithCoder:(NSCoder *)coder {
+	// copy into a new document first, this pulls along any namespace declarations
+	// from our ancestors, so that the XML stands on its own.
+	xmlDocPtr d = xmlNewDoc((const xmlChar *)"1.0");
+	xmlDocSetRootElement(d, xmlDocCopyNode(node, d, 1));
+	xmlChar *mem = NULL;
+	int len = 0;
+	xmlDocDumpMemory(d, &mem, &len);
+	[coder encodeObject:[NSData dataWithBytes:mem length:len] forKey:@"xml"];
+	xmlFree(mem);
+	xmlFreeDoc(d);
+}
+
+- (id)initWithCoder:(NSCoder *)coder {
+	NSData *xml = [coder decodeObjectForKey:@"xml"];
+	xmlDocPtr d = xmlReadMemory([xml bytes], (int)[xml length], "noname.xml", NULL, 0);
+	if (d == NULL) {
+		[self release];
+		return nil;
+	}
+	return [self initWithDocument:d];
+}
+
 -(void)dealloc {
 	[parent release];
 	xmlFreeDoc(doc);
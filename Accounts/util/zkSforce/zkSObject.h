@@ -51,6 +51,9 @@ NSString * NS_URI_XSI;
 - (void)setFieldDateValue:(NSDate *)value field:(NSString *)field;
 - (void)setFieldToNull:(NSString *)field;
 
+// used by the response parsers, adds the field as is, value can be nil or NSNull
+- (void)addParsedFieldValue:(id)value field:(NSString *)field;
+
 // basic getters
 - (NSString *)id;
 - (NSString *)type;
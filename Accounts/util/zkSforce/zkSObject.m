@@ -23,20 +23,12 @@
 #import "zkSObject.h"
 #import "zkQueryResult.h"
 #import "zkParser.h"
+#import "ZKDateTime.h"
 
 NSString * NS_URI_XSI = @"http://www.w3.org/2001/XMLSchema-instance";
 
-static NSDateFormatter *dateFormatter, *dateTimeFormatter;
-
 @implementation ZKSObject
 
-+(void)initialize {
-	dateTimeFormatter = [[NSDateFormatter alloc] init];
-	[dateTimeFormatter setDateFormat:@"yyyy-MM-dd'T'HH:mm:ss.SSSSZ"];
-	dateFormatter = [[NSDateFormatter alloc] init];
-	[dateFormatter setDateFormat:@"yyyy-MM-dd"];
-}
-
 + (id)withType:(NSString *)type {
 	return [[[ZKSObject alloc] initWithType:type] autorelease];
 }
@@ -151,16 +143,18 @@ static NSDateFormatter *dateFormatter, *dateTimeFormatter;
 	}
 }
 
+- (void)addParsedFieldValue:(id)value field:(NSString *)field {
+	[fields setValue:value forKey:field];
+	[fieldOrder addObject:field];
+}
+
 - (void)setFieldDateTimeValue:(NSDate *)value field:(NSString *)field {
-	NSMutableString *dt = [NSMutableString stringWithString:[dateTimeFormatter stringFromDate:value]];
-	// meh, insert the : in the TZ offset, to make it xsd:dateTime
-	[dt insertString:@":" atIndex:[dt length]-2];
-	[self setFieldValue:dt field:field];
+	[self setFieldValue:(value == nil ? nil : ZKStringFromDateTime([value timeIntervalSince1970], YES)) field:field];
 }
 
 - (void)setFieldDateValue:(NSDate *)value field:(NSString *)field {
-	[self setFieldValue:[dateFormatter stringFromDate:value] field:field];	
-}	
+	[self setFieldValue:(value == nil ? nil : ZKStringFromDateTime([value timeIntervalSince1970], NO)) field:field];
+}
 
 - (id)fieldValue:(NSString *)field {
 	id v = [fields objectForKey:field];
@@ -176,16 +170,13 @@ static NSDateFormatter *dateFormatter, *dateTimeFormatter;
 }
 
 - (NSDate *)dateTimeValue:(NSString *)field {
-	// ok, so a little hackish, but does the job
-	// note to self, make sure API always returns GMT times ;)
-	NSMutableString *dt = [NSMutableString stringWithString:[self fieldValue:field]];
-	[dt deleteCharactersInRange:NSMakeRange([dt length] -1,1)];
-	[dt appendString:@"+00"];
-	return [dateTimeFormatter dateFromString:dt];
+	NSTimeInterval seconds;
+	if (!ZKParseDateTime([self fieldValue:field], &seconds, NULL)) return nil;
+	return [NSDate dateWithTimeIntervalSince1970:seconds];
 }
 
 - (NSDate *)dateValue:(NSString *)field {
-	return [dateFormatter dateFromString:[self fieldValue:field]];
+	return [self dateTimeValue:field];
 }
 
 - (int)intValue:(NSString *)field {
@@ -28,8 +28,13 @@
 #import "zkUserInfo.h"
 #import "zkSObject.h"
 #import "zkSoapException.h"
+#import "ZKCancellationToken.h"
 #import "zkSaveResult.h"
+#import "ZKSaveBatchFailure.h"
 #import "zkQueryResult.h"
+#import "ZKQueryCursor.h"
+#import "ZKQueryBatchSizePolicy.h"
+#import "ZKDateTime.h"
 #import "zkDescribeSObject.h"
 #import "zkDescribeField.h"
 #import "ZKDescribeLayout.h"
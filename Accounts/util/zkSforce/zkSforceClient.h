@@ -28,6 +28,13 @@
 @class ZKQueryResult;
 @class ZKLoginResult;
 @class ZKDescribeLayoutResult;
+@class ZKCancellationToken;
+@class ZKQueryBatchSizePolicy;
+
+// results is a ZKSaveResult per input record, in the same order, batchFailures is an
+// array of ZKSaveBatchFailure for any batches that failed outright, their records
+// have an NSNull in results.
+typedef void (^ZKSaveCompleteBlock)(NSArray *results, NSArray *batchFailures);
 
 // This is the primary entry point into the library, you'd create one of these
 // call login, then use it to make other API calls. Your session is automatically
@@ -41,6 +48,9 @@
 	BOOL		cacheDescribes;
 	NSMutableDictionary	*describes;
 	int			preferedApiVersion;
+	NSUInteger	saveBatchSize;
+	NSUInteger	maxConcurrentSaveBatches;
+	ZKQueryBatchSizePolicy *queryBatchSizePolicy;
     
     NSObject<ZKAuthenticationInfo>  *authSource;
 }
@@ -128,6 +138,16 @@
 // values are ZKSObject's.
 - (NSDictionary *)retrieve:(NSString *)fields sobject:(NSString *)sobjectType ids:(NSArray *)ids;
 
+// Async versions of query, queryAll, queryMore and retrieve. These return straight
+// away and don't tie up a thread while waiting on the server, completeBlock or
+// failBlock is called on a background queue once the response is in. Neither is
+// called if the token is cancelled before then. 
+- (void)query:(NSString *)soql cancellationToken:(ZKCancellationToken *)token completeBlock:(void (^)(ZKQueryResult *result))completeBlock failBlock:(ZKFailBlock)failBlock;
+- (void)queryAll:(NSString *)soql cancellationToken:(ZKCancellationToken *)token completeBlock:(void (^)(ZKQueryResult *result))completeBlock failBlock:(ZKFailBlock)failBlock;
+- (void)queryMore:(NSString *)queryLocator cancellationToken:(ZKCancellationToken *)token completeBlock:(void (^)(ZKQueryResult *result))completeBlock failBlock:(ZKFailBlock)failBlock;
+- (void)retrieve:(NSString *)fields sobject:(NSString *)sobjectType ids:(NSArray *)ids cancellationToken:(ZKCancellationToken *)token
+   completeBlock:(void (^)(NSDictionary *results))completeBlock failBlock:(ZKFailBlock)failBlock;
+
 // pass an array of ZKSObject's to create in salesforce, returns a matching array of ZKSaveResults
 - (NSArray *)create:(NSArray *)objects;
 
@@ -137,6 +157,20 @@
 // pass an array of record Ids to delete from salesforce. returns a matching array of ZKSaveREsults
 - (NSArray *)delete:(NSArray *)ids;
 
+// creates, updates and deletes are split into batches of saveBatchSize records, and
+// up to maxConcurrentSaveBatches of those are sent at once. The plain versions above
+// throw if any batch fails outright, these instead return NSNull for the records in
+// that batch, and set batchFailures to an array of ZKSaveBatchFailure.
+- (NSArray *)create:(NSArray *)objects batchFailures:(NSArray **)batchFailures;
+- (NSArray *)update:(NSArray *)objects batchFailures:(NSArray **)batchFailures;
+- (NSArray *)delete:(NSArray *)ids batchFailures:(NSArray **)batchFailures;
+
+// Async versions, completeBlock is called on a background queue once every batch is
+// done, and not at all if the token is cancelled first.
+- (void)create:(NSArray *)objects cancellationToken:(ZKCancellationToken *)token completeBlock:(ZKSaveCompleteBlock)completeBlock;
+- (void)update:(NSArray *)objects cancellationToken:(ZKCancellationToken *)token completeBlock:(ZKSaveCompleteBlock)completeBlock;
+- (void)delete:(NSArray *)ids cancellationToken:(ZKCancellationToken *)token completeBlock:(ZKSaveCompleteBlock)completeBlock;
+
 // the current server timestamp, as a string (ISO8601 format)
 - (NSString *)serverTimestamp;
 
@@ -170,6 +204,18 @@
 // If you have a clientIf for a certifed partner application, you can set it here.
 @property (retain) NSString *clientId;
 
+// Picks the QueryOptions batchSize for query, queryAll and queryMore calls based on
+// how many fields are being selected. Set to nil to leave it up to the server.
+@property (retain) ZKQueryBatchSizePolicy *queryBatchSizePolicy;
+
+// DML batching
+//////////////////////////////////////////////////////////////////////////////////////
+// How many records go in each create / update / delete call (1 - 200, defaults to 200)
+@property (assign) NSUInteger saveBatchSize;
+
+// How many of those calls can be in flight at once (defaults to 4)
+@property (assign) NSUInteger maxConcurrentSaveBatches;
+
 
 // describe caching
 //////////////////////////////////////////////////////////////////////////////////////
@@ -24,6 +24,8 @@
 #import "zkPartnerEnvelope.h"
 #import "zkQueryResult.h"
 #import "zkSaveResult.h"
+#import "ZKSaveBatchFailure.h"
+#import "ZKQueryBatchSizePolicy.h"
 #import "zkSObject.h"
 #import "zkSoapException.h"
 #import "zkUserInfo.h"
@@ -31,21 +33,156 @@
 #import "zkLoginResult.h"
 #import "zkDescribeGlobalSObject.h"
 #import "zkParser.h"
+#import "ZKStreamParser.h"
+#import "ZKCancellationToken.h"
 #import "ZKDescribeLayoutResult.h"
 #import "ZKDescribeTabSetResult.h"
 
-static const int SAVE_BATCH_SIZE = 25;
+// the API won't take more than this many records in one create / update / delete call.
+static const NSUInteger MAX_SAVE_BATCH_SIZE = 200;
+static const NSUInteger DEFAULT_SAVE_CONCURRENCY = 4;
 
 @interface ZKSforceClient (Private)
 - (ZKQueryResult *)queryImpl:(NSString *)value operation:(NSString *)op name:(NSString *)elemName;
-- (NSArray *)sobjectsImpl:(NSArray *)objects name:(NSString *)elemName;
+- (void)queryImpl:(NSString *)value operation:(NSString *)op name:(NSString *)elemName cancellationToken:(ZKCancellationToken *)token
+	completeBlock:(void (^)(ZKQueryResult *result))completeBlock failBlock:(ZKFailBlock)failBlock;
+- (NSArray *)saveImpl:(NSArray *)items operation:(NSString *)op itemName:(NSString *)itemName batchFailures:(NSArray **)batchFailures;
+- (void)saveImpl:(NSArray *)items operation:(NSString *)op itemName:(NSString *)itemName cancellationToken:(ZKCancellationToken *)token completeBlock:(ZKSaveCompleteBlock)completeBlock;
+- (NSData *)saveEnvelope:(NSArray *)items operation:(NSString *)op itemName:(NSString *)itemName;
+- (NSArray *)saveResultsFromElement:(zkElement *)cr;
 - (void)checkSession;
 @property (retain, getter=currentUserInfo) ZKUserInfo *userInfo;
 @end
 
+// Splits a create / update / delete into batches and keeps up to maxInFlight of them
+// going at once, putting the results back together in the order of the input. All
+// the bookkeeping happens on one serial queue shared by every save.
+@interface ZKSaveOperation : NSObject {
+	ZKSforceClient		*client;
+	NSArray				*items;
+	NSString			*operation, *itemName;
+	ZKCancellationToken	*token;
+	id					cancelHandler;
+	ZKSaveCompleteBlock	completeBlock;
+	NSMutableArray		*results, *failures;
+	NSUInteger			batchSize, maxInFlight, next, inFlight;
+	BOOL				finished;
+}
+- (id)initWithClient:(ZKSforceClient *)c items:(NSArray *)i operation:(NSString *)op itemName:(NSString *)name
+   cancellationToken:(ZKCancellationToken *)t completeBlock:(ZKSaveCompleteBlock)cb;
+- (void)start;
+@end
+
+@implementation ZKSaveOperation
+
+static dispatch_queue_t saveQueue() {
+	static dispatch_queue_t queue;
+	static dispatch_once_t once;
+	dispatch_once(&once, ^{
+		queue = dispatch_queue_create("com.pocketsoap.zksforce.save", NULL);
+	});
+	return queue;
+}
+
+- (id)initWithClient:(ZKSforceClient *)c items:(NSArray *)i operation:(NSString *)op itemName:(NSString *)name
+   cancellationToken:(ZKCancellationToken *)t completeBlock:(ZKSaveCompleteBlock)cb {
+	self = [super init];
+	client = [c retain];
+	items = [i copy];
+	operation = [op copy];
+	itemName = [name copy];
+	token = [t retain];
+	completeBlock = [cb copy];
+	batchSize = [c saveBatchSize];
+	maxInFlight = MAX([c maxConcurrentSaveBatches], 1);
+	failures = [[NSMutableArray alloc] init];
+	results = [[NSMutableArray alloc] initWithCapacity:[items count]];
+	for (NSUInteger idx = 0; idx < [items count]; idx++)
+		[results addObject:[NSNull null]];
+	return self;
+}
+
+- (void)dealloc {
+	[client release];
+	[items release];
+	[operation release];
+	[itemName release];
+	[token release];
+	[cancelHandler release];
+	[completeBlock release];
+	[results release];
+	[failures release];
+	[super dealloc];
+}
+
+- (void)finish:(BOOL)notify {
+	if (finished) return;
+	finished = YES;
+	[token removeCancelHandler:cancelHandler];
+	[cancelHandler release];
+	cancelHandler = nil;
+	if (notify && ![token isCancelled])
+		completeBlock(results, failures);
+	// balances the retain in start
+	[self release];
+}
+
+- (void)batch:(NSRange)rng completedWithResults:(NSArray *)batch exception:(NSException *)ex {
+	inFlight--;
+	if (finished) return;
+	if (batch != nil) {
+		NSUInteger n = MIN([batch count], rng.length);
+		[results replaceObjectsInRange:NSMakeRange(rng.location, n) withObjectsFromArray:batch range:NSMakeRange(0, n)];
+	} else {
+		[failures addObject:[ZKSaveBatchFailure failureWithRange:rng exception:ex]];
+	}
+	[self pump];
+}
+
+- (void)pump {
+	while (!finished && inFlight < maxInFlight && next < [items count]) {
+		NSRange rng = NSMakeRange(next, MIN(batchSize, [items count] - next));
+		next += rng.length;
+		inFlight++;
+		NSData *payload = [client saveEnvelope:[items subarrayWithRange:rng] operation:operation itemName:itemName];
+		[client sendRequest:payload
+			streamingParser:nil
+		  cancellationToken:token
+			  completeBlock:^(id result, zkElement *cr) {
+				  NSArray *batch = [client saveResultsFromElement:cr];
+				  dispatch_async(saveQueue(), ^{
+					  [self batch:rng completedWithResults:batch exception:nil];
+				  });
+			  }
+				  failBlock:^(NSException *ex) {
+					  dispatch_async(saveQueue(), ^{
+						  [self batch:rng completedWithResults:nil exception:ex];
+					  });
+				  }];
+	}
+	if (inFlight == 0 && next >= [items count])
+		[self finish:YES];
+}
+
+- (void)start {
+	// we keep ourselves alive until we're finished or cancelled.
+	[self retain];
+	cancelHandler = [[token addCancelHandler:^{
+		dispatch_async(saveQueue(), ^{
+			[self finish:NO];
+		});
+	}] retain];
+	dispatch_async(saveQueue(), ^{
+		[self pump];
+	});
+}
+
+@end
+
 @implementation ZKSforceClient
 
 @synthesize preferedApiVersion, updateMru, clientId, cacheDescribes;
+@synthesize saveBatchSize, maxConcurrentSaveBatches, queryBatchSizePolicy;
 
 - (id)init {
 	self = [super init];
@@ -53,6 +190,9 @@ static const int SAVE_BATCH_SIZE = 25;
 	[self setLoginProtocolAndHost:@"https://www.salesforce.com"];
 	updateMru = NO;
 	cacheDescribes = NO;
+	saveBatchSize = MAX_SAVE_BATCH_SIZE;
+	maxConcurrentSaveBatches = DEFAULT_SAVE_CONCURRENCY;
+	queryBatchSizePolicy = [[ZKQueryBatchSizePolicy alloc] init];
 	return self;
 }
 
@@ -61,6 +201,7 @@ static const int SAVE_BATCH_SIZE = 25;
 	[clientId release];
 	[userInfo release];
 	[describes release];
+	[queryBatchSizePolicy release];
     [authSource release];
 	[super dealloc];
 }
@@ -76,6 +217,12 @@ static const int SAVE_BATCH_SIZE = 25;
     rhs->authSource = [authSource retain];
 	[rhs setCacheDescribes:cacheDescribes];
 	[rhs setUpdateMru:updateMru];
+	[rhs setStreamingParse:streamingParse];
+	[rhs setCompressRequests:compressRequests];
+	[rhs setCompressResponses:compressResponses];
+	[rhs setSaveBatchSize:saveBatchSize];
+	[rhs setMaxConcurrentSaveBatches:maxConcurrentSaveBatches];
+	[rhs setQueryBatchSizePolicy:queryBatchSizePolicy];
 	return rhs;
 }
 
@@ -321,52 +468,102 @@ static const int SAVE_BATCH_SIZE = 25;
 	return [self queryImpl:queryLocator operation:@"queryMore" name:@"queryLocator"];
 }
 
+- (void)setSaveBatchSize:(NSUInteger)size {
+	saveBatchSize = MAX(1, MIN(size, MAX_SAVE_BATCH_SIZE));
+}
+
 - (NSArray *)create:(NSArray *)objects {
-	return [self sobjectsImpl:objects name:@"create"];
+	return [self saveImpl:objects operation:@"create" itemName:@"sobject" batchFailures:NULL];
 }
 
 - (NSArray *)update:(NSArray *)objects {
-	return [self sobjectsImpl:objects name:@"update"];
+	return [self saveImpl:objects operation:@"update" itemName:@"sobject" batchFailures:NULL];
 }
 
-- (NSArray *)sobjectsImpl:(NSArray *)objects name:(NSString *)elemName {
-	if(!authSource) return NULL;
-	[self checkSession];
-	
-	// if more than we can do in one go, break it up.
-	if ([objects count] > SAVE_BATCH_SIZE) {
-		NSMutableArray *allResults = [NSMutableArray arrayWithCapacity:[objects count]];
-		NSRange rng = {0, MIN(SAVE_BATCH_SIZE, [objects count])};
-		while (rng.location < [objects count]) {
-			[allResults addObjectsFromArray:[self sobjectsImpl:[objects subarrayWithRange:rng] name:elemName]];
-			rng.location += rng.length;
-			rng.length = MIN(SAVE_BATCH_SIZE, [objects count] - rng.location);
-		}
-		return allResults;
-	}
+- (NSArray *)create:(NSArray *)objects batchFailures:(NSArray **)batchFailures {
+	return [self saveImpl:objects operation:@"create" itemName:@"sobject" batchFailures:batchFailures];
+}
+
+- (NSArray *)update:(NSArray *)objects batchFailures:(NSArray **)batchFailures {
+	return [self saveImpl:objects operation:@"update" itemName:@"sobject" batchFailures:batchFailures];
+}
+
+- (void)create:(NSArray *)objects cancellationToken:(ZKCancellationToken *)token completeBlock:(ZKSaveCompleteBlock)completeBlock {
+	[self saveImpl:objects operation:@"create" itemName:@"sobject" cancellationToken:token completeBlock:completeBlock];
+}
+
+- (void)update:(NSArray *)objects cancellationToken:(ZKCancellationToken *)token completeBlock:(ZKSaveCompleteBlock)completeBlock {
+	[self saveImpl:objects operation:@"update" itemName:@"sobject" cancellationToken:token completeBlock:completeBlock];
+}
+
+- (NSData *)saveEnvelope:(NSArray *)batch operation:(NSString *)op itemName:(NSString *)itemName {
 	ZKEnvelope *env = [[ZKPartnerEnvelope alloc] initWithSessionAndMruHeaders:[authSource sessionId] mru:updateMru clientId:clientId];
-	[env startElement:elemName];
-    for (ZKSObject *o in objects) 
-		[env addElement:@"sobject" elemValue:o];
-	[env endElement:elemName];
+	[env startElement:op];
+	[env addElement:itemName elemValue:batch];
+	[env endElement:op];
 	[env endElement:@"s:Body"];
+	NSData *payload = [env end];
+	[env release];
+	return payload;
+}
 
-	zkElement *cr = [self sendRequest:[env end]];
+- (NSArray *)saveResultsFromElement:(zkElement *)cr {
 	NSArray *resultsArr = [cr childElements:@"result"];
 	NSMutableArray *results = [NSMutableArray arrayWithCapacity:[resultsArr count]];
-	for (zkElement *cr in resultsArr) {
-		ZKSaveResult * sr = [[ZKSaveResult alloc] initWithXmlElement:cr];
+	for (zkElement *res in resultsArr) {
+		ZKSaveResult * sr = [[ZKSaveResult alloc] initWithXmlElement:res];
 		[results addObject:sr];
 		[sr release];
 	}
-	[env release];
 	return results;
 }
 
-- (NSDictionary *)retrieve:(NSString *)fields sobject:(NSString *)sobjectType ids:(NSArray *)ids {
-	if(!authSource) return NULL;
+- (void)saveImpl:(NSArray *)items operation:(NSString *)op itemName:(NSString *)itemName cancellationToken:(ZKCancellationToken *)token completeBlock:(ZKSaveCompleteBlock)completeBlock {
+	if(!authSource) {
+		completeBlock(nil, nil);
+		return;
+	}
 	[self checkSession];
 	
+	ZKSaveOperation *save = [[ZKSaveOperation alloc] initWithClient:self items:items operation:op itemName:itemName cancellationToken:token completeBlock:completeBlock];
+	[save start];
+	[save release];
+}
+
+// The blocking version just waits on the async one, it can still be cancelled via the thread's current token.
+- (NSArray *)saveImpl:(NSArray *)items operation:(NSString *)op itemName:(NSString *)itemName batchFailures:(NSArray **)batchFailures {
+	if(!authSource) return NULL;
+	
+	ZKCancellationToken *token = [ZKCancellationToken currentToken];
+	NSConditionLock *done = [[[NSConditionLock alloc] initWithCondition:0] autorelease];
+	__block NSArray *results = nil, *failures = nil;
+	
+	id cancelHandler = [token addCancelHandler:^{
+		[done lock];
+		[done unlockWithCondition:1];
+	}];
+	[self saveImpl:items operation:op itemName:itemName cancellationToken:token completeBlock:^(NSArray *r, NSArray *f) {
+		results = [r retain];
+		failures = [f retain];
+		[done lock];
+		[done unlockWithCondition:1];
+	}];
+	[done lockWhenCondition:1];
+	[done unlock];
+	[token removeCancelHandler:cancelHandler];
+	[results autorelease];
+	[failures autorelease];
+	
+	if ([token isCancelled])
+		@throw [NSException exceptionWithName:ZKCancelledException reason:@"The request was cancelled" userInfo:nil];
+	if (batchFailures != NULL)
+		*batchFailures = failures;
+	else if ([failures count] > 0)
+		@throw [[failures objectAtIndex:0] exception];
+	return results;
+}
+
+- (NSData *)retrieveEnvelope:(NSString *)fields sobject:(NSString *)sobjectType ids:(NSArray *)ids {
 	ZKEnvelope * env = [[ZKPartnerEnvelope alloc] initWithSessionHeader:[authSource sessionId] clientId:clientId];
 	[env startElement:@"retrieve"];
 	[env addElement:@"fieldList" elemValue:fields];
@@ -374,9 +571,19 @@ static const int SAVE_BATCH_SIZE = 25;
 	[env addElementArray:@"ids" elemValue:ids];
 	[env endElement:@"retrieve"];
 	[env endElement:@"s:Body"];
-	
-	zkElement *rr = [self sendRequest:[env end]];
-	NSMutableDictionary *sobjects = [NSMutableDictionary dictionary]; 
+	NSData *payload = [env end];
+	[env release];
+	return payload;
+}
+
+// builds the Id -> ZKSObject dictionary from either the streamed sobjects or the DOM.
+- (NSDictionary *)retrieveResults:(NSArray *)streamed element:(zkElement *)rr capacity:(NSUInteger)capacity {
+	NSMutableDictionary *sobjects = [NSMutableDictionary dictionaryWithCapacity:capacity]; 
+	if (streamed != nil) {
+		for (ZKSObject *o in streamed)
+			[sobjects setObject:o forKey:[o id]];
+		return sobjects;
+	}
 	NSArray *results = [rr childElements:@"result"];
 	for (zkElement *res in results) {
 		ZKSObject *o = [[ZKSObject alloc] initFromXmlNode:res];
@@ -389,46 +596,121 @@ static const int SAVE_BATCH_SIZE = 25;
 		[sobjects setObject:o forKey:[o id]];
 		[o release];
 	}
-	[env release];
 	return sobjects;
 }
 
-- (NSArray *)delete:(NSArray *)ids {
+- (NSDictionary *)retrieve:(NSString *)fields sobject:(NSString *)sobjectType ids:(NSArray *)ids {
 	if(!authSource) return NULL;
 	[self checkSession];
-
-	ZKEnvelope *env = [[ZKPartnerEnvelope alloc] initWithSessionAndMruHeaders:[authSource sessionId] mru:updateMru clientId:clientId];
-	[env startElement:@"delete"];
-	[env addElement:@"ids" elemValue:ids];
-	[env endElement:@"delete"];
-	[env endElement:@"s:Body"];
 	
-	zkElement *cr = [self sendRequest:[env end]];
-	NSArray *resArr = [cr childElements:@"result"];
-	NSMutableArray *results = [NSMutableArray arrayWithCapacity:[resArr count]];
-	for (zkElement *cr in resArr) {
-		ZKSaveResult *sr = [[ZKSaveResult alloc] initWithXmlElement:cr];
-		[results addObject:sr];
-		[sr release];
-	}
-	[env release];
-	return results;
+	zkElement *rr = nil;
+	ZKStreamParser *parser = [[[ZKStreamParser alloc] initWithResultType:zkStreamResultSObjects] autorelease];
+	NSArray *streamed = [self sendRequest:[self retrieveEnvelope:fields sobject:sobjectType ids:ids] streamingParser:parser fallback:&rr];
+	return [self retrieveResults:streamed element:rr capacity:[ids count]];
 }
 
-- (ZKQueryResult *)queryImpl:(NSString *)value operation:(NSString *)operation name:(NSString *)elemName {
-	if(!authSource) return NULL;
+- (void)retrieve:(NSString *)fields sobject:(NSString *)sobjectType ids:(NSArray *)ids cancellationToken:(ZKCancellationToken *)token
+   completeBlock:(void (^)(NSDictionary *results))completeBlock failBlock:(ZKFailBlock)failBlock {
+	if(!authSource) {
+		completeBlock(nil);
+		return;
+	}
 	[self checkSession];
+	
+	ZKStreamParser *parser = [[[ZKStreamParser alloc] initWithResultType:zkStreamResultSObjects] autorelease];
+	[self sendRequest:[self retrieveEnvelope:fields sobject:sobjectType ids:ids]
+	  streamingParser:parser
+	cancellationToken:token
+		completeBlock:^(id streamed, zkElement *rr) {
+			completeBlock([self retrieveResults:streamed element:rr capacity:[ids count]]);
+		}
+			failBlock:failBlock];
+}
 
-	ZKEnvelope *env = [[ZKPartnerEnvelope alloc] initWithSessionHeader:[authSource sessionId] clientId:clientId];
+- (NSArray *)delete:(NSArray *)ids {
+	return [self saveImpl:ids operation:@"delete" itemName:@"ids" batchFailures:NULL];
+}
+
+- (NSArray *)delete:(NSArray *)ids batchFailures:(NSArray **)batchFailures {
+	return [self saveImpl:ids operation:@"delete" itemName:@"ids" batchFailures:batchFailures];
+}
+
+- (void)delete:(NSArray *)ids cancellationToken:(ZKCancellationToken *)token completeBlock:(ZKSaveCompleteBlock)completeBlock {
+	[self saveImpl:ids operation:@"delete" itemName:@"ids" cancellationToken:token completeBlock:completeBlock];
+}
+
+- (NSUInteger)queryFieldCount:(NSString *)value operation:(NSString *)operation {
+	if ([operation isEqualToString:@"queryMore"])
+		return [queryBatchSizePolicy fieldCountForQueryLocator:value];
+	return [ZKQueryBatchSizePolicy fieldCountForSoql:value];
+}
+
+- (NSData *)queryEnvelope:(NSString *)value operation:(NSString *)operation name:(NSString *)elemName batchSize:(int)batchSize {
+	ZKEnvelope *env = [[ZKPartnerEnvelope alloc] initWithSessionHeader:[authSource sessionId] clientId:clientId queryBatchSize:batchSize];
 	[env startElement:operation];
 	[env addElement:elemName elemValue:value];
 	[env endElement:operation];
 	[env endElement:@"s:Body"];
-	
-	zkElement *qr = [self sendRequest:[env end]];
-	ZKQueryResult *result = [[ZKQueryResult alloc] initFromXmlNode:[[qr childElements] objectAtIndex:0]];
+	NSData *payload = [env end];
 	[env release];
+	return payload;
+}
+
+- (ZKQueryResult *)queryImpl:(NSString *)value operation:(NSString *)operation name:(NSString *)elemName {
+	if(!authSource) return NULL;
+	[self checkSession];
+
+	ZKQueryBatchSizePolicy *policy = [self queryBatchSizePolicy];
+	NSUInteger fieldCount = policy == nil ? 0 : [self queryFieldCount:value operation:operation];
+	NSData *payload = [self queryEnvelope:value operation:operation name:elemName batchSize:[policy batchSizeForFieldCount:fieldCount]];
+
+	zkElement *qr = nil;
+	CFAbsoluteTime started = CFAbsoluteTimeGetCurrent();
+	ZKStreamParser *parser = [[ZKStreamParser alloc] initWithResultType:zkStreamResultQueryResult];
+	ZKQueryResult *result = [[self sendRequest:payload streamingParser:parser fallback:&qr] retain];
+	if (result == nil)
+		result = [[ZKQueryResult alloc] initFromXmlNode:[[qr childElements] objectAtIndex:0]];
+	[parser release];
+	[policy queryResult:result fieldCount:fieldCount responseTime:CFAbsoluteTimeGetCurrent() - started];
 	return [result autorelease];
 }
 
+- (void)queryImpl:(NSString *)value operation:(NSString *)operation name:(NSString *)elemName cancellationToken:(ZKCancellationToken *)token
+	completeBlock:(void (^)(ZKQueryResult *result))completeBlock failBlock:(ZKFailBlock)failBlock {
+	if(!authSource) {
+		completeBlock(nil);
+		return;
+	}
+	[self checkSession];
+
+	ZKQueryBatchSizePolicy *policy = [self queryBatchSizePolicy];
+	NSUInteger fieldCount = policy == nil ? 0 : [self queryFieldCount:value operation:operation];
+	NSData *payload = [self queryEnvelope:value operation:operation name:elemName batchSize:[policy batchSizeForFieldCount:fieldCount]];
+
+	CFAbsoluteTime started = CFAbsoluteTimeGetCurrent();
+	ZKStreamParser *parser = [[[ZKStreamParser alloc] initWithResultType:zkStreamResultQueryResult] autorelease];
+	[self sendRequest:payload
+	  streamingParser:parser
+	cancellationToken:token
+		completeBlock:^(id result, zkElement *qr) {
+			if (result == nil)
+				result = [[[ZKQueryResult alloc] initFromXmlNode:[[qr childElements] objectAtIndex:0]] autorelease];
+			[policy queryResult:result fieldCount:fieldCount responseTime:CFAbsoluteTimeGetCurrent() - started];
+			completeBlock(result);
+		}
+			failBlock:failBlock];
+}
+
+- (void)query:(NSString *)soql cancellationToken:(ZKCancellationToken *)token completeBlock:(void (^)(ZKQueryResult *result))completeBlock failBlock:(ZKFailBlock)failBlock {
+	[self queryImpl:soql operation:@"query" name:@"queryString" cancellationToken:token completeBlock:completeBlock failBlock:failBlock];
+}
+
+- (void)queryAll:(NSString *)soql cancellationToken:(ZKCancellationToken *)token completeBlock:(void (^)(ZKQueryResult *result))completeBlock failBlock:(ZKFailBlock)failBlock {
+	[self queryImpl:soql operation:@"queryAll" name:@"queryString" cancellationToken:token completeBlock:completeBlock failBlock:failBlock];
+}
+
+- (void)queryMore:(NSString *)queryLocator cancellationToken:(ZKCancellationToken *)token completeBlock:(void (^)(ZKQueryResult *result))completeBlock failBlock:(ZKFailBlock)failBlock {
+	[self queryImpl:queryLocator operation:@"queryMore" name:@"queryLocator" cancellationToken:token completeBlock:completeBlock failBlock:failBlock];
+}
+
 @end
@@ -22,7 +22,7 @@
 
 @class zkElement;
 
-@interface ZKXmlDeserializer : NSObject {
+@interface ZKXmlDeserializer : NSObject <NSCoding> {
 	zkElement *node;
 	NSMutableDictionary *values;
 }
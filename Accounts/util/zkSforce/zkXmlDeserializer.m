@@ -31,6 +31,14 @@
 	return self;
 }
 
+- (void)encodeWithCoder:(NSCoder *)coder {
+	[coder encodeObject:node forKey:@"node"];
+}
+
+- (id)initWithCoder:(NSCoder *)coder {
+	return [self initWithXmlElement:[coder decodeObjectForKey:@"node"]];
+}
+
 -(void)dealloc {
 	[node release];
 	[values release];